@@ -302,6 +302,8 @@ static ConstPair consts[] = {
   {"ADDRESS_IS_IN_USE", GRN_ADDRESS_IS_IN_USE},
   {"ZLIB_ERROR", GRN_ZLIB_ERROR},
   {"LZO_ERROR", GRN_LZO_ERROR},
+  {"LZ4_ERROR", GRN_LZ4_ERROR},
+  {"ZSTD_ERROR", GRN_ZSTD_ERROR},
   /* grn_encoding */
   {"ENC_DEFAULT", GRN_ENC_DEFAULT},
   {"ENC_NONE", GRN_ENC_NONE},
@@ -7,6 +7,7 @@ AC_CHECK_FUNCS(gmtime_r)
 AC_CHECK_FUNCS(localtime_r)
 AC_CHECK_FUNCS(mkostemp)
 AC_CHECK_FUNCS(open)
+AC_CHECK_FUNCS(posix_fadvise)
 AC_CHECK_FUNCS(read)
 AC_CHECK_FUNCS(strncasecmp)
 AC_CHECK_FUNCS(strtoull)
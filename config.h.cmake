@@ -84,6 +84,7 @@
 #cmakedefine GRN_WITH_CUTTER
 #cmakedefine GRN_WITH_KYTEA
 #cmakedefine GRN_WITH_LIBMEMCACHED
+#cmakedefine GRN_WITH_LZ4
 #cmakedefine GRN_WITH_LZO
 #cmakedefine GRN_WITH_MECAB
 #cmakedefine GRN_WITH_MESSAGE_PACK
@@ -91,6 +92,7 @@
 #cmakedefine GRN_WITH_NFKC
 #cmakedefine GRN_WITH_ZEROMQ
 #cmakedefine GRN_WITH_ZLIB
+#cmakedefine GRN_WITH_ZSTD
 
 /* headers */
 #cmakedefine HAVE_DLFCN_H
@@ -134,6 +136,7 @@
 #cmakedefine HAVE_MECAB_DICTIONARY_INFO_T
 
 /* functions */
+#cmakedefine HAVE_MECAB_MODEL_NEW2
 #cmakedefine HAVE__STRNICMP
 #cmakedefine HAVE__STRTOUI64
 #cmakedefine HAVE_BACKTRACE
@@ -145,6 +148,7 @@
 #cmakedefine HAVE_LOCALTIME_R
 #cmakedefine HAVE_MKOSTEMP
 #cmakedefine HAVE_OPEN
+#cmakedefine HAVE_POSIX_FADVISE
 #cmakedefine HAVE_READ
 #cmakedefine HAVE_STRNCASECMP
 #cmakedefine HAVE_STRTOULL
@@ -64,6 +64,8 @@ Groonga = {
   GRN_OBJ_COMPRESS_NONE:          (0x00<<4),
   GRN_OBJ_COMPRESS_ZLIB:          (0x01<<4),
   GRN_OBJ_COMPRESS_LZO:           (0x02<<4),
+  GRN_OBJ_COMPRESS_LZ4:           (0x03<<4),
+  GRN_OBJ_COMPRESS_ZSTD:          (0x04<<4),
 
   GRN_OBJ_WITH_SECTION:           (0x01<<7),
   GRN_OBJ_WITH_WEIGHT:            (0x01<<8),
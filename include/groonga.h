@@ -114,6 +114,8 @@ typedef enum {
   GRN_CAS_ERROR = -70,
   GRN_UNSUPPORTED_COMMAND_VERSION = -71,
   GRN_NORMALIZER_ERROR = -72,
+  GRN_LZ4_ERROR = -73,
+  GRN_ZSTD_ERROR = -74,
 } grn_rc;
 
 GRN_API grn_rc grn_init(void);
@@ -247,6 +249,15 @@ GRN_API grn_rc grn_set_default_match_escalation_threshold(long long int threshol
 GRN_API int grn_get_lock_timeout(void);
 GRN_API grn_rc grn_set_lock_timeout(int timeout);
 
+GRN_API int grn_get_table_select_n_workers(void);
+GRN_API grn_rc grn_set_table_select_n_workers(int n_workers);
+
+GRN_API int grn_get_ii_build_n_workers(void);
+GRN_API grn_rc grn_set_ii_build_n_workers(int n_workers);
+
+GRN_API unsigned long long int grn_get_max_mapped_memory(void);
+GRN_API grn_rc grn_set_max_mapped_memory(unsigned long long int size);
+
 /* cache */
 #define GRN_CACHE_DEFAULT_MAX_N_ENTRIES 100
 typedef struct _grn_cache grn_cache;
@@ -256,12 +267,18 @@ GRN_API grn_rc grn_cache_close(grn_ctx *ctx, grn_cache *cache);
 
 GRN_API grn_rc grn_cache_current_set(grn_ctx *ctx, grn_cache *cache);
 GRN_API grn_cache *grn_cache_current_get(grn_ctx *ctx);
+GRN_API grn_rc grn_ctx_set_cache(grn_ctx *ctx, grn_cache *cache);
 
 GRN_API grn_rc grn_cache_set_max_n_entries(grn_ctx *ctx,
                                            grn_cache *cache,
                                            unsigned int n);
 GRN_API unsigned int grn_cache_get_max_n_entries(grn_ctx *ctx,
                                                  grn_cache *cache);
+GRN_API grn_rc grn_cache_set_max_n_bytes(grn_ctx *ctx,
+                                         grn_cache *cache,
+                                         unsigned long long int n);
+GRN_API unsigned long long int grn_cache_get_max_n_bytes(grn_ctx *ctx,
+                                                         grn_cache *cache);
 
 /* grn_encoding */
 
@@ -296,6 +313,8 @@ typedef unsigned short int grn_obj_flags;
 #define GRN_OBJ_COMPRESS_NONE          (0x00<<4)
 #define GRN_OBJ_COMPRESS_ZLIB          (0x01<<4)
 #define GRN_OBJ_COMPRESS_LZO           (0x02<<4)
+#define GRN_OBJ_COMPRESS_LZ4           (0x03<<4)
+#define GRN_OBJ_COMPRESS_ZSTD          (0x04<<4)
 
 #define GRN_OBJ_WITH_SECTION           (0x01<<7)
 #define GRN_OBJ_WITH_WEIGHT            (0x01<<8)
@@ -607,6 +626,7 @@ GRN_API int grn_table_sort(grn_ctx *ctx, grn_obj *table, int offset, int limit,
 typedef struct _grn_table_group_result grn_table_group_result;
 typedef unsigned int grn_table_group_flags;
 
+#define GRN_TABLE_GROUP_CALC_NONE      (0x00)
 #define GRN_TABLE_GROUP_CALC_COUNT     (0x01<<3)
 #define GRN_TABLE_GROUP_CALC_MAX       (0x01<<4)
 #define GRN_TABLE_GROUP_CALC_MIN       (0x01<<5)
@@ -702,6 +722,7 @@ struct _grn_table_group_result {
   int limit;
   grn_table_group_flags flags;
   grn_operator op;
+  grn_obj *calc_target;
 };
 
 GRN_API grn_rc grn_table_group(grn_ctx *ctx, grn_obj *table,
@@ -734,6 +755,14 @@ GRN_API unsigned int grn_table_size(grn_ctx *ctx, grn_obj *table);
 #define GRN_COLUMN_NAME_SCORE_LEN     (sizeof(GRN_COLUMN_NAME_SCORE) - 1)
 #define GRN_COLUMN_NAME_NSUBRECS      "_nsubrecs"
 #define GRN_COLUMN_NAME_NSUBRECS_LEN  (sizeof(GRN_COLUMN_NAME_NSUBRECS) - 1)
+#define GRN_COLUMN_NAME_MAX           "_max"
+#define GRN_COLUMN_NAME_MAX_LEN       (sizeof(GRN_COLUMN_NAME_MAX) - 1)
+#define GRN_COLUMN_NAME_MIN           "_min"
+#define GRN_COLUMN_NAME_MIN_LEN       (sizeof(GRN_COLUMN_NAME_MIN) - 1)
+#define GRN_COLUMN_NAME_SUM           "_sum"
+#define GRN_COLUMN_NAME_SUM_LEN       (sizeof(GRN_COLUMN_NAME_SUM) - 1)
+#define GRN_COLUMN_NAME_AVG           "_avg"
+#define GRN_COLUMN_NAME_AVG_LEN       (sizeof(GRN_COLUMN_NAME_AVG) - 1)
 
 GRN_API grn_obj *grn_column_create(grn_ctx *ctx, grn_obj *table,
                                    const char *name, unsigned int name_size,
@@ -784,7 +813,9 @@ typedef enum {
   GRN_INFO_II_SPLIT_THRESHOLD,
   GRN_INFO_SUPPORT_ZLIB,
   GRN_INFO_SUPPORT_LZO,
-  GRN_INFO_NORMALIZER
+  GRN_INFO_NORMALIZER,
+  GRN_INFO_SUPPORT_LZ4,
+  GRN_INFO_SUPPORT_ZSTD
 } grn_info_type;
 
 GRN_API grn_obj *grn_obj_get_info(grn_ctx *ctx, grn_obj *obj, grn_info_type type, grn_obj *valuebuf);
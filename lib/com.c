@@ -371,9 +371,12 @@ grn_com_event_add(grn_ctx *ctx, grn_com_event *ev, grn_sock fd, int events, grn_
 #endif /* USE_KQUEUE */
   {
     if (grn_hash_add(ctx, ev->hash, &fd, sizeof(grn_sock), (void **)&c, NULL)) {
+      grn_timeval now;
+      grn_timeval_now(ctx, &now);
       c->ev = ev;
       c->fd = fd;
       c->events = events;
+      c->last_active = now.tv_sec;
       if (com) { *com = c; }
     }
   }
@@ -392,24 +395,55 @@ grn_com_event_mod(grn_ctx *ctx, grn_com_event *ev, grn_sock fd, int events, grn_
     }
     if (com) { *com = c; }
     if (c->events != events) {
+      /* No events means that fd isn't watched at all. Even an empty
+         epoll mask reports hang ups that nobody would handle. */
+      int old_events = c->events;
+      grn_timeval now;
+      grn_timeval_now(ctx, &now);
+      c->last_active = now.tv_sec;
+      /* Another thread may watch fd again. fd may be ready as soon as
+         it's watched. */
+      if (!old_events) { c->events = events; }
 #ifdef USE_EPOLL
-      struct epoll_event e;
-      memset(&e, 0, sizeof(struct epoll_event));
-      e.data.fd = (fd);
-      e.events = (__uint32_t) events;
-      if (epoll_ctl(ev->epfd, EPOLL_CTL_MOD, (fd), &e) == -1) {
-        SERR("epoll_ctl");
-        return ctx->rc;
+      {
+        struct epoll_event e;
+        int op;
+        memset(&e, 0, sizeof(struct epoll_event));
+        e.data.fd = (fd);
+        e.events = (__uint32_t) (events ? events : old_events);
+        if (!events) {
+          op = EPOLL_CTL_DEL;
+        } else if (!old_events) {
+          op = EPOLL_CTL_ADD;
+        } else {
+          op = EPOLL_CTL_MOD;
+        }
+        if (epoll_ctl(ev->epfd, op, (fd), &e) == -1) {
+          c->events = old_events;
+          SERR("epoll_ctl");
+          return ctx->rc;
+        }
       }
 #endif /* USE_EPOLL*/
 #ifdef USE_KQUEUE
-      // experimental
-      struct kevent e[2];
-      EV_SET(&e[0], (fd), GRN_COM_POLLIN|GRN_COM_POLLOUT, EV_DELETE, 0, 0, NULL);
-      EV_SET(&e[1], (fd), events, EV_ADD, 0, 0, NULL);
-      if (kevent(ev->kqfd, e, 2, NULL, 0, NULL) == -1) {
-        SERR("kevent");
-        return ctx->rc;
+      {
+        // experimental
+        struct kevent e[2];
+        int n = 0;
+        if (old_events) {
+          EV_SET(&e[n], (fd), GRN_COM_POLLIN|GRN_COM_POLLOUT, EV_DELETE,
+                 0, 0, NULL);
+          n++;
+        }
+        if (events) {
+          EV_SET(&e[n], (fd), events, EV_ADD, 0, 0, NULL);
+          n++;
+        }
+        if (kevent(ev->kqfd, e, n, NULL, 0, NULL) == -1) {
+          c->events = old_events;
+          SERR("kevent");
+          return ctx->rc;
+        }
       }
 #endif /* USE_KQUEUE */
       c->events = events;
@@ -428,7 +462,7 @@ grn_com_event_del(grn_ctx *ctx, grn_com_event *ev, grn_sock fd)
     grn_id id = grn_hash_get(ctx, ev->hash, &fd, sizeof(grn_sock), (void **)&c);
     if (id) {
 #ifdef USE_EPOLL
-      if (!c->closed) {
+      if (!c->closed && c->events) {
         struct epoll_event e;
         memset(&e, 0, sizeof(struct epoll_event));
         e.data.fd = fd;
@@ -440,11 +474,13 @@ grn_com_event_del(grn_ctx *ctx, grn_com_event *ev, grn_sock fd)
       }
 #endif /* USE_EPOLL*/
 #ifdef USE_KQUEUE
-      struct kevent e;
-      EV_SET(&e, (fd), c->events, EV_DELETE, 0, 0, NULL);
-      if (kevent(ev->kqfd, &e, 1, NULL, 0, NULL) == -1) {
-        SERR("kevent");
-        return ctx->rc;
+      if (c->events) {
+        struct kevent e;
+        EV_SET(&e, (fd), c->events, EV_DELETE, 0, 0, NULL);
+        if (kevent(ev->kqfd, &e, 1, NULL, 0, NULL) == -1) {
+          SERR("kevent");
+          return ctx->rc;
+        }
       }
 #endif /* USE_KQUEUE */
       return grn_hash_delete_by_id(ctx, ev->hash, id, NULL);
@@ -520,7 +556,11 @@ grn_com_receiver(grn_ctx *ctx, grn_com *com)
     // GRN_LOG(ctx, GRN_LOG_NOTICE, "accepted (%d)", fd);
     return;
   } else {
-    grn_msg *msg = (grn_msg *)grn_msg_open(ctx, com, &ev->recv_old);
+    grn_msg *msg;
+    grn_timeval now;
+    grn_timeval_now(ctx, &now);
+    com->last_active = now.tv_sec;
+    msg = (grn_msg *)grn_msg_open(ctx, com, &ev->recv_old);
     grn_com_recv(ctx, msg->u.peer, &msg->header, (grn_obj *)msg);
     if (msg->u.peer /* is_edge_request(msg)*/) {
       memcpy(&msg->edge_id, &ev->curr_edge_id, sizeof(grn_com_addr));
@@ -598,6 +638,7 @@ grn_com_event_poll(grn_ctx *ctx, grn_com_event *ev, int timeout)
   ctx->errlvl = GRN_OK;
   ctx->rc = GRN_SUCCESS;
   GRN_HASH_EACH(ctx, ev->hash, eh, &pfd, &dummy, &com, {
+    if (!com->events) { continue; }
     ep->fd = *pfd;
     //    ep->events =(short) com->events;
     ep->events = POLLIN;
@@ -634,7 +675,11 @@ grn_com_event_poll(grn_ctx *ctx, grn_com_event *ev, int timeout)
       if (grn_sock_close(efd) == -1) { SERR("close"); }
       continue;
     }
-    if ((ep->events & GRN_COM_POLLIN)) { grn_com_receiver(ctx, com); }
+    /* A reset connection may report only EPOLLHUP or EPOLLERR. The
+       receiver reads the error and the handler closes the connection. */
+    if ((ep->events & (GRN_COM_POLLIN|EPOLLHUP|EPOLLERR))) {
+      grn_com_receiver(ctx, com);
+    }
 #else /* USE_EPOLL */
 #ifdef USE_KQUEUE
     efd = ep->ident;
@@ -128,6 +128,9 @@ struct _grn_com {
   grn_com_event *ev;
   void *opaque;
   grn_bool accepting;
+  /* Seconds since the epoch when the connection was accepted, received
+     a message or had its events changed. */
+  int64_t last_active;
 };
 
 struct _grn_com_event {
@@ -26,6 +26,7 @@
 #include "output.h"
 #include "normalizer_in.h"
 #include "ctx_impl_mrb.h"
+#include "proc.h"
 #include <stdio.h>
 #include <stdarg.h>
 #include <time.h>
@@ -55,6 +56,12 @@ int grn_pagesize;
 grn_critical_section grn_glock;
 uint32_t grn_gtick;
 int grn_lock_timeout = GRN_LOCK_TIMEOUT;
+int grn_table_select_n_workers = 1;
+uint32_t grn_table_select_min_n_records_per_worker =
+  GRN_TABLE_SELECT_DEFAULT_MIN_N_RECORDS_PER_WORKER;
+int grn_ii_build_n_workers = 1;
+uint32_t grn_ii_build_min_n_records_per_worker =
+  GRN_II_BUILD_DEFAULT_MIN_N_RECORDS_PER_WORKER;
 
 #ifdef USE_UYIELD
 int grn_uyield_count = 0;
@@ -487,6 +494,17 @@ grn_ctx_impl_init(grn_ctx *ctx)
       grn_get_default_match_escalation_threshold();
   }
 
+  ctx->impl->cache = NULL;
+
+  ctx->impl->scorer_model = GRN_SCORER_MODEL_TF;
+  ctx->impl->scorer_bm25_k1 = GRN_SCORER_MODEL_DEFAULT_BM25_K1;
+  ctx->impl->scorer_bm25_b = GRN_SCORER_MODEL_DEFAULT_BM25_B;
+
+  ctx->impl->top_k = 0;
+  ctx->impl->top_k_n_hits = 0;
+
+  ctx->impl->select_conditions = NULL;
+
   ctx->impl->finalizer = NULL;
 
   ctx->impl->op = GRN_OP_T0LVL;
@@ -513,6 +531,12 @@ grn_ctx_impl_init(grn_ctx *ctx)
   msgpack_packer_init(&ctx->impl->msgpacker, ctx, grn_msgpack_buffer_write);
 #endif
 
+#ifdef GRN_WITH_ZSTD
+  ctx->impl->zstd_compress_context = NULL;
+  ctx->impl->zstd_decompress_context = NULL;
+#endif
+  GRN_PTR_INIT(&ctx->impl->uncompressed_values, GRN_OBJ_VECTOR, GRN_ID_NIL);
+
   grn_ctx_impl_mrb_init(ctx);
 }
 
@@ -643,6 +667,7 @@ grn_ctx_fin(grn_ctx *ctx)
     if (ctx->impl->parser) {
       grn_expr_parser_close(ctx);
     }
+    grn_select_conditions_fin(ctx);
     if (ctx->impl->values) {
 #ifndef USE_MEMORY_DEBUG
       grn_db_obj *o;
@@ -666,6 +691,16 @@ grn_ctx_fin(grn_ctx *ctx)
       grn_ctx_send(ctx, "ACK", 3, GRN_CTX_HEAD);
       rc = grn_com_close(ctx, ctx->impl->com);
     }
+#ifdef GRN_WITH_ZSTD
+    if (ctx->impl->zstd_compress_context) {
+      ZSTD_freeCCtx(ctx->impl->zstd_compress_context);
+    }
+    if (ctx->impl->zstd_decompress_context) {
+      ZSTD_freeDCtx(ctx->impl->zstd_decompress_context);
+    }
+#endif
+    grn_obj_release_values_(ctx, 0);
+    GRN_OBJ_FIN(ctx, &ctx->impl->uncompressed_values);
     GRN_OBJ_FIN(ctx, &ctx->impl->names);
     GRN_OBJ_FIN(ctx, &ctx->impl->levels);
     rc = grn_obj_close(ctx, ctx->impl->outbuf);
@@ -1230,6 +1265,66 @@ check_grn_ja_skip_same_value_put(grn_ctx *ctx)
   }
 }
 
+static void
+check_grn_table_select_n_workers(grn_ctx *ctx)
+{
+  const char *n_workers_env;
+  const char *min_n_records_env;
+
+  n_workers_env = getenv("GRN_TABLE_SELECT_N_WORKERS");
+  if (n_workers_env) {
+    grn_set_table_select_n_workers(atoi(n_workers_env));
+  }
+
+  min_n_records_env = getenv("GRN_TABLE_SELECT_MIN_N_RECORDS_PER_WORKER");
+  if (min_n_records_env) {
+    grn_table_select_min_n_records_per_worker = atoi(min_n_records_env);
+  }
+}
+
+static void
+check_grn_select_condition_cache_size(grn_ctx *ctx)
+{
+  const char *cache_size_env;
+
+  cache_size_env = getenv("GRN_SELECT_CONDITION_CACHE_SIZE");
+  if (cache_size_env) {
+    grn_select_condition_cache_size = atoi(cache_size_env);
+  }
+}
+
+static void
+check_grn_ii_build_n_workers(grn_ctx *ctx)
+{
+  const char *n_workers_env;
+  const char *min_n_records_env;
+
+  n_workers_env = getenv("GRN_II_BUILD_N_WORKERS");
+  if (n_workers_env) {
+    grn_set_ii_build_n_workers(atoi(n_workers_env));
+  }
+
+  min_n_records_env = getenv("GRN_II_BUILD_MIN_N_RECORDS_PER_WORKER");
+  if (min_n_records_env) {
+    grn_ii_build_min_n_records_per_worker = atoi(min_n_records_env);
+  }
+}
+
+static void
+check_grn_max_mapped_memory(grn_ctx *ctx)
+{
+  const char *max_mapped_memory_env;
+
+  max_mapped_memory_env = getenv("GRN_MAX_MAPPED_MEMORY");
+  if (max_mapped_memory_env) {
+    const char *end = max_mapped_memory_env + strlen(max_mapped_memory_env);
+    int64_t size = grn_atoll(max_mapped_memory_env, end, NULL);
+    if (size > 0) {
+      grn_set_max_mapped_memory(size);
+    }
+  }
+}
+
 grn_rc
 grn_init(void)
 {
@@ -1310,6 +1405,10 @@ grn_init(void)
   GRN_LOG(ctx, GRN_LOG_NOTICE, "grn_init");
   check_overcommit_memory(ctx);
   check_grn_ja_skip_same_value_put(ctx);
+  check_grn_table_select_n_workers(ctx);
+  check_grn_ii_build_n_workers(ctx);
+  check_grn_select_condition_cache_size(ctx);
+  check_grn_max_mapped_memory(ctx);
   return rc;
 }
 
@@ -1376,6 +1475,42 @@ grn_set_lock_timeout(int timeout)
   return GRN_SUCCESS;
 }
 
+int
+grn_get_table_select_n_workers(void)
+{
+  return grn_table_select_n_workers;
+}
+
+grn_rc
+grn_set_table_select_n_workers(int n_workers)
+{
+  if (n_workers < 1) {
+    n_workers = 1;
+  } else if (n_workers > GRN_TABLE_SELECT_MAX_N_WORKERS) {
+    n_workers = GRN_TABLE_SELECT_MAX_N_WORKERS;
+  }
+  grn_table_select_n_workers = n_workers;
+  return GRN_SUCCESS;
+}
+
+int
+grn_get_ii_build_n_workers(void)
+{
+  return grn_ii_build_n_workers;
+}
+
+grn_rc
+grn_set_ii_build_n_workers(int n_workers)
+{
+  if (n_workers < 1) {
+    n_workers = 1;
+  } else if (n_workers > GRN_II_BUILD_MAX_N_WORKERS) {
+    n_workers = GRN_II_BUILD_MAX_N_WORKERS;
+  }
+  grn_ii_build_n_workers = n_workers;
+  return GRN_SUCCESS;
+}
+
 static int alloc_count = 0;
 
 grn_rc
@@ -1487,6 +1622,23 @@ grn_ctx_set_match_escalation_threshold(grn_ctx *ctx, long long int threshold)
   return GRN_SUCCESS;
 }
 
+grn_rc
+grn_ctx_set_scorer_model(grn_ctx *ctx, grn_scorer_model model,
+                         double k1, double b)
+{
+  if (!ctx->impl) { return GRN_INVALID_ARGUMENT; }
+  if (k1 < 0 || b < 0 || b > 1) {
+    ERR(GRN_INVALID_ARGUMENT,
+        "invalid BM25 parameters: k1=<%g> b=<%g>: k1 >= 0 and 0 <= b <= 1",
+        k1, b);
+    return ctx->rc;
+  }
+  ctx->impl->scorer_model = model;
+  ctx->impl->scorer_bm25_k1 = k1;
+  ctx->impl->scorer_bm25_b = b;
+  return GRN_SUCCESS;
+}
+
 grn_content_type
 grn_get_ctype(grn_obj *var)
 {
@@ -1848,6 +2000,8 @@ grn_ctx_send(grn_ctx *ctx, const char *str, unsigned int str_len, int flags)
           expr = grn_ctx_qe_exec(ctx, str, str_len);
         }
       }
+      grn_io_enforce_budget(ctx);
+      grn_obj_release_values_(ctx, 0);
       if (ctx->stat == GRN_CTX_QUITTING) { ctx->stat = GRN_CTX_QUIT; }
       if (ctx->impl->qe_next) {
         ERRCLR(ctx);
@@ -1985,23 +2139,43 @@ grn_ctx_info_get(grn_ctx *ctx, grn_ctx_info *info)
 
 typedef struct _grn_cache_entry grn_cache_entry;
 
-struct _grn_cache {
+/*
+  The cache is split into shards by the hash value of the key. Each
+  shard has its own lock. Entries in a shard are kept in a ring in
+  insertion order. A hit only sets `referenced' of the entry and doesn't
+  move it. The ring is swept by `hand' as CLOCK: referenced entries get
+  a second chance and the first unreferenced one is expired. `next' and
+  `prev' must be the first members because a shard is the sentinel of
+  its ring.
+*/
+typedef struct {
   grn_cache_entry *next;
   grn_cache_entry *prev;
+  grn_cache_entry *hand;
   grn_hash *hash;
   grn_mutex mutex;
-  uint32_t max_nentries;
+  uint64_t nbytes;
   uint32_t nfetches;
   uint32_t nhits;
+} grn_cache_shard;
+
+struct _grn_cache {
+  grn_cache_shard shards[GRN_CACHE_N_SHARDS];
+  uint32_t max_nentries;
+  uint64_t max_nbytes;
+  uint32_t next_shard;
 };
 
 struct _grn_cache_entry {
   grn_cache_entry *next;
   grn_cache_entry *prev;
   grn_obj *value;
+  grn_obj *dependencies;
   grn_timeval tv;
   grn_id id;
   uint32_t nref;
+  uint32_t nbytes;
+  grn_bool referenced;
 };
 
 static grn_cache *grn_cache_current = NULL;
@@ -2011,6 +2185,7 @@ grn_cache *
 grn_cache_open(grn_ctx *ctx)
 {
   grn_cache *cache = NULL;
+  int i;
 
   GRN_API_ENTER;
   cache = GRN_MALLOC(sizeof(grn_cache));
@@ -2019,14 +2194,22 @@ grn_cache_open(grn_ctx *ctx)
     goto exit;
   }
 
-  cache->next = (grn_cache_entry*)cache;
-  cache->prev = (grn_cache_entry *)cache;
-  cache->hash = grn_hash_create(&grn_gctx, NULL, GRN_TABLE_MAX_KEY_SIZE,
-                                sizeof(grn_cache_entry), GRN_OBJ_KEY_VAR_SIZE);
-  MUTEX_INIT(cache->mutex);
+  for (i = 0; i < GRN_CACHE_N_SHARDS; i++) {
+    grn_cache_shard *shard = &(cache->shards[i]);
+    shard->next = (grn_cache_entry *)shard;
+    shard->prev = (grn_cache_entry *)shard;
+    shard->hand = (grn_cache_entry *)shard;
+    shard->hash = grn_hash_create(&grn_gctx, NULL, GRN_TABLE_MAX_KEY_SIZE,
+                                  sizeof(grn_cache_entry),
+                                  GRN_OBJ_KEY_VAR_SIZE);
+    MUTEX_INIT(shard->mutex);
+    shard->nbytes = 0;
+    shard->nfetches = 0;
+    shard->nhits = 0;
+  }
   cache->max_nentries = GRN_CACHE_DEFAULT_MAX_N_ENTRIES;
-  cache->nfetches = 0;
-  cache->nhits = 0;
+  cache->max_nbytes = 0;
+  cache->next_shard = 0;
 
 exit :
   GRN_API_RETURN(cache);
@@ -2037,15 +2220,20 @@ grn_cache_close(grn_ctx *ctx, grn_cache *cache)
 {
   grn_ctx *ctx_original = ctx;
   grn_cache_entry *vp;
+  int i;
 
   GRN_API_ENTER;
 
   ctx = &grn_gctx;
-  GRN_HASH_EACH(ctx, cache->hash, id, NULL, NULL, &vp, {
-    grn_obj_close(ctx, vp->value);
-  });
-  grn_hash_close(ctx, cache->hash);
-  MUTEX_FIN(cache->mutex);
+  for (i = 0; i < GRN_CACHE_N_SHARDS; i++) {
+    grn_cache_shard *shard = &(cache->shards[i]);
+    GRN_HASH_EACH(ctx, shard->hash, id, NULL, NULL, &vp, {
+      grn_obj_close(ctx, vp->value);
+      if (vp->dependencies) { grn_obj_close(ctx, vp->dependencies); }
+    });
+    grn_hash_close(ctx, shard->hash);
+    MUTEX_FIN(shard->mutex);
+  }
   ctx = ctx_original;
   GRN_FREE(cache);
 
@@ -2062,9 +2250,23 @@ grn_cache_current_set(grn_ctx *ctx, grn_cache *cache)
 grn_cache *
 grn_cache_current_get(grn_ctx *ctx)
 {
+  if (ctx->impl && ctx->impl->cache) {
+    return ctx->impl->cache;
+  }
   return grn_cache_current;
 }
 
+grn_rc
+grn_ctx_set_cache(grn_ctx *ctx, grn_cache *cache)
+{
+  if (!ctx->impl) {
+    grn_ctx_impl_init(ctx);
+    if (!ctx->impl) { return ctx->rc; }
+  }
+  ctx->impl->cache = cache;
+  return GRN_SUCCESS;
+}
+
 void
 grn_cache_init(void)
 {
@@ -2072,6 +2274,8 @@ grn_cache_init(void)
   grn_cache_current_set(&grn_gctx, grn_cache_default);
 }
 
+static void grn_cache_shrink(grn_cache *cache, grn_cache_shard *shard);
+
 grn_rc
 grn_cache_set_max_n_entries(grn_ctx *ctx, grn_cache *cache, unsigned int n)
 {
@@ -2079,6 +2283,7 @@ grn_cache_set_max_n_entries(grn_ctx *ctx, grn_cache *cache, unsigned int n)
     return GRN_INVALID_ARGUMENT;
   }
   cache->max_nentries = n;
+  grn_cache_shrink(cache, NULL);
   return GRN_SUCCESS;
 }
 
@@ -2091,58 +2296,210 @@ grn_cache_get_max_n_entries(grn_ctx *ctx, grn_cache *cache)
   return cache->max_nentries;
 }
 
+grn_rc
+grn_cache_set_max_n_bytes(grn_ctx *ctx, grn_cache *cache,
+                          unsigned long long int n)
+{
+  if (!cache) {
+    return GRN_INVALID_ARGUMENT;
+  }
+  cache->max_nbytes = n;
+  grn_cache_shrink(cache, NULL);
+  return GRN_SUCCESS;
+}
+
+unsigned long long int
+grn_cache_get_max_n_bytes(grn_ctx *ctx, grn_cache *cache)
+{
+  if (!cache) {
+    return 0;
+  }
+  return cache->max_nbytes;
+}
+
+void
+grn_cache_get_shard_statistics(grn_ctx *ctx, grn_cache *cache, int nth,
+                               grn_cache_statistics *statistics)
+{
+  grn_cache_shard *shard = &(cache->shards[nth]);
+  MUTEX_LOCK(shard->mutex);
+  statistics->nentries = GRN_HASH_SIZE(shard->hash);
+  statistics->max_nentries = cache->max_nentries;
+  statistics->nbytes = shard->nbytes;
+  statistics->max_nbytes = cache->max_nbytes;
+  statistics->nfetches = shard->nfetches;
+  statistics->nhits = shard->nhits;
+  MUTEX_UNLOCK(shard->mutex);
+}
+
 void
 grn_cache_get_statistics(grn_ctx *ctx, grn_cache *cache,
                          grn_cache_statistics *statistics)
 {
-  MUTEX_LOCK(cache->mutex);
-  statistics->nentries = GRN_HASH_SIZE(cache->hash);
+  int i;
+  statistics->nentries = 0;
   statistics->max_nentries = cache->max_nentries;
-  statistics->nfetches = cache->nfetches;
-  statistics->nhits = cache->nhits;
-  MUTEX_UNLOCK(cache->mutex);
+  statistics->nbytes = 0;
+  statistics->max_nbytes = cache->max_nbytes;
+  statistics->nfetches = 0;
+  statistics->nhits = 0;
+  for (i = 0; i < GRN_CACHE_N_SHARDS; i++) {
+    grn_cache_statistics shard_statistics;
+    grn_cache_get_shard_statistics(ctx, cache, i, &shard_statistics);
+    statistics->nentries += shard_statistics.nentries;
+    statistics->nbytes += shard_statistics.nbytes;
+    statistics->nfetches += shard_statistics.nfetches;
+    statistics->nhits += shard_statistics.nhits;
+  }
+}
+
+static grn_cache_shard *
+grn_cache_shard_for(grn_cache *cache, const char *str, uint32_t str_len)
+{
+  uint32_t i;
+  uint32_t hash_value = 2166136261U;
+  for (i = 0; i < str_len; i++) {
+    hash_value = (hash_value ^ (uint8_t)str[i]) * 16777619U;
+  }
+  return &(cache->shards[hash_value % GRN_CACHE_N_SHARDS]);
 }
 
 static void
-grn_cache_expire_entry(grn_cache *cache, grn_cache_entry *ce)
+grn_cache_expire_entry(grn_cache_shard *shard, grn_cache_entry *ce)
 {
   if (!ce->nref) {
+    if (shard->hand == ce) {
+      shard->hand = ce->next;
+    }
     ce->prev->next = ce->next;
     ce->next->prev = ce->prev;
+    shard->nbytes -= ce->nbytes;
     grn_obj_close(&grn_gctx, ce->value);
-    grn_hash_delete_by_id(&grn_gctx, cache->hash, ce->id, NULL);
+    if (ce->dependencies) { grn_obj_close(&grn_gctx, ce->dependencies); }
+    grn_hash_delete_by_id(&grn_gctx, shard->hash, ce->id, NULL);
+  }
+}
+
+/* It expires one entry by sweeping the ring of the shard from its hand.
+   Entries in use are skipped. It returns GRN_FALSE when every entry is
+   in use. */
+static grn_bool
+grn_cache_shard_evict(grn_cache_shard *shard)
+{
+  grn_cache_entry *ce0 = (grn_cache_entry *)shard;
+  uint32_t n_steps = GRN_HASH_SIZE(shard->hash) * 2 + 1;
+  while (n_steps--) {
+    grn_cache_entry *ce = shard->hand;
+    if (ce == ce0) {
+      if (ce0->next == ce0) { break; }
+      shard->hand = ce0->next;
+      continue;
+    }
+    shard->hand = ce->next;
+    if (ce->nref) { continue; }
+    if (ce->referenced) {
+      ce->referenced = GRN_FALSE;
+      continue;
+    }
+    grn_cache_expire_entry(shard, ce);
+    return GRN_TRUE;
+  }
+  return GRN_FALSE;
+}
+
+static grn_bool
+grn_cache_is_over(grn_cache *cache)
+{
+  uint32_t nentries = 0;
+  uint64_t nbytes = 0;
+  int i;
+  for (i = 0; i < GRN_CACHE_N_SHARDS; i++) {
+    nentries += GRN_HASH_SIZE(cache->shards[i].hash);
+    nbytes += cache->shards[i].nbytes;
+  }
+  if (nentries > cache->max_nentries) {
+    return GRN_TRUE;
+  }
+  if (cache->max_nbytes > 0 && nbytes > cache->max_nbytes) {
+    return GRN_TRUE;
+  }
+  return GRN_FALSE;
+}
+
+/* It expires entries until the cache fits its limits. `shard' is tried
+   first because it has just grown. Other shards are tried in turn so
+   that the whole cache shares the limits. Only one shard is locked at
+   a time. The totals are read without locks; they only decide whether
+   to expire one more entry. */
+static void
+grn_cache_shrink(grn_cache *cache, grn_cache_shard *shard)
+{
+  int n_failures = 0;
+  if (shard) {
+    MUTEX_LOCK(shard->mutex);
+    while (grn_cache_is_over(cache) && grn_cache_shard_evict(shard)) {}
+    MUTEX_UNLOCK(shard->mutex);
+  }
+  while (n_failures < GRN_CACHE_N_SHARDS && grn_cache_is_over(cache)) {
+    uint32_t nth;
+    grn_bool evicted;
+    GRN_ATOMIC_ADD_EX(&(cache->next_shard), 1, nth);
+    shard = &(cache->shards[nth % GRN_CACHE_N_SHARDS]);
+    MUTEX_LOCK(shard->mutex);
+    evicted = grn_cache_shard_evict(shard);
+    MUTEX_UNLOCK(shard->mutex);
+    if (evicted) {
+      n_failures = 0;
+    } else {
+      n_failures++;
+    }
   }
 }
 
+/* An entry is stale when the database is touched as a whole or when
+   one of the tables that the entry depends on is modified. */
+static grn_bool
+grn_cache_entry_is_valid(grn_ctx *ctx, grn_cache_entry *ce)
+{
+  if (ce->tv.tv_sec <= grn_db_lastmod(ctx->impl->db)) {
+    return GRN_FALSE;
+  }
+  if (ce->dependencies) {
+    int i, n = GRN_BULK_VSIZE(ce->dependencies) / sizeof(grn_id);
+    for (i = 0; i < n; i++) {
+      grn_id id = GRN_RECORD_VALUE_AT(ce->dependencies, i);
+      grn_obj *obj = grn_ctx_at(ctx, id);
+      if (!obj || ce->tv.tv_sec <= grn_obj_lastmod(ctx, obj)) {
+        return GRN_FALSE;
+      }
+    }
+  }
+  return GRN_TRUE;
+}
+
 grn_obj *
 grn_cache_fetch(grn_ctx *ctx, grn_cache *cache,
                 const char *str, uint32_t str_len)
 {
+  grn_cache_shard *shard;
   grn_cache_entry *ce;
   grn_obj *obj = NULL;
   if (!ctx->impl || !ctx->impl->db) { return obj; }
-  MUTEX_LOCK(cache->mutex);
-  cache->nfetches++;
-  if (grn_hash_get(&grn_gctx, cache->hash, str, str_len, (void **)&ce)) {
-    if (ce->tv.tv_sec <= grn_db_lastmod(ctx->impl->db)) {
-      grn_cache_expire_entry(cache, ce);
+  shard = grn_cache_shard_for(cache, str, str_len);
+  MUTEX_LOCK(shard->mutex);
+  shard->nfetches++;
+  if (grn_hash_get(&grn_gctx, shard->hash, str, str_len, (void **)&ce)) {
+    if (!grn_cache_entry_is_valid(ctx, ce)) {
+      grn_cache_expire_entry(shard, ce);
       goto exit;
     }
     ce->nref++;
+    ce->referenced = GRN_TRUE;
     obj = ce->value;
-    ce->prev->next = ce->next;
-    ce->next->prev = ce->prev;
-    {
-      grn_cache_entry *ce0 = (grn_cache_entry *)cache;
-      ce->next = ce0->next;
-      ce->prev = ce0;
-      ce0->next->prev = ce;
-      ce0->next = ce;
-    }
-    cache->nhits++;
+    shard->nhits++;
   }
 exit :
-  MUTEX_UNLOCK(cache->mutex);
+  MUTEX_UNLOCK(shard->mutex);
   return obj;
 }
 
@@ -2150,70 +2507,114 @@ void
 grn_cache_unref(grn_ctx *ctx, grn_cache *cache,
                 const char *str, uint32_t str_len)
 {
+  grn_cache_shard *shard;
   grn_cache_entry *ce;
   ctx = &grn_gctx;
-  MUTEX_LOCK(cache->mutex);
-  if (grn_hash_get(ctx, cache->hash, str, str_len, (void **)&ce)) {
+  shard = grn_cache_shard_for(cache, str, str_len);
+  MUTEX_LOCK(shard->mutex);
+  if (grn_hash_get(ctx, shard->hash, str, str_len, (void **)&ce)) {
     if (ce->nref) { ce->nref--; }
   }
-  MUTEX_UNLOCK(cache->mutex);
+  MUTEX_UNLOCK(shard->mutex);
 }
 
 void
 grn_cache_update(grn_ctx *ctx, grn_cache *cache,
-                 const char *str, uint32_t str_len, grn_obj *value)
+                 const char *str, uint32_t str_len, grn_obj *value,
+                 grn_obj *dependencies)
 {
   grn_id id;
   int added = 0;
+  grn_cache_shard *shard;
   grn_cache_entry *ce;
   grn_rc rc = GRN_SUCCESS;
-  grn_obj *old = NULL, *obj;
+  grn_obj *old = NULL, *old_dependencies = NULL, *obj, *deps = NULL;
+  uint32_t nbytes;
   if (!ctx->impl || !cache->max_nentries) { return; }
+  nbytes = str_len + GRN_TEXT_LEN(value);
+  if (dependencies) {
+    nbytes += GRN_BULK_VSIZE(dependencies);
+  }
+  if (cache->max_nbytes > 0 && nbytes > cache->max_nbytes) { return; }
   if (!(obj = grn_obj_open(&grn_gctx, GRN_BULK, 0, GRN_DB_TEXT))) { return; }
   GRN_TEXT_PUT(&grn_gctx, obj, GRN_TEXT_VALUE(value), GRN_TEXT_LEN(value));
-  MUTEX_LOCK(cache->mutex);
-  if ((id = grn_hash_add(&grn_gctx, cache->hash, str, str_len, (void **)&ce, &added))) {
+  if (dependencies && GRN_BULK_VSIZE(dependencies) > 0) {
+    if (!(deps = grn_obj_open(&grn_gctx, GRN_UVECTOR, 0, GRN_ID_NIL))) {
+      grn_obj_close(&grn_gctx, obj);
+      return;
+    }
+    grn_bulk_write(&grn_gctx, deps,
+                   GRN_BULK_HEAD(dependencies), GRN_BULK_VSIZE(dependencies));
+  }
+  shard = grn_cache_shard_for(cache, str, str_len);
+  MUTEX_LOCK(shard->mutex);
+  if ((id = grn_hash_add(&grn_gctx, shard->hash, str, str_len, (void **)&ce, &added))) {
     if (!added) {
       if (ce->nref) {
         rc = GRN_RESOURCE_BUSY;
         goto exit;
       }
       old = ce->value;
+      old_dependencies = ce->dependencies;
+      if (shard->hand == ce) {
+        shard->hand = ce->next;
+      }
       ce->prev->next = ce->next;
       ce->next->prev = ce->prev;
+      shard->nbytes -= ce->nbytes;
     }
     ce->id = id;
     ce->value = obj;
+    ce->dependencies = deps;
     ce->tv = ctx->impl->tv;
     ce->nref = 0;
+    ce->nbytes = nbytes;
+    ce->referenced = GRN_FALSE;
     {
-      grn_cache_entry *ce0 = (grn_cache_entry *)cache;
-      ce->next = ce0->next;
-      ce->prev = ce0;
-      ce0->next->prev = ce;
-      ce0->next = ce;
-    }
-    if (GRN_HASH_SIZE(cache->hash) > cache->max_nentries) {
-      grn_cache_expire_entry(cache, cache->prev);
+      /* The new entry is put just behind the hand so that it is swept
+         last. */
+      grn_cache_entry *hand = shard->hand;
+      ce->next = hand;
+      ce->prev = hand->prev;
+      hand->prev->next = ce;
+      hand->prev = ce;
     }
+    shard->nbytes += nbytes;
   } else {
     rc = GRN_NO_MEMORY_AVAILABLE;
   }
 exit :
-  MUTEX_UNLOCK(cache->mutex);
-  if (rc) { grn_obj_close(&grn_gctx, obj); }
+  MUTEX_UNLOCK(shard->mutex);
+  if (rc) {
+    grn_obj_close(&grn_gctx, obj);
+    if (deps) { grn_obj_close(&grn_gctx, deps); }
+  } else {
+    grn_cache_shrink(cache, shard);
+  }
   if (old) { grn_obj_close(&grn_gctx, old); }
+  if (old_dependencies) { grn_obj_close(&grn_gctx, old_dependencies); }
 }
 
 void
 grn_cache_expire(grn_cache *cache, int32_t size)
 {
-  grn_cache_entry *ce0 = (grn_cache_entry *)cache;
-  MUTEX_LOCK(cache->mutex);
-  while (ce0 != ce0->prev && size--) {
-    grn_cache_expire_entry(cache, ce0->prev);
+  int i;
+  for (i = 0; i < GRN_CACHE_N_SHARDS && size; i++) {
+    grn_cache_shard *shard = &(cache->shards[i]);
+    grn_cache_entry *ce0 = (grn_cache_entry *)shard;
+    grn_cache_entry *ce;
+    MUTEX_LOCK(shard->mutex);
+    ce = ce0->prev;
+    while (ce != ce0 && size) {
+      grn_cache_entry *prev = ce->prev;
+      if (!ce->nref) {
+        grn_cache_expire_entry(shard, ce);
+        size--;
+      }
+      ce = prev;
+    }
+    MUTEX_UNLOCK(shard->mutex);
   }
-  MUTEX_UNLOCK(cache->mutex);
 }
 
 void
@@ -2425,6 +2826,9 @@ grn_ctx_use(grn_ctx *ctx, grn_obj *db)
   } else {
     if (!ctx->impl) { grn_ctx_impl_init(ctx); }
     if (!ctx->rc) {
+      if (ctx->impl->db != db) {
+        grn_select_conditions_fin(ctx);
+      }
       ctx->impl->db = db;
       if (db) {
         grn_obj buf;
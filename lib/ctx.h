@@ -394,6 +394,15 @@ extern int grn_pagesize;
 extern grn_critical_section grn_glock;
 extern uint32_t grn_gtick;
 extern int grn_lock_timeout;
+extern int grn_table_select_n_workers;
+extern uint32_t grn_table_select_min_n_records_per_worker;
+extern int grn_ii_build_n_workers;
+extern uint32_t grn_ii_build_min_n_records_per_worker;
+
+#define GRN_TABLE_SELECT_MAX_N_WORKERS                   64
+#define GRN_TABLE_SELECT_DEFAULT_MIN_N_RECORDS_PER_WORKER 65536
+#define GRN_II_BUILD_MAX_N_WORKERS                       64
+#define GRN_II_BUILD_DEFAULT_MIN_N_RECORDS_PER_WORKER     65536
 
 #define GRN_CTX_ALLOCATED                            (0x80)
 #define GRN_CTX_TEMPORARY_DISABLE_II_RESOLVE_SEL_AND (0x40)
@@ -440,6 +449,7 @@ grn_content_type grn_get_ctype(grn_obj *var);
 #define GRN_OBJ_ALLOCATED              (0x01<<2) /* allocated by ctx */
 #define GRN_OBJ_EXPRVALUE              (0x01<<3) /* value allocated by grn_expr */
 #define GRN_OBJ_EXPRCONST              (0x01<<4) /* constant allocated by grn_expr */
+#define GRN_OBJ_EXPRCONST_FOLDED       (0x01<<5) /* constant rewritten by grn_expr */
 
 typedef struct _grn_hook grn_hook;
 
@@ -459,6 +469,7 @@ typedef struct {
   uint8_t subrec_offset;
   uint8_t record_unit;
   uint8_t subrec_unit;
+  grn_table_group_flags group_flags;
   //  grn_obj_flags flags;
 } grn_db_obj;
 
@@ -478,11 +489,29 @@ typedef struct {
   (db_obj)->obj.source_size = 0;\
 } while (0)
 
+/**** scorer model ****/
+
+typedef enum {
+  GRN_SCORER_MODEL_TF = 0,
+  GRN_SCORER_MODEL_TFIDF,
+  GRN_SCORER_MODEL_BM25
+} grn_scorer_model;
+
+#define GRN_SCORER_MODEL_DEFAULT_BM25_K1 1.2
+#define GRN_SCORER_MODEL_DEFAULT_BM25_B  0.75
+
+grn_rc grn_ctx_set_scorer_model(grn_ctx *ctx, grn_scorer_model model,
+                                double k1, double b);
+
 /**** cache ****/
 
+#define GRN_CACHE_N_SHARDS 16
+
 typedef struct {
   uint32_t nentries;
   uint32_t max_nentries;
+  uint64_t nbytes;
+  uint64_t max_nbytes;
   uint32_t nfetches;
   uint32_t nhits;
 } grn_cache_statistics;
@@ -493,11 +522,14 @@ grn_obj *grn_cache_fetch(grn_ctx *ctx, grn_cache *cache,
 void grn_cache_unref(grn_ctx *ctx, grn_cache *cache,
                      const char *str, uint32_t str_size);
 void grn_cache_update(grn_ctx *ctx, grn_cache *cache,
-                      const char *str, uint32_t str_size, grn_obj *value);
+                      const char *str, uint32_t str_size, grn_obj *value,
+                      grn_obj *dependencies);
 void grn_cache_expire(grn_cache *cache, int32_t size);
 void grn_cache_fin(void);
 void grn_cache_get_statistics(grn_ctx *ctx, grn_cache *cache,
                               grn_cache_statistics *statistics);
+void grn_cache_get_shard_statistics(grn_ctx *ctx, grn_cache *cache, int nth,
+                                    grn_cache_statistics *statistics);
 
 /**** receive handler ****/
 
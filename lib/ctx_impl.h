@@ -34,6 +34,10 @@
 # include <mruby.h>
 #endif
 
+#ifdef GRN_WITH_ZSTD
+# include <zstd.h>
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -151,9 +155,32 @@ struct _grn_ctx_impl {
   /* match escalation portion */
   int64_t match_escalation_threshold;
 
+  /* cache portion */
+  grn_cache *cache;
+
+  /* scorer model portion */
+  grn_scorer_model scorer_model;
+  double scorer_bm25_k1;
+  double scorer_bm25_b;
+
+  /* top-k select portion */
+  int top_k;
+  uint32_t top_k_n_hits;
+
+  /* select condition cache portion */
+  grn_hash *select_conditions;
+
   /* lifetime portion */
   grn_proc_func *finalizer;
 
+#ifdef GRN_WITH_ZSTD
+  /* compression portion */
+  ZSTD_CCtx *zstd_compress_context;
+  ZSTD_DCtx *zstd_decompress_context;
+#endif
+  /* Decompressed values returned by grn_obj_get_value_(). */
+  grn_obj uncompressed_values;
+
   /* ql portion */
   uint8_t batchmode;
   uint8_t op;
@@ -155,6 +155,7 @@ grn_db_create(grn_ctx *ctx, const char *path, grn_db_create_optarg *optarg)
                           GRN_TINY_ARRAY_CLEAR|
                           GRN_TINY_ARRAY_THREADSAFE|
                           GRN_TINY_ARRAY_USE_MALLOC);
+      s->schema_version = 0;
       if (use_pat_as_db_keys) {
         s->keys = (grn_obj *)grn_pat_create(ctx, path, GRN_TABLE_MAX_KEY_SIZE,
                                             0, GRN_OBJ_KEY_VAR_SIZE);
@@ -218,6 +219,7 @@ grn_db_open(grn_ctx *ctx, const char *path)
                           GRN_TINY_ARRAY_CLEAR|
                           GRN_TINY_ARRAY_THREADSAFE|
                           GRN_TINY_ARRAY_USE_MALLOC);
+      s->schema_version = 0;
       switch (type) {
       case GRN_TABLE_PAT_KEY :
         s->keys = (grn_obj *)grn_pat_open(ctx, path);
@@ -302,6 +304,7 @@ grn_db_close(grn_ctx *ctx, grn_obj *db)
     if (ctx->impl->parser) {
       grn_expr_parser_close(ctx);
     }
+    grn_select_conditions_fin(ctx);
     if (ctx->impl->values) {
       grn_db_obj *o;
       GRN_ARRAY_EACH(ctx, ctx->impl->values, 0, 0, id, &o, {
@@ -410,12 +413,55 @@ grn_obj_io(grn_obj *obj)
   return io;
 }
 
+/*
+  Prefetches the files of obj into the page cache. An index column
+  prefetches its lexicon first. Returns the number of requested bytes.
+*/
+uint64_t
+grn_obj_prefetch(grn_ctx *ctx, grn_obj *obj)
+{
+  uint64_t n_bytes = 0;
+  switch (obj->header.type) {
+  case GRN_TABLE_HASH_KEY :
+  case GRN_TABLE_PAT_KEY :
+  case GRN_TABLE_DAT_KEY :
+  case GRN_TABLE_NO_KEY :
+  case GRN_COLUMN_FIX_SIZE :
+  case GRN_COLUMN_VAR_SIZE :
+    n_bytes = grn_io_prefetch(ctx, grn_obj_io(obj), 0, 0, 0);
+    break;
+  case GRN_COLUMN_INDEX :
+    {
+      grn_ii *ii = (grn_ii *)obj;
+      if (ii->lexicon) { n_bytes = grn_obj_prefetch(ctx, ii->lexicon); }
+      n_bytes += grn_ii_prefetch(ctx, ii);
+    }
+    break;
+  default :
+    break;
+  }
+  return n_bytes;
+}
+
 uint32_t
 grn_db_lastmod(grn_obj *s)
 {
   return grn_obj_io(((grn_db *)s)->keys)->header->lastmod;
 }
 
+uint32_t
+grn_db_schema_version(grn_obj *s)
+{
+  return ((grn_db *)s)->schema_version;
+}
+
+static void
+grn_db_schema_changed(grn_obj *s)
+{
+  uint32_t version;
+  GRN_ATOMIC_ADD_EX(&(((grn_db *)s)->schema_version), 1, version);
+}
+
 void
 grn_db_touch(grn_ctx *ctx, grn_obj *s)
 {
@@ -443,17 +489,33 @@ grn_obj_touch(grn_ctx *ctx, grn_obj *obj, grn_timeval *tv)
     case GRN_TABLE_PAT_KEY :
     case GRN_TABLE_DAT_KEY :
     case GRN_TABLE_NO_KEY :
+      if (!IS_TEMP(obj)) {
+        grn_obj_io(obj)->header->lastmod = tv->tv_sec;
+      }
+      break;
     case GRN_COLUMN_VAR_SIZE :
     case GRN_COLUMN_FIX_SIZE :
     case GRN_COLUMN_INDEX :
       if (!IS_TEMP(obj)) {
-        grn_obj_io(DB_OBJ(obj)->db)->header->lastmod = tv->tv_sec;
+        grn_obj *table;
+        grn_obj_io(obj)->header->lastmod = tv->tv_sec;
+        table = grn_ctx_at(ctx, obj->header.domain);
+        if (table) {
+          grn_obj_io(table)->header->lastmod = tv->tv_sec;
+        }
       }
       break;
     }
   }
 }
 
+uint32_t
+grn_obj_lastmod(grn_ctx *ctx, grn_obj *obj)
+{
+  grn_io *io = grn_obj_io(obj);
+  return io ? io->header->lastmod : 0;
+}
+
 grn_rc
 grn_db_check_name(grn_ctx *ctx, const char *name, unsigned int name_size)
 {
@@ -621,6 +683,7 @@ grn_proc_create(grn_ctx *ctx, const char *name, int name_size, grn_proc_type typ
 
 static void
 calc_rec_size(grn_obj_flags flags, uint32_t max_n_subrecs, uint32_t range_size,
+              uint32_t additional_value_size,
               uint8_t *subrec_size, uint8_t *subrec_offset,
               uint32_t *key_size, uint32_t *value_size)
 {
@@ -661,6 +724,7 @@ calc_rec_size(grn_obj_flags flags, uint32_t max_n_subrecs, uint32_t range_size,
     }
     *value_size = (uintptr_t)GRN_RSET_SUBRECS_NTH((((grn_rset_recinfo *)0)->subrecs),
                                                   *subrec_size, max_n_subrecs);
+    *value_size += additional_value_size;
   } else {
     *value_size = range_size;
   }
@@ -716,7 +780,8 @@ static grn_obj *
 grn_table_create_with_max_n_subrecs(grn_ctx *ctx, const char *name,
                                     unsigned int name_size, const char *path,
                                     grn_obj_flags flags, grn_obj *key_type,
-                                    grn_obj *value_type, uint32_t max_n_subrecs)
+                                    grn_obj *value_type, uint32_t max_n_subrecs,
+                                    grn_table_group_flags group_flags)
 {
   grn_id id;
   grn_id domain = GRN_ID_NIL, range = GRN_ID_NIL;
@@ -850,8 +915,9 @@ grn_table_create_with_max_n_subrecs(grn_ctx *ctx, const char *name,
       return NULL;
     }
   }
-  calc_rec_size(flags, max_n_subrecs, range_size, &subrec_size,
-                &subrec_offset, &key_size, &value_size);
+  calc_rec_size(flags, max_n_subrecs, range_size,
+                grn_rset_recinfo_calc_values_size(ctx, group_flags),
+                &subrec_size, &subrec_offset, &key_size, &value_size);
   switch (flags & GRN_OBJ_TABLE_TYPE_MASK) {
   case GRN_OBJ_TABLE_HASH_KEY :
     res = (grn_obj *)grn_hash_create(ctx, path, key_size, value_size, flags);
@@ -877,6 +943,8 @@ grn_table_create_with_max_n_subrecs(grn_ctx *ctx, const char *name,
     if (grn_db_obj_init(ctx, db, id, DB_OBJ(res))) {
       _grn_obj_remove(ctx, res);
       res = NULL;
+    } else {
+      DB_OBJ(res)->group_flags = group_flags;
     }
   } else {
     grn_obj_delete_by_id(ctx, db, id, GRN_TRUE);
@@ -892,27 +960,41 @@ grn_table_create(grn_ctx *ctx, const char *name, unsigned int name_size,
   grn_obj *res;
   GRN_API_ENTER;
   res = grn_table_create_with_max_n_subrecs(ctx, name, name_size, path,
-                                            flags, key_type, value_type, 0);
+                                            flags, key_type, value_type, 0, 0);
   GRN_API_RETURN(res);
 }
 
-grn_obj *
-grn_table_create_for_group(grn_ctx *ctx, const char *name,
-                           unsigned int name_size, const char *path,
-                           grn_obj *group_key, grn_obj *value_type,
-                           unsigned int max_n_subrecs)
+static grn_obj *
+grn_table_create_for_group_(grn_ctx *ctx, const char *name,
+                            unsigned int name_size, const char *path,
+                            grn_obj *group_key, grn_obj *value_type,
+                            unsigned int max_n_subrecs,
+                            grn_table_group_flags group_flags)
 {
   grn_obj *res = NULL;
   grn_obj *key_type;
-  GRN_API_ENTER;
   key_type = grn_ctx_at(ctx, grn_obj_get_range(ctx, group_key));
   if (key_type) {
     res = grn_table_create_with_max_n_subrecs(ctx, name, name_size, path,
                                               GRN_TABLE_HASH_KEY|
                                               GRN_OBJ_WITH_SUBREC|
                                               GRN_OBJ_UNIT_USERDEF_DOCUMENT,
-                                              key_type, value_type, max_n_subrecs);
+                                              key_type, value_type,
+                                              max_n_subrecs, group_flags);
   }
+  return res;
+}
+
+grn_obj *
+grn_table_create_for_group(grn_ctx *ctx, const char *name,
+                           unsigned int name_size, const char *path,
+                           grn_obj *group_key, grn_obj *value_type,
+                           unsigned int max_n_subrecs)
+{
+  grn_obj *res = NULL;
+  GRN_API_ENTER;
+  res = grn_table_create_for_group_(ctx, name, name_size, path,
+                                    group_key, value_type, max_n_subrecs, 0);
   GRN_API_RETURN(res);
 }
 
@@ -1508,6 +1590,83 @@ clear_column_values(grn_ctx *ctx, grn_obj *table, grn_id rid)
   }
 }
 
+static grn_bool
+grn_table_related_tables_include(grn_obj *tables, grn_id id)
+{
+  int i, n = GRN_BULK_VSIZE(tables) / sizeof(grn_id);
+  for (i = 0; i < n; i++) {
+    if (GRN_RECORD_VALUE_AT(tables, i) == id) { return GRN_TRUE; }
+  }
+  return GRN_FALSE;
+}
+
+static void
+grn_table_related_tables_add(grn_ctx *ctx, grn_obj *tables, grn_id id)
+{
+  grn_obj *table;
+  grn_hash *columns;
+
+  if (id == GRN_ID_NIL || (id & GRN_OBJ_TMP_OBJECT)) { return; }
+  if (grn_table_related_tables_include(tables, id)) { return; }
+  table = grn_ctx_at(ctx, id);
+  if (!table || !GRN_OBJ_TABLEP(table)) { return; }
+  GRN_RECORD_PUT(ctx, tables, id);
+
+  grn_table_related_tables_add(ctx, tables, table->header.domain);
+  if ((columns = grn_hash_create(ctx, NULL, sizeof(grn_id), 0,
+                                 GRN_OBJ_TABLE_HASH_KEY|GRN_HASH_TINY))) {
+    if (grn_table_columns(ctx, table, "", 0, (grn_obj *)columns)) {
+      grn_id *key;
+      GRN_HASH_EACH(ctx, columns, column_id, &key, NULL, NULL, {
+        grn_obj *column = grn_ctx_at(ctx, *key);
+        if (column) {
+          grn_hook *hooks;
+          grn_table_related_tables_add(ctx, tables, DB_OBJ(column)->range);
+          for (hooks = DB_OBJ(column)->hooks[GRN_HOOK_SET];
+               hooks;
+               hooks = hooks->next) {
+            default_set_value_hook_data *data = (void *)NEXT_ADDR(hooks);
+            grn_obj *target = grn_ctx_at(ctx, data->target);
+            if (target && target->header.type == GRN_COLUMN_INDEX) {
+              grn_table_related_tables_add(ctx, tables,
+                                           target->header.domain);
+            }
+          }
+        }
+      });
+    }
+    grn_hash_close(ctx, columns);
+  }
+}
+
+/* It appends IDs of table and tables whose records can change the
+   records of table: key and column value types, recursively, and
+   lexicons of indexes for its columns. */
+void
+grn_table_get_related_tables(grn_ctx *ctx, grn_obj *table, grn_obj *tables)
+{
+  if (table && GRN_DB_OBJP(table)) {
+    grn_table_related_tables_add(ctx, tables, DB_OBJ(table)->id);
+  }
+}
+
+void
+grn_table_touch_related_tables(grn_ctx *ctx, grn_obj *table)
+{
+  grn_obj tables;
+  grn_timeval tv;
+  int i, n;
+
+  GRN_RECORD_INIT(&tables, GRN_OBJ_VECTOR, GRN_ID_NIL);
+  grn_table_get_related_tables(ctx, table, &tables);
+  grn_timeval_now(ctx, &tv);
+  n = GRN_BULK_VSIZE(&tables) / sizeof(grn_id);
+  for (i = 0; i < n; i++) {
+    grn_obj_touch(ctx, grn_ctx_at(ctx, GRN_RECORD_VALUE_AT(&tables, i)), &tv);
+  }
+  GRN_OBJ_FIN(ctx, &tables);
+}
+
 static void
 delete_reference_records_in_index(grn_ctx *ctx, grn_obj *table, grn_id id,
                                   grn_obj *index)
@@ -2052,6 +2211,182 @@ grn_table_add_subrec(grn_obj *table, grn_rset_recinfo *ri, int score,
   grn_table_add_subrec_inline(table, ri, score, pi, dir);
 }
 
+uint32_t
+grn_rset_recinfo_calc_values_size(grn_ctx *ctx, grn_table_group_flags flags)
+{
+  uint32_t size = 0;
+
+  if (flags & GRN_TABLE_GROUP_CALC_MAX) {
+    size += GRN_RSET_MAX_SIZE;
+  }
+  if (flags & GRN_TABLE_GROUP_CALC_MIN) {
+    size += GRN_RSET_MIN_SIZE;
+  }
+  if (flags & GRN_TABLE_GROUP_CALC_SUM) {
+    size += GRN_RSET_SUM_SIZE;
+  }
+  if (flags & GRN_TABLE_GROUP_CALC_AVG) {
+    size += GRN_RSET_AVG_SIZE;
+  }
+
+  return size;
+}
+
+/* Aggregated values are stored after subrecs in MAX, MIN, SUM, AVG
+   order. Only values for flags specified on creation are stored. */
+static byte *
+grn_rset_recinfo_get_calc_value_(grn_ctx *ctx, grn_rset_recinfo *ri,
+                                 grn_obj *table, grn_table_group_flags flag)
+{
+  grn_db_obj *db_obj = DB_OBJ(table);
+  grn_table_group_flags flags = db_obj->group_flags;
+  uint32_t max_n_subrecs = db_obj->max_n_subrecs;
+  byte *value;
+
+  if (!(flags & flag)) {
+    return NULL;
+  }
+
+  value = (byte *)GRN_RSET_SUBRECS_NTH(ri->subrecs,
+                                       db_obj->subrec_size,
+                                       max_n_subrecs);
+  if (flag == GRN_TABLE_GROUP_CALC_MAX) {
+    return value;
+  }
+  if (flags & GRN_TABLE_GROUP_CALC_MAX) {
+    value += GRN_RSET_MAX_SIZE;
+  }
+  if (flag == GRN_TABLE_GROUP_CALC_MIN) {
+    return value;
+  }
+  if (flags & GRN_TABLE_GROUP_CALC_MIN) {
+    value += GRN_RSET_MIN_SIZE;
+  }
+  if (flag == GRN_TABLE_GROUP_CALC_SUM) {
+    return value;
+  }
+  if (flags & GRN_TABLE_GROUP_CALC_SUM) {
+    value += GRN_RSET_SUM_SIZE;
+  }
+  return value;
+}
+
+int64_t *
+grn_rset_recinfo_get_max_(grn_ctx *ctx, grn_rset_recinfo *ri, grn_obj *table)
+{
+  return (int64_t *)grn_rset_recinfo_get_calc_value_(ctx, ri, table,
+                                                     GRN_TABLE_GROUP_CALC_MAX);
+}
+
+int64_t *
+grn_rset_recinfo_get_min_(grn_ctx *ctx, grn_rset_recinfo *ri, grn_obj *table)
+{
+  return (int64_t *)grn_rset_recinfo_get_calc_value_(ctx, ri, table,
+                                                     GRN_TABLE_GROUP_CALC_MIN);
+}
+
+int64_t *
+grn_rset_recinfo_get_sum_(grn_ctx *ctx, grn_rset_recinfo *ri, grn_obj *table)
+{
+  return (int64_t *)grn_rset_recinfo_get_calc_value_(ctx, ri, table,
+                                                     GRN_TABLE_GROUP_CALC_SUM);
+}
+
+double *
+grn_rset_recinfo_get_avg_(grn_ctx *ctx, grn_rset_recinfo *ri, grn_obj *table)
+{
+  return (double *)grn_rset_recinfo_get_calc_value_(ctx, ri, table,
+                                                    GRN_TABLE_GROUP_CALC_AVG);
+}
+
+/* It must be called after the subrec for value is added to ri. */
+void
+grn_rset_recinfo_update_calc_values(grn_ctx *ctx, grn_rset_recinfo *ri,
+                                    grn_obj *table, grn_obj *value)
+{
+  grn_table_group_flags flags = DB_OBJ(table)->group_flags;
+  int n_subrecs = GRN_RSET_N_SUBRECS(ri);
+  int64_t int_value = 0;
+  double float_value = 0.0;
+
+  if (!(flags & GRN_TABLE_GROUP_CALC_AGGREGATORS)) {
+    return;
+  }
+
+  if (GRN_BULK_VSIZE(value) > 0) {
+    switch (value->header.domain) {
+    case GRN_DB_INT8 :
+      int_value = GRN_INT8_VALUE(value);
+      float_value = int_value;
+      break;
+    case GRN_DB_UINT8 :
+      int_value = GRN_UINT8_VALUE(value);
+      float_value = int_value;
+      break;
+    case GRN_DB_INT16 :
+      int_value = GRN_INT16_VALUE(value);
+      float_value = int_value;
+      break;
+    case GRN_DB_UINT16 :
+      int_value = GRN_UINT16_VALUE(value);
+      float_value = int_value;
+      break;
+    case GRN_DB_INT32 :
+      int_value = GRN_INT32_VALUE(value);
+      float_value = int_value;
+      break;
+    case GRN_DB_UINT32 :
+      int_value = GRN_UINT32_VALUE(value);
+      float_value = int_value;
+      break;
+    case GRN_DB_INT64 :
+    case GRN_DB_TIME :
+      int_value = GRN_INT64_VALUE(value);
+      float_value = int_value;
+      break;
+    case GRN_DB_UINT64 :
+      int_value = (int64_t)GRN_UINT64_VALUE(value);
+      float_value = (double)GRN_UINT64_VALUE(value);
+      break;
+    case GRN_DB_FLOAT :
+      float_value = GRN_FLOAT_VALUE(value);
+      int_value = (int64_t)float_value;
+      break;
+    default :
+      break;
+    }
+  }
+
+  if (flags & GRN_TABLE_GROUP_CALC_MAX) {
+    int64_t *max = grn_rset_recinfo_get_max_(ctx, ri, table);
+    if (n_subrecs == 1 || int_value > *max) {
+      *max = int_value;
+    }
+  }
+  if (flags & GRN_TABLE_GROUP_CALC_MIN) {
+    int64_t *min = grn_rset_recinfo_get_min_(ctx, ri, table);
+    if (n_subrecs == 1 || int_value < *min) {
+      *min = int_value;
+    }
+  }
+  if (flags & GRN_TABLE_GROUP_CALC_SUM) {
+    int64_t *sum = grn_rset_recinfo_get_sum_(ctx, ri, table);
+    if (n_subrecs == 1) {
+      *sum = int_value;
+    } else {
+      *sum += int_value;
+    }
+  }
+  if (flags & GRN_TABLE_GROUP_CALC_AVG) {
+    double *avg = grn_rset_recinfo_get_avg_(ctx, ri, table);
+    if (n_subrecs == 1) {
+      *avg = float_value;
+    } else {
+      *avg += (float_value - *avg) / n_subrecs;
+    }
+  }
+}
+
 grn_table_cursor *
 grn_table_cursor_open(grn_ctx *ctx, grn_obj *table,
                       const void *min, unsigned int min_size,
@@ -2639,6 +2974,30 @@ grn_table_next(grn_ctx *ctx, grn_obj *table, grn_id id)
   GRN_API_RETURN(r);
 }
 
+grn_id
+grn_table_curr_id(grn_ctx *ctx, grn_obj *table)
+{
+  grn_id id = GRN_ID_NIL;
+  GRN_API_ENTER;
+  if (table) {
+    switch (table->header.type) {
+    case GRN_TABLE_PAT_KEY :
+      id = grn_pat_curr_id(ctx, (grn_pat *)table);
+      break;
+    case GRN_TABLE_DAT_KEY :
+      id = grn_dat_curr_id(ctx, (grn_dat *)table);
+      break;
+    case GRN_TABLE_HASH_KEY :
+      id = grn_hash_curr_id(ctx, (grn_hash *)table);
+      break;
+    case GRN_TABLE_NO_KEY :
+      id = grn_array_curr_id(ctx, (grn_array *)table);
+      break;
+    }
+  }
+  GRN_API_RETURN(id);
+}
+
 grn_rc
 grn_accessor_resolve(grn_ctx *ctx, grn_obj *accessor, int deep,
                      grn_obj *base_res, grn_obj **res,
@@ -3296,6 +3655,78 @@ grn_table_group_with_range_gap(grn_ctx *ctx, grn_obj *table,
   return 0;
 }
 
+static inline void
+grn_table_group_add_subrec(grn_ctx *ctx,
+                           grn_obj *table,
+                           grn_rset_recinfo *ri, int score,
+                           grn_rset_posinfo *pi, int dir,
+                           grn_obj *calc_target,
+                           grn_obj *value_buffer)
+{
+  grn_table_add_subrec_inline(table, ri, score, pi, dir);
+  if (calc_target) {
+    GRN_BULK_REWIND(value_buffer);
+    grn_obj_get_value(ctx, calc_target, pi->rid, value_buffer);
+    grn_rset_recinfo_update_calc_values(ctx, ri, table, value_buffer);
+  }
+}
+
+static void
+grn_table_group_add_key(grn_ctx *ctx, grn_id id, grn_rset_recinfo *ri,
+                        grn_obj *key, grn_bool idp,
+                        grn_table_group_result *result,
+                        grn_obj *value_buffer)
+{
+  void *value;
+  grn_obj *calc_target = NULL;
+  if (result->flags & GRN_TABLE_GROUP_CALC_AGGREGATORS) {
+    calc_target = result->calc_target;
+  }
+  switch (key->header.type) {
+  case GRN_UVECTOR :
+    {
+      // todo : support objects except grn_id
+      grn_id *v = (grn_id *)GRN_BULK_HEAD(key);
+      grn_id *ve = (grn_id *)GRN_BULK_CURR(key);
+      while (v < ve) {
+        if ((*v != GRN_ID_NIL) &&
+            grn_table_add_v_inline(ctx, result->table, v, sizeof(grn_id), &value, NULL)) {
+          grn_table_group_add_subrec(ctx, result->table, value, ri ? ri->score : 0,
+                                     (grn_rset_posinfo *)&id, 0,
+                                     calc_target, value_buffer);
+        }
+        v++;
+      }
+    }
+    break;
+  case GRN_VECTOR :
+    ERR(GRN_OPERATION_NOT_SUPPORTED, "sorry.. not implemented yet");
+    /* todo */
+    break;
+  case GRN_BULK :
+    {
+      if ((!idp || *((grn_id *)GRN_BULK_HEAD(key))) &&
+          grn_table_add_v_inline(ctx, result->table,
+                                 GRN_BULK_HEAD(key), GRN_BULK_VSIZE(key), &value, NULL)) {
+        grn_table_group_add_subrec(ctx, result->table, value, ri ? ri->score : 0,
+                                   (grn_rset_posinfo *)&id, 0,
+                                   calc_target, value_buffer);
+      }
+    }
+    break;
+  default :
+    ERR(GRN_INVALID_ARGUMENT, "invalid column");
+    break;
+  }
+}
+
+static grn_bool
+grn_table_group_key_is_reference(grn_ctx *ctx, grn_obj *key)
+{
+  grn_obj *range = grn_ctx_at(ctx, grn_obj_get_range(ctx, key));
+  return GRN_OBJ_TABLEP(range);
+}
+
 grn_rc
 grn_table_group(grn_ctx *ctx, grn_obj *table,
                 grn_table_sort_key *keys, int n_keys,
@@ -3309,8 +3740,8 @@ grn_table_group(grn_ctx *ctx, grn_obj *table,
   GRN_API_ENTER;
   {
     int k, r;
-    void *key;
     grn_obj bulk;
+    grn_obj value_buffer;
     grn_table_cursor *tc;
     grn_table_sort_key *kp;
     grn_table_group_result *rp;
@@ -3321,103 +3752,197 @@ grn_table_group(grn_ctx *ctx, grn_obj *table,
       }
     }
     for (r = 0, rp = results; r < n_results; r++, rp++) {
+      grn_table_group_flags calc_flags;
+      calc_flags = rp->flags & GRN_TABLE_GROUP_CALC_AGGREGATORS;
+      if (rp->key_begin >= n_keys) {
+        ERR(GRN_INVALID_ARGUMENT, "invalid key range in (%d)", r);
+        goto exit;
+      }
+      if (calc_flags && !rp->calc_target) {
+        ERR(GRN_INVALID_ARGUMENT, "calc target missing in (%d)", r);
+        goto exit;
+      }
       if (!rp->table) {
-        ERR(GRN_INVALID_ARGUMENT, "table missing in (%d)", r);
+        int key_end = rp->key_end >= n_keys ? n_keys : rp->key_end;
+        if (key_end - rp->key_begin > 1) {
+          ERR(GRN_INVALID_ARGUMENT, "table missing in (%d)", r);
+          goto exit;
+        }
+        rp->table = grn_table_create_for_group_(ctx, NULL, 0, NULL,
+                                                keys[rp->key_begin].key, table,
+                                                0, calc_flags);
+        if (!rp->table) {
+          ERR(GRN_INVALID_ARGUMENT,
+              "failed to create table for group in (%d)", r);
+          goto exit;
+        }
+      } else if ((DB_OBJ(rp->table)->group_flags & calc_flags) != calc_flags) {
+        ERR(GRN_INVALID_ARGUMENT,
+            "table isn't created for calc values in (%d)", r);
         goto exit;
       }
     }
     GRN_TEXT_INIT(&bulk, 0);
+    GRN_VOID_INIT(&value_buffer);
     if (n_keys == 1 && n_results == 1) {
-      if (!accelerated_table_group(ctx, table, keys->key, results->table)) {
+      if ((results->flags & GRN_TABLE_GROUP_CALC_AGGREGATORS) ||
+          !accelerated_table_group(ctx, table, keys->key, results->table)) {
         if ((tc = grn_table_cursor_open(ctx, table, NULL, 0, NULL, 0, 0, -1, 0))) {
           grn_id id;
-          grn_obj *range = grn_ctx_at(ctx, grn_obj_get_range(ctx, keys->key));
-          int idp = GRN_OBJ_TABLEP(range);
+          grn_bool idp = grn_table_group_key_is_reference(ctx, keys->key);
           while ((id = grn_table_cursor_next_inline(ctx, tc))) {
-            void *value;
             grn_rset_recinfo *ri = NULL;
             GRN_BULK_REWIND(&bulk);
             if (DB_OBJ(table)->header.flags & GRN_OBJ_WITH_SUBREC) {
               grn_table_cursor_get_value_inline(ctx, tc, (void **)&ri);
             }
             grn_obj_get_value(ctx, keys->key, id, &bulk);
-            switch (bulk.header.type) {
-            case GRN_UVECTOR :
-              {
-                // todo : support objects except grn_id
-                grn_id *v = (grn_id *)GRN_BULK_HEAD(&bulk);
-                grn_id *ve = (grn_id *)GRN_BULK_CURR(&bulk);
-                while (v < ve) {
-                  if ((*v != GRN_ID_NIL) &&
-                      grn_table_add_v_inline(ctx, results->table, v, sizeof(grn_id), &value, NULL)) {
-                    grn_table_add_subrec_inline(results->table, value, ri ? ri->score : 0,
-                                                (grn_rset_posinfo *)&id, 0);
-                  }
-                  v++;
-                }
-              }
-              break;
-            case GRN_VECTOR :
-              ERR(GRN_OPERATION_NOT_SUPPORTED, "sorry.. not implemented yet");
-              /* todo */
-              break;
-            case GRN_BULK :
-              {
-                if ((!idp || *((grn_id *)GRN_BULK_HEAD(&bulk))) &&
-                    grn_table_add_v_inline(ctx, results->table,
-                                           GRN_BULK_HEAD(&bulk), GRN_BULK_VSIZE(&bulk), &value, NULL)) {
-                  grn_table_add_subrec_inline(results->table, value, ri ? ri->score : 0,
-                                              (grn_rset_posinfo *)&id, 0);
-                }
-              }
-              break;
-            default :
-              ERR(GRN_INVALID_ARGUMENT, "invalid column");
-              break;
-            }
+            grn_table_group_add_key(ctx, id, ri, &bulk, idp, results,
+                                    &value_buffer);
           }
           grn_table_cursor_close(ctx, tc);
         }
       }
     } else {
-      if ((tc = grn_table_cursor_open(ctx, table, NULL, 0, NULL, 0, 0, -1, 0))) {
-        grn_id id;
-        while ((id = grn_table_cursor_next_inline(ctx, tc))) {
-          grn_rset_recinfo *ri = NULL;
-          GRN_BULK_REWIND(&bulk);
-          if (DB_OBJ(table)->header.flags & GRN_OBJ_WITH_SUBREC) {
-            grn_table_cursor_get_value_inline(ctx, tc, (void **)&ri);
-          }
-          for (k = 0, kp = keys; k < n_keys; k++, kp++) {
-            kp->offset = GRN_BULK_VSIZE(&bulk);
-            grn_obj_get_value(ctx, kp->key, id, &bulk);
-          }
-          for (r = 0, rp = results; r < n_results; r++, rp++) {
-            void *value;
-            int begin = keys[rp->key_begin].offset;
-            int end = rp->key_end >= n_keys
-              ? GRN_BULK_VSIZE(&bulk)
-              : keys[rp->key_end].offset;
-            key = GRN_BULK_HEAD(&bulk) + begin;
-            // todo : cut off GRN_ID_NIL
-            if (grn_table_add_v_inline(ctx, rp->table, key, end - begin, &value, NULL)) {
-              grn_table_add_subrec_inline(rp->table, value, ri ? ri->score : 0,
-                                          (grn_rset_posinfo *)&id, 0);
-            }
-          }
+      /* All keys are fetched once per record and shared by all results. */
+      grn_obj *key_buffers;
+      grn_bool *idps;
+      key_buffers = GRN_MALLOCN(grn_obj, n_keys);
+      idps = GRN_MALLOCN(grn_bool, n_keys);
+      if (key_buffers && idps) {
+        for (k = 0, kp = keys; k < n_keys; k++, kp++) {
+          GRN_TEXT_INIT(&key_buffers[k], 0);
+          idps[k] = grn_table_group_key_is_reference(ctx, kp->key);
         }
-        grn_table_cursor_close(ctx, tc);
-      }
-    }
-    grn_obj_close(ctx, &bulk);
-    for (r = 0, rp = results; r < n_results; r++, rp++) {
-      GRN_TABLE_GROUPED_ON(rp->table);
-    }
-  }
-exit :
+        if ((tc = grn_table_cursor_open(ctx, table, NULL, 0, NULL, 0, 0, -1, 0))) {
+          grn_id id;
+          while ((id = grn_table_cursor_next_inline(ctx, tc))) {
+            grn_rset_recinfo *ri = NULL;
+            if (DB_OBJ(table)->header.flags & GRN_OBJ_WITH_SUBREC) {
+              grn_table_cursor_get_value_inline(ctx, tc, (void **)&ri);
+            }
+            for (k = 0, kp = keys; k < n_keys; k++, kp++) {
+              GRN_BULK_REWIND(&key_buffers[k]);
+              grn_obj_get_value(ctx, kp->key, id, &key_buffers[k]);
+            }
+            for (r = 0, rp = results; r < n_results; r++, rp++) {
+              void *value;
+              int begin = rp->key_begin;
+              int end = rp->key_end >= n_keys ? n_keys : rp->key_end;
+              grn_obj *calc_target = NULL;
+              if (end - begin <= 1) {
+                grn_table_group_add_key(ctx, id, ri,
+                                        &key_buffers[begin], idps[begin], rp,
+                                        &value_buffer);
+                continue;
+              }
+              GRN_BULK_REWIND(&bulk);
+              for (k = begin; k < end; k++) {
+                GRN_TEXT_PUT(ctx, &bulk,
+                             GRN_BULK_HEAD(&key_buffers[k]),
+                             GRN_BULK_VSIZE(&key_buffers[k]));
+              }
+              if (rp->flags & GRN_TABLE_GROUP_CALC_AGGREGATORS) {
+                calc_target = rp->calc_target;
+              }
+              // todo : cut off GRN_ID_NIL
+              if (grn_table_add_v_inline(ctx, rp->table,
+                                         GRN_BULK_HEAD(&bulk),
+                                         GRN_BULK_VSIZE(&bulk),
+                                         &value, NULL)) {
+                grn_table_group_add_subrec(ctx, rp->table, value,
+                                           ri ? ri->score : 0,
+                                           (grn_rset_posinfo *)&id, 0,
+                                           calc_target, &value_buffer);
+              }
+            }
+          }
+          grn_table_cursor_close(ctx, tc);
+        }
+        for (k = 0; k < n_keys; k++) {
+          GRN_OBJ_FIN(ctx, &key_buffers[k]);
+        }
+      }
+      if (key_buffers) { GRN_FREE(key_buffers); }
+      if (idps) { GRN_FREE(idps); }
+    }
+    GRN_OBJ_FIN(ctx, &value_buffer);
+    grn_obj_close(ctx, &bulk);
+    for (r = 0, rp = results; r < n_results; r++, rp++) {
+      GRN_TABLE_GROUPED_ON(rp->table);
+    }
+  }
+exit :
+  rc = ctx->rc;
   GRN_API_RETURN(rc);
 }
 
+#define SETOPERATION_BITMAP_MIN_N_RECORDS 1024
+#define SETOPERATION_BITMAP_MAX_SPARSITY  64
+
+/*
+ * Result sets of a table are hashes keyed by record IDs of the table.
+ * When a set is large compared to the table, a bitmap of its record IDs
+ * answers membership tests without hashing keys. It returns NULL when
+ * table1 and table2 aren't such sets or the IDs are too sparse.
+ */
+static uint8_t *
+grn_table_setoperation_bitmap_open(grn_ctx *ctx,
+                                   grn_obj *table1, grn_obj *table2,
+                                   grn_id *max_id)
+{
+  grn_hash *hash1 = (grn_hash *)table1;
+  grn_hash *hash2 = (grn_hash *)table2;
+  grn_obj *domain;
+  uint8_t *bitmap;
+  grn_bool in_range = GRN_TRUE;
+
+  if (table1->header.type != GRN_TABLE_HASH_KEY ||
+      table2->header.type != GRN_TABLE_HASH_KEY) {
+    return NULL;
+  }
+  if ((table1->header.flags & GRN_OBJ_KEY_VAR_SIZE) ||
+      (table2->header.flags & GRN_OBJ_KEY_VAR_SIZE) ||
+      hash1->key_size != sizeof(grn_id) ||
+      hash2->key_size != sizeof(grn_id)) {
+    return NULL;
+  }
+  if (table1->header.domain != table2->header.domain) {
+    return NULL;
+  }
+  if (GRN_HASH_SIZE(hash2) < SETOPERATION_BITMAP_MIN_N_RECORDS) {
+    return NULL;
+  }
+  domain = grn_ctx_at(ctx, table1->header.domain);
+  if (!domain || !GRN_OBJ_TABLEP(domain)) {
+    return NULL;
+  }
+  *max_id = grn_table_curr_id(ctx, domain);
+  if (*max_id == GRN_ID_NIL ||
+      *max_id / SETOPERATION_BITMAP_MAX_SPARSITY > GRN_HASH_SIZE(hash2)) {
+    return NULL;
+  }
+  bitmap = GRN_CALLOC((*max_id >> 3) + 1);
+  if (!bitmap) {
+    return NULL;
+  }
+  {
+    grn_id *key;
+    GRN_HASH_EACH(ctx, hash2, id, &key, NULL, NULL, {
+      if (*key > *max_id) {
+        in_range = GRN_FALSE;
+        break;
+      }
+      bitmap[*key >> 3] |= 1 << (*key & 7);
+    });
+  }
+  if (!in_range) {
+    GRN_FREE(bitmap);
+    return NULL;
+  }
+  return bitmap;
+}
+
 grn_rc
 grn_table_setoperation(grn_ctx *ctx, grn_obj *table1, grn_obj *table2, grn_obj *res,
                        grn_operator op)
@@ -3427,6 +3952,8 @@ grn_table_setoperation(grn_ctx *ctx, grn_obj *table1, grn_obj *table2, grn_obj *
   uint32_t value_size = 0;
   uint32_t key_size = 0;
   grn_bool have_subrec;
+  uint8_t *bitmap;
+  grn_id max_id;
   if (table1 != res) {
     if (table2 == res) {
       grn_obj *t = table1;
@@ -3515,9 +4042,22 @@ grn_table_setoperation(grn_ctx *ctx, grn_obj *table1, grn_obj *table2, grn_obj *
     }
     break;
   case GRN_OP_AND_NOT :
-    GRN_TABLE_EACH(ctx, table2, 0, 0, id, &key, &key_size, &value2, {
-      grn_table_delete(ctx, table1, key, key_size);
-    });
+    if (grn_table_size(ctx, table2) > grn_table_size(ctx, table1) &&
+        (bitmap = grn_table_setoperation_bitmap_open(ctx, table1, table2,
+                                                     &max_id))) {
+      GRN_HASH_EACH(ctx, (grn_hash *)table1, id, &key, NULL, NULL, {
+        grn_id record_id = *((grn_id *)key);
+        if (record_id <= max_id &&
+            (bitmap[record_id >> 3] & (1 << (record_id & 7)))) {
+          _grn_table_delete_by_id(ctx, table1, id, NULL);
+        }
+      });
+      GRN_FREE(bitmap);
+    } else {
+      GRN_TABLE_EACH(ctx, table2, 0, 0, id, &key, &key_size, &value2, {
+        grn_table_delete(ctx, table1, key, key_size);
+      });
+    }
     break;
   case GRN_OP_ADJUST :
     GRN_TABLE_EACH(ctx, table2, 0, 0, id, &key, &key_size, &value2, {
@@ -3653,6 +4193,33 @@ _grn_table_key(grn_ctx *ctx, grn_obj *table, grn_id id, uint32_t *key_size)
 
 /* column */
 
+static grn_bool
+grn_column_compress_support_p(grn_obj_flags flags)
+{
+  switch (flags & GRN_OBJ_COMPRESS_MASK) {
+  case GRN_OBJ_COMPRESS_NONE :
+    return GRN_TRUE;
+#ifdef GRN_WITH_ZLIB
+  case GRN_OBJ_COMPRESS_ZLIB :
+    return GRN_TRUE;
+#endif /* GRN_WITH_ZLIB */
+#ifdef GRN_WITH_LZO
+  case GRN_OBJ_COMPRESS_LZO :
+    return GRN_TRUE;
+#endif /* GRN_WITH_LZO */
+#ifdef GRN_WITH_LZ4
+  case GRN_OBJ_COMPRESS_LZ4 :
+    return GRN_TRUE;
+#endif /* GRN_WITH_LZ4 */
+#ifdef GRN_WITH_ZSTD
+  case GRN_OBJ_COMPRESS_ZSTD :
+    return GRN_TRUE;
+#endif /* GRN_WITH_ZSTD */
+  default :
+    return GRN_FALSE;
+  }
+}
+
 grn_obj *
 grn_column_create(grn_ctx *ctx, grn_obj *table,
                   const char *name, unsigned int name_size,
@@ -3666,7 +4233,6 @@ grn_column_create(grn_ctx *ctx, grn_obj *table,
   grn_id domain = GRN_ID_NIL;
   char fullname[GRN_TABLE_MAX_KEY_SIZE];
   char buffer[PATH_MAX];
-  grn_bool ja_p = GRN_FALSE;
   GRN_API_ENTER;
   if (!table) {
     ERR(GRN_INVALID_ARGUMENT, "[column][create] table is missing");
@@ -3782,19 +4348,28 @@ grn_column_create(grn_ctx *ctx, grn_obj *table,
       goto exit;
     }
   }
+  if ((flags & GRN_OBJ_COLUMN_TYPE_MASK) != GRN_OBJ_COLUMN_INDEX &&
+      !grn_column_compress_support_p(flags)) {
+    int table_name_len;
+    char table_name[GRN_TABLE_MAX_KEY_SIZE];
+    table_name_len = grn_obj_name(ctx, table, table_name,
+                                  GRN_TABLE_MAX_KEY_SIZE);
+    GRN_LOG(ctx, GRN_LOG_WARNING,
+            "[column][create] "
+            "unsupported compression is ignored: <%.*s>.<%.*s>",
+            table_name_len, table_name, name_size, name);
+    flags &= ~GRN_OBJ_COMPRESS_MASK;
+  }
   switch (flags & GRN_OBJ_COLUMN_TYPE_MASK) {
   case GRN_OBJ_COLUMN_SCALAR :
     if ((flags & GRN_OBJ_KEY_VAR_SIZE) || value_size > sizeof(int64_t)) {
       res = (grn_obj *)grn_ja_create(ctx, path, value_size, flags);
-      ja_p = GRN_TRUE;
     } else {
       res = (grn_obj *)grn_ra_create(ctx, path, value_size);
     }
     break;
   case GRN_OBJ_COLUMN_VECTOR :
     res = (grn_obj *)grn_ja_create(ctx, path, value_size * 30/*todo*/, flags);
-    ja_p = GRN_TRUE;
-    //todo : zlib support
     break;
   case GRN_OBJ_COLUMN_INDEX :
     res = (grn_obj *)grn_ii_create(ctx, path, table, flags); //todo : ii layout support
@@ -3806,31 +4381,6 @@ grn_column_create(grn_ctx *ctx, grn_obj *table,
     DB_OBJ(res)->range = range;
     DB_OBJ(res)->header.flags = flags;
     res->header.flags = flags;
-    if (ja_p) {
-      grn_bool zlib_p = GRN_FALSE;
-      grn_bool lzo_p = GRN_FALSE;
-#ifdef GRN_WITH_ZLIB
-      if (flags & GRN_OBJ_COMPRESS_ZLIB) {
-        zlib_p = GRN_TRUE;
-      }
-#endif /* GRN_WITH_ZLIB */
-#ifdef GRN_WITH_LZO
-      if (flags & GRN_OBJ_COMPRESS_LZO) {
-        lzo_p = GRN_TRUE;
-      }
-#endif /* GRN_WITH_LZO */
-      if (zlib_p || lzo_p) {
-        int table_name_len;
-        char table_name[GRN_TABLE_MAX_KEY_SIZE];
-        table_name_len = grn_obj_name(ctx, table, table_name,
-                                      GRN_TABLE_MAX_KEY_SIZE);
-        GRN_LOG(ctx, GRN_LOG_WARNING,
-                "[column][create] "
-                "%s compressed column will leaks memories: <%.*s>.<%.*s>",
-                zlib_p ? "zlib" : "lzo",
-                table_name_len, table_name, name_size, name);
-      }
-    }
     if (grn_db_obj_init(ctx, db, id, DB_OBJ(res))) {
       _grn_obj_remove(ctx, res);
       res = NULL;
@@ -4235,6 +4785,46 @@ accessor_new(grn_ctx *ctx)
   return res;
 }
 
+static grn_accessor *
+grn_obj_get_accessor_calc_value(grn_ctx *ctx, grn_obj *obj, uint8_t action,
+                                grn_table_group_flags flag)
+{
+  grn_accessor *res = NULL, **rp;
+  for (rp = &res; ; rp = &(*rp)->next) {
+    *rp = accessor_new(ctx);
+    (*rp)->obj = obj;
+    if (GRN_TABLE_IS_GROUPED(obj)) {
+      if (!(DB_OBJ(obj)->group_flags & flag)) {
+        break;
+      }
+      (*rp)->action = action;
+      return res;
+    }
+    switch (obj->header.type) {
+    case GRN_TABLE_PAT_KEY :
+    case GRN_TABLE_DAT_KEY :
+    case GRN_TABLE_HASH_KEY :
+      (*rp)->action = GRN_ACCESSOR_GET_KEY;
+      break;
+    case GRN_TABLE_NO_KEY :
+      if (obj->header.domain) {
+        (*rp)->action = GRN_ACCESSOR_GET_VALUE;
+        break;
+      }
+      /* fallthru */
+    default :
+      /* lookup failed */
+      grn_obj_close(ctx, (grn_obj *)res);
+      return NULL;
+    }
+    if (!(obj = grn_ctx_at(ctx, obj->header.domain))) {
+      break;
+    }
+  }
+  grn_obj_close(ctx, (grn_obj *)res);
+  return NULL;
+}
+
 static grn_obj *
 grn_obj_get_accessor(grn_ctx *ctx, grn_obj *obj, const char *name, unsigned int name_size)
 {
@@ -4256,6 +4846,14 @@ grn_obj_get_accessor(grn_ctx *ctx, grn_obj *obj, const char *name, unsigned int
     case GRN_ACCESSOR_GET_NSUBRECS :
       obj = grn_ctx_at(ctx, DB_OBJ(res->obj)->range);
       break;
+    case GRN_ACCESSOR_GET_MAX :
+    case GRN_ACCESSOR_GET_MIN :
+    case GRN_ACCESSOR_GET_SUM :
+      obj = grn_ctx_at(ctx, GRN_DB_INT64);
+      break;
+    case GRN_ACCESSOR_GET_AVG :
+      obj = grn_ctx_at(ctx, GRN_DB_FLOAT);
+      break;
     case GRN_ACCESSOR_GET_COLUMN_VALUE :
       obj = grn_ctx_at(ctx, DB_OBJ(res->obj)->range);
       break;
@@ -4417,7 +5015,15 @@ grn_obj_get_accessor(grn_ctx *ctx, grn_obj *obj, const char *name, unsigned int
           }
         }
         break;
-      case 's' : /* score */
+      case 's' : /* score, sum */
+        if (len == GRN_COLUMN_NAME_SUM_LEN &&
+            !memcmp(name, GRN_COLUMN_NAME_SUM, GRN_COLUMN_NAME_SUM_LEN)) {
+          res = grn_obj_get_accessor_calc_value(ctx, obj,
+                                                GRN_ACCESSOR_GET_SUM,
+                                                GRN_TABLE_GROUP_CALC_SUM);
+          if (!res) { goto exit; }
+          break;
+        }
         if (len != GRN_COLUMN_NAME_SCORE_LEN ||
             memcmp(name, GRN_COLUMN_NAME_SCORE, GRN_COLUMN_NAME_SCORE_LEN)) {
           goto exit;
@@ -4455,6 +5061,31 @@ grn_obj_get_accessor(grn_ctx *ctx, grn_obj *obj, const char *name, unsigned int
           }
         }
         break;
+      case 'm' : /* max, min */
+        if (len == GRN_COLUMN_NAME_MAX_LEN &&
+            !memcmp(name, GRN_COLUMN_NAME_MAX, GRN_COLUMN_NAME_MAX_LEN)) {
+          res = grn_obj_get_accessor_calc_value(ctx, obj,
+                                                GRN_ACCESSOR_GET_MAX,
+                                                GRN_TABLE_GROUP_CALC_MAX);
+        } else if (len == GRN_COLUMN_NAME_MIN_LEN &&
+                   !memcmp(name, GRN_COLUMN_NAME_MIN,
+                           GRN_COLUMN_NAME_MIN_LEN)) {
+          res = grn_obj_get_accessor_calc_value(ctx, obj,
+                                                GRN_ACCESSOR_GET_MIN,
+                                                GRN_TABLE_GROUP_CALC_MIN);
+        }
+        if (!res) { goto exit; }
+        break;
+      case 'a' : /* avg */
+        if (len != GRN_COLUMN_NAME_AVG_LEN ||
+            memcmp(name, GRN_COLUMN_NAME_AVG, GRN_COLUMN_NAME_AVG_LEN)) {
+          goto exit;
+        }
+        res = grn_obj_get_accessor_calc_value(ctx, obj,
+                                              GRN_ACCESSOR_GET_AVG,
+                                              GRN_TABLE_GROUP_CALC_AVG);
+        if (!res) { goto exit; }
+        break;
       case 'n' : /* nsubrecs */
         if (len != GRN_COLUMN_NAME_NSUBRECS_LEN ||
             memcmp(name,
@@ -4603,6 +5234,14 @@ grn_obj_get_range_info(grn_ctx *ctx, grn_obj *obj,
       case GRN_ACCESSOR_GET_NSUBRECS :
         *range_id = GRN_DB_INT32;
         break;
+      case GRN_ACCESSOR_GET_MAX :
+      case GRN_ACCESSOR_GET_MIN :
+      case GRN_ACCESSOR_GET_SUM :
+        *range_id = GRN_DB_INT64;
+        break;
+      case GRN_ACCESSOR_GET_AVG :
+        *range_id = GRN_DB_FLOAT;
+        break;
       case GRN_ACCESSOR_GET_COLUMN_VALUE :
         if (GRN_DB_OBJP(a->obj)) {
           *range_id = DB_OBJ(a->obj)->range;
@@ -4645,6 +5284,10 @@ grn_obj_is_persistent(grn_ctx *ctx, grn_obj *obj)
       switch (a->action) {
       case GRN_ACCESSOR_GET_SCORE :
       case GRN_ACCESSOR_GET_NSUBRECS :
+      case GRN_ACCESSOR_GET_MAX :
+      case GRN_ACCESSOR_GET_MIN :
+      case GRN_ACCESSOR_GET_SUM :
+      case GRN_ACCESSOR_GET_AVG :
         res = 0;
         break;
       case GRN_ACCESSOR_GET_ID :
@@ -5131,6 +5774,34 @@ grn_accessor_get_value_(grn_ctx *ctx, grn_accessor *a, grn_id id, uint32_t *size
         *size = sizeof(int);
       }
       break;
+    case GRN_ACCESSOR_GET_MAX :
+      if ((value = grn_obj_get_value_(ctx, a->obj, id, size))) {
+        value = (const char *)
+          grn_rset_recinfo_get_max_(ctx, (grn_rset_recinfo *)value, a->obj);
+        *size = GRN_RSET_MAX_SIZE;
+      }
+      break;
+    case GRN_ACCESSOR_GET_MIN :
+      if ((value = grn_obj_get_value_(ctx, a->obj, id, size))) {
+        value = (const char *)
+          grn_rset_recinfo_get_min_(ctx, (grn_rset_recinfo *)value, a->obj);
+        *size = GRN_RSET_MIN_SIZE;
+      }
+      break;
+    case GRN_ACCESSOR_GET_SUM :
+      if ((value = grn_obj_get_value_(ctx, a->obj, id, size))) {
+        value = (const char *)
+          grn_rset_recinfo_get_sum_(ctx, (grn_rset_recinfo *)value, a->obj);
+        *size = GRN_RSET_SUM_SIZE;
+      }
+      break;
+    case GRN_ACCESSOR_GET_AVG :
+      if ((value = grn_obj_get_value_(ctx, a->obj, id, size))) {
+        value = (const char *)
+          grn_rset_recinfo_get_avg_(ctx, (grn_rset_recinfo *)value, a->obj);
+        *size = GRN_RSET_AVG_SIZE;
+      }
+      break;
     case GRN_ACCESSOR_GET_COLUMN_VALUE :
       /* todo : support vector */
       value = grn_obj_get_value_(ctx, a->obj, id, size);
@@ -5197,6 +5868,34 @@ grn_accessor_get_value(grn_ctx *ctx, grn_accessor *a, grn_id id, grn_obj *value)
         GRN_INT32_PUT(ctx, value, ri->n_subrecs);
       }
       break;
+    case GRN_ACCESSOR_GET_MAX :
+      {
+        grn_rset_recinfo *ri = (grn_rset_recinfo *)grn_obj_get_value_(ctx, a->obj, id, &vs);
+        int64_t max = *grn_rset_recinfo_get_max_(ctx, ri, a->obj);
+        GRN_INT64_PUT(ctx, value, max);
+      }
+      break;
+    case GRN_ACCESSOR_GET_MIN :
+      {
+        grn_rset_recinfo *ri = (grn_rset_recinfo *)grn_obj_get_value_(ctx, a->obj, id, &vs);
+        int64_t min = *grn_rset_recinfo_get_min_(ctx, ri, a->obj);
+        GRN_INT64_PUT(ctx, value, min);
+      }
+      break;
+    case GRN_ACCESSOR_GET_SUM :
+      {
+        grn_rset_recinfo *ri = (grn_rset_recinfo *)grn_obj_get_value_(ctx, a->obj, id, &vs);
+        int64_t sum = *grn_rset_recinfo_get_sum_(ctx, ri, a->obj);
+        GRN_INT64_PUT(ctx, value, sum);
+      }
+      break;
+    case GRN_ACCESSOR_GET_AVG :
+      {
+        grn_rset_recinfo *ri = (grn_rset_recinfo *)grn_obj_get_value_(ctx, a->obj, id, &vs);
+        double avg = *grn_rset_recinfo_get_avg_(ctx, ri, a->obj);
+        GRN_FLOAT_PUT(ctx, value, avg);
+      }
+      break;
     case GRN_ACCESSOR_GET_COLUMN_VALUE :
       /* todo : support vector */
       grn_obj_get_value(ctx, a->obj, id, value);
@@ -5281,6 +5980,47 @@ grn_accessor_set_value(grn_ctx *ctx, grn_accessor *a, grn_id id,
           vp = &ri->n_subrecs;
         }
         break;
+      case GRN_ACCESSOR_GET_MAX :
+      case GRN_ACCESSOR_GET_MIN :
+      case GRN_ACCESSOR_GET_SUM :
+      case GRN_ACCESSOR_GET_AVG :
+        {
+          grn_rset_recinfo *ri;
+          uint32_t size;
+          if ((ri = (grn_rset_recinfo *)grn_obj_get_value_(ctx, a->obj, id,
+                                                           &size))) {
+            grn_id range;
+            switch (a->action) {
+            case GRN_ACCESSOR_GET_MAX :
+              vp = grn_rset_recinfo_get_max_(ctx, ri, a->obj);
+              break;
+            case GRN_ACCESSOR_GET_MIN :
+              vp = grn_rset_recinfo_get_min_(ctx, ri, a->obj);
+              break;
+            case GRN_ACCESSOR_GET_SUM :
+              vp = grn_rset_recinfo_get_sum_(ctx, ri, a->obj);
+              break;
+            default :
+              vp = grn_rset_recinfo_get_avg_(ctx, ri, a->obj);
+              break;
+            }
+            range = (a->action == GRN_ACCESSOR_GET_AVG) ?
+              GRN_DB_FLOAT : GRN_DB_INT64;
+            if (vp && !a->next) {
+              // todo : flags support
+              if (value->header.domain == range) {
+                memcpy(vp, GRN_BULK_HEAD(value), GRN_BULK_VSIZE(value));
+              } else {
+                grn_obj buf;
+                GRN_OBJ_INIT(&buf, GRN_BULK, 0, range);
+                grn_obj_cast(ctx, value, &buf, GRN_FALSE);
+                memcpy(vp, GRN_BULK_HEAD(&buf), GRN_BULK_VSIZE(&buf));
+                GRN_OBJ_FIN(ctx, &buf);
+              }
+            }
+          }
+        }
+        break;
       case GRN_ACCESSOR_GET_COLUMN_VALUE :
         /* todo : support vector */
         if (a->next) {
@@ -6002,6 +6742,12 @@ grn_obj_get_value_(grn_ctx *ctx, grn_obj *obj, grn_id id, uint32_t *size)
     {
       grn_io_win jw;
       if ((value = grn_ja_ref(ctx, (grn_ja *)obj, id, &jw, size))) {
+        /* The caller refers the value after unref. */
+        if (jw.uncompressed_value) {
+          GRN_PTR_PUT(ctx, &(ctx->impl->uncompressed_values),
+                      jw.uncompressed_value);
+          jw.uncompressed_value = NULL;
+        }
         grn_ja_unref(ctx, &jw);
       }
     }
@@ -6019,6 +6765,25 @@ grn_obj_get_value_(grn_ctx *ctx, grn_obj *obj, grn_id id, uint32_t *size)
   return value;
 }
 
+uint32_t
+grn_obj_get_values_mark_(grn_ctx *ctx)
+{
+  return GRN_BULK_VSIZE(&(ctx->impl->uncompressed_values)) / sizeof(void *);
+}
+
+void
+grn_obj_release_values_(grn_ctx *ctx, uint32_t mark)
+{
+  grn_obj *values = &(ctx->impl->uncompressed_values);
+  uint32_t i, n = GRN_BULK_VSIZE(values) / sizeof(void *);
+  for (i = mark; i < n; i++) {
+    GRN_FREE(GRN_PTR_VALUE_AT(values, i));
+  }
+  if (mark < n) {
+    grn_bulk_truncate(ctx, values, mark * sizeof(void *));
+  }
+}
+
 static void
 grn_obj_get_value_column_index_forward(grn_ctx *ctx, grn_obj *index_column,
                                        grn_id id, grn_obj *value)
@@ -6315,6 +7080,30 @@ grn_obj_get_info(grn_ctx *ctx, grn_obj *obj, grn_info_type type, grn_obj *valueb
     GRN_BOOL_PUT(ctx, valuebuf, GRN_FALSE);
 #endif /* GRN_WITH_LZO */
     break;
+  case GRN_INFO_SUPPORT_LZ4 :
+    if (!valuebuf && !(valuebuf = grn_obj_open(ctx, GRN_BULK, 0, GRN_DB_BOOL))) {
+      ERR(GRN_INVALID_ARGUMENT,
+          "failed to open value buffer for GRN_INFO_LZ4_SUPPORT");
+      goto exit;
+    }
+#ifdef GRN_WITH_LZ4
+    GRN_BOOL_PUT(ctx, valuebuf, GRN_TRUE);
+#else /* GRN_WITH_LZ4 */
+    GRN_BOOL_PUT(ctx, valuebuf, GRN_FALSE);
+#endif /* GRN_WITH_LZ4 */
+    break;
+  case GRN_INFO_SUPPORT_ZSTD :
+    if (!valuebuf && !(valuebuf = grn_obj_open(ctx, GRN_BULK, 0, GRN_DB_BOOL))) {
+      ERR(GRN_INVALID_ARGUMENT,
+          "failed to open value buffer for GRN_INFO_ZSTD_SUPPORT");
+      goto exit;
+    }
+#ifdef GRN_WITH_ZSTD
+    GRN_BOOL_PUT(ctx, valuebuf, GRN_TRUE);
+#else /* GRN_WITH_ZSTD */
+    GRN_BOOL_PUT(ctx, valuebuf, GRN_FALSE);
+#endif /* GRN_WITH_ZSTD */
+    break;
   default :
     if (!obj) {
       ERR(GRN_INVALID_ARGUMENT, "grn_obj_get_info failed");
@@ -7584,6 +8373,7 @@ grn_obj_rename(grn_ctx *ctx, grn_obj *obj, const char *name, unsigned int name_s
     grn_db *s = (grn_db *)ctx->impl->db;
     grn_obj *keys = (grn_obj *)s->keys;
     rc = grn_table_update_by_id(ctx, keys, DB_OBJ(obj)->id, name, name_size);
+    if (rc == GRN_SUCCESS) { grn_db_schema_changed((grn_obj *)s); }
   }
   GRN_API_RETURN(rc);
 }
@@ -7694,6 +8484,8 @@ grn_obj_register(grn_ctx *ctx, grn_obj *db, const char *name, unsigned int name_
       ERR(GRN_INVALID_ARGUMENT,
           "already used name was assigned: <%.*s>", name_size, name);
       id = GRN_ID_NIL;
+    } else {
+      grn_db_schema_changed(db);
     }
   } else if (ctx->impl && ctx->impl->values) {
     id = grn_array_add(ctx, ctx->impl->values, NULL) | GRN_OBJ_TMP_OBJECT;
@@ -7721,6 +8513,7 @@ grn_obj_delete_by_id(grn_ctx *ctx, grn_obj *db, grn_id id, grn_bool removep)
         vp->ptr = NULL;
         vp->done = 0;
       }
+      grn_db_schema_changed(db);
       if (removep) {
         switch (s->keys->header.type) {
         case GRN_TABLE_PAT_KEY :
@@ -7779,6 +8572,7 @@ grn_db_obj_init(grn_ctx *ctx, grn_obj *db, grn_id id, grn_db_obj *obj)
   obj->db = db;
   obj->source = NULL;
   obj->source_size = 0;
+  obj->group_flags = 0;
   {
     grn_hook_entry entry;
     for (entry = 0; entry < N_HOOK_ENTRIES; entry++) {
@@ -7808,6 +8602,7 @@ grn_db_obj_init(grn_ctx *ctx, grn_obj *db, grn_id id, grn_db_obj *obj)
     r->id = id;\
     r->range = spec->range;\
     r->db = (grn_obj *)s;\
+    r->group_flags = 0;\
     size = grn_vector_get_element(ctx, &v, 2, &p, NULL, NULL);\
     if (size) {\
       if ((r->source = GRN_MALLOC(size))) {\
@@ -8379,6 +9174,18 @@ grn_column_name(grn_ctx *ctx, grn_obj *obj, char *namebuf, int buf_size)
       case GRN_ACCESSOR_GET_NSUBRECS :
         name = GRN_COLUMN_NAME_NSUBRECS;
         break;
+      case GRN_ACCESSOR_GET_MAX :
+        name = GRN_COLUMN_NAME_MAX;
+        break;
+      case GRN_ACCESSOR_GET_MIN :
+        name = GRN_COLUMN_NAME_MIN;
+        break;
+      case GRN_ACCESSOR_GET_SUM :
+        name = GRN_COLUMN_NAME_SUM;
+        break;
+      case GRN_ACCESSOR_GET_AVG :
+        name = GRN_COLUMN_NAME_AVG;
+        break;
       case GRN_ACCESSOR_GET_COLUMN_VALUE :
       case GRN_ACCESSOR_GET_DB_OBJ :
       case GRN_ACCESSOR_LOOKUP :
@@ -8442,6 +9249,26 @@ grn_column_name_(grn_ctx *ctx, grn_obj *obj, grn_obj *buf)
                      GRN_COLUMN_NAME_NSUBRECS,
                      GRN_COLUMN_NAME_NSUBRECS_LEN);
         break;
+      case GRN_ACCESSOR_GET_MAX :
+        GRN_TEXT_PUT(ctx, buf,
+                     GRN_COLUMN_NAME_MAX,
+                     GRN_COLUMN_NAME_MAX_LEN);
+        break;
+      case GRN_ACCESSOR_GET_MIN :
+        GRN_TEXT_PUT(ctx, buf,
+                     GRN_COLUMN_NAME_MIN,
+                     GRN_COLUMN_NAME_MIN_LEN);
+        break;
+      case GRN_ACCESSOR_GET_SUM :
+        GRN_TEXT_PUT(ctx, buf,
+                     GRN_COLUMN_NAME_SUM,
+                     GRN_COLUMN_NAME_SUM_LEN);
+        break;
+      case GRN_ACCESSOR_GET_AVG :
+        GRN_TEXT_PUT(ctx, buf,
+                     GRN_COLUMN_NAME_AVG,
+                     GRN_COLUMN_NAME_AVG_LEN);
+        break;
       case GRN_ACCESSOR_GET_COLUMN_VALUE :
         grn_column_name_(ctx, a->obj, buf);
         if (a->next) { GRN_TEXT_PUTC(ctx, buf, '.'); }
@@ -8671,24 +9498,99 @@ enum {
     if (bs) {\
       type va = *((type *)(ap));\
       type vb = *((type *)(bp));\
-      if (va != vb) { return va > vb; }\
+      if (va != vb) { return va > vb ? 1 : -1; }\
     } else {\
       return 1;\
     }\
   } else {\
-    if (bs) { return 0; }\
+    if (bs) { return -1; }\
   }\
 } while (0)
 
+/* It returns a positive value if a should be placed after b, a
+   negative value if a should be placed before b and 0 if they are
+   equal. */
+inline static int
+compare_key_value(uint8_t type,
+                  const unsigned char *ap, uint32_t as,
+                  const unsigned char *bp, uint32_t bs)
+{
+  switch (type) {
+  case KEY_ID :
+    if (ap != bp) { return ap > bp ? 1 : -1; }
+    break;
+  case KEY_BULK :
+    for (;; ap++, bp++, as--, bs--) {
+      if (!as) { if (bs) { return -1; } else { break; } }
+      if (!bs) { return 1; }
+      if (*ap < *bp) { return -1; }
+      if (*ap > *bp) { return 1; }
+    }
+    break;
+  case KEY_INT8 :
+    CMPNUM(int8_t);
+    break;
+  case KEY_INT16 :
+    CMPNUM(int16_t);
+    break;
+  case KEY_INT32 :
+    CMPNUM(int32_t);
+    break;
+  case KEY_INT64 :
+    CMPNUM(int64_t);
+    break;
+  case KEY_UINT8 :
+    CMPNUM(uint8_t);
+    break;
+  case KEY_UINT16 :
+    CMPNUM(uint16_t);
+    break;
+  case KEY_UINT32 :
+    CMPNUM(uint32_t);
+    break;
+  case KEY_UINT64 :
+    CMPNUM(uint64_t);
+    break;
+  case KEY_FLOAT32 :
+    if (as) {
+      if (bs) {
+        float va = *((float *)(ap));
+        float vb = *((float *)(bp));
+        if (va < vb || va > vb) { return va > vb ? 1 : -1; }
+      } else {
+        return 1;
+      }
+    } else {
+      if (bs) { return -1; }
+    }
+    break;
+  case KEY_FLOAT64 :
+    if (as) {
+      if (bs) {
+        double va = *((double *)(ap));
+        double vb = *((double *)(bp));
+        if (va < vb || va > vb) { return va > vb ? 1 : -1; }
+      } else {
+        return 1;
+      }
+    } else {
+      if (bs) { return -1; }
+    }
+    break;
+  }
+  return 0;
+}
+
 inline static int
 compare_value(grn_ctx *ctx, sort_entry *a, sort_entry *b,
               grn_table_sort_key *keys, int n_keys)
 {
-  int i;
-  uint8_t type;
+  int i, result = 0;
   uint32_t as, bs;
   const unsigned char *ap, *bp;
+  uint32_t values_mark = grn_obj_get_values_mark_(ctx);
   for (i = 0; i < n_keys; i++, keys++) {
+    int cmp;
     if (i) {
       const char *ap_raw, *bp_raw;
       if (keys->flags & GRN_TABLE_SORT_DESC) {
@@ -8709,72 +9611,14 @@ compare_value(grn_ctx *ctx, sort_entry *a, sort_entry *b,
         bp = b->value; bs = b->size;
       }
     }
-    type = keys->offset;
-    switch (type) {
-    case KEY_ID :
-      if (ap != bp) { return ap > bp; }
-      break;
-    case KEY_BULK :
-      for (;; ap++, bp++, as--, bs--) {
-        if (!as) { if (bs) { return 0; } else { break; } }
-        if (!bs) { return 1; }
-        if (*ap < *bp) { return 0; }
-        if (*ap > *bp) { return 1; }
-      }
-      break;
-    case KEY_INT8 :
-      CMPNUM(int8_t);
-      break;
-    case KEY_INT16 :
-      CMPNUM(int16_t);
-      break;
-    case KEY_INT32 :
-      CMPNUM(int32_t);
-      break;
-    case KEY_INT64 :
-      CMPNUM(int64_t);
-      break;
-    case KEY_UINT8 :
-      CMPNUM(uint8_t);
-      break;
-    case KEY_UINT16 :
-      CMPNUM(uint16_t);
-      break;
-    case KEY_UINT32 :
-      CMPNUM(uint32_t);
-      break;
-    case KEY_UINT64 :
-      CMPNUM(uint64_t);
-      break;
-    case KEY_FLOAT32 :
-      if (as) {
-        if (bs) {
-          float va = *((float *)(ap));
-          float vb = *((float *)(bp));
-          if (va < vb || va > vb) { return va > vb; }
-        } else {
-          return 1;
-        }
-      } else {
-        if (bs) { return 0; }
-      }
-      break;
-    case KEY_FLOAT64 :
-      if (as) {
-        if (bs) {
-          double va = *((double *)(ap));
-          double vb = *((double *)(bp));
-          if (va < vb || va > vb) { return va > vb; }
-        } else {
-          return 1;
-        }
-      } else {
-        if (bs) { return 0; }
-      }
+    cmp = compare_key_value(keys->offset, ap, as, bp, bs);
+    if (cmp) {
+      result = cmp > 0;
       break;
     }
   }
-  return 0;
+  grn_obj_release_values_(ctx, values_mark);
+  return result;
 }
 
 inline static void
@@ -8858,6 +9702,588 @@ pack(grn_ctx *ctx, grn_obj *table, sort_entry *head, sort_entry *tail,
   return i > 2 ? head : NULL;
 }
 
+/* Top-N sort: when only a few leading records are requested, keep them
+   in a bounded max heap while scanning the table once instead of
+   packing all records. Key values are fetched at most once per heap
+   entry and only when a comparison needs them. Records that have the
+   same key values are ordered by ID. */
+
+#define SORT_HEAP_MIN_N_RECORDS_PER_RESULT 8
+/* A larger heap doesn't fit in CPU cache and is slower than sorting
+   all records. */
+#define SORT_HEAP_MAX_N_RESULTS 10000
+
+typedef struct {
+  const void *value;
+  uint32_t size;
+} sort_key_value;
+
+typedef struct {
+  grn_id id;
+  int n_values;
+  sort_key_value *values;
+} sort_heap_entry;
+
+inline static sort_key_value *
+sort_heap_entry_get_value(grn_ctx *ctx, sort_heap_entry *entry,
+                          grn_table_sort_key *keys, int i)
+{
+  while (entry->n_values <= i) {
+    sort_key_value *v = entry->values + entry->n_values;
+    v->value = grn_obj_get_value_(ctx, keys[entry->n_values].key,
+                                  entry->id, &v->size);
+    entry->n_values++;
+  }
+  return entry->values + i;
+}
+
+inline static int
+compare_heap_entry(grn_ctx *ctx, sort_heap_entry *a, sort_heap_entry *b,
+                   grn_table_sort_key *keys, int n_keys)
+{
+  int i;
+  for (i = 0; i < n_keys; i++) {
+    int cmp;
+    sort_key_value *av = sort_heap_entry_get_value(ctx, a, keys, i);
+    sort_key_value *bv = sort_heap_entry_get_value(ctx, b, keys, i);
+    if (keys[i].flags & GRN_TABLE_SORT_DESC) {
+      cmp = compare_key_value(keys[i].offset,
+                              bv->value, bv->size, av->value, av->size);
+    } else {
+      cmp = compare_key_value(keys[i].offset,
+                              av->value, av->size, bv->value, bv->size);
+    }
+    if (cmp) { return cmp; }
+  }
+  if (a->id != b->id) { return a->id > b->id ? 1 : -1; }
+  return 0;
+}
+
+inline static void
+swap_heap_entry(sort_heap_entry *a, sort_heap_entry *b)
+{
+  sort_heap_entry c_ = *a;
+  *a = *b;
+  *b = c_;
+}
+
+static void
+sort_heap_sift_down(grn_ctx *ctx, sort_heap_entry *heap, int i, int n,
+                    grn_table_sort_key *keys, int n_keys)
+{
+  for (;;) {
+    int largest = i;
+    int left = i * 2 + 1;
+    int right = left + 1;
+    if (left < n &&
+        compare_heap_entry(ctx, heap + left, heap + largest, keys, n_keys) > 0) {
+      largest = left;
+    }
+    if (right < n &&
+        compare_heap_entry(ctx, heap + right, heap + largest, keys, n_keys) > 0) {
+      largest = right;
+    }
+    if (largest == i) { break; }
+    swap_heap_entry(heap + i, heap + largest);
+    i = largest;
+  }
+}
+
+static void
+sort_heap_sift_up(grn_ctx *ctx, sort_heap_entry *heap, int i,
+                  grn_table_sort_key *keys, int n_keys)
+{
+  while (i > 0) {
+    int parent = (i - 1) / 2;
+    if (compare_heap_entry(ctx, heap + i, heap + parent, keys, n_keys) <= 0) {
+      break;
+    }
+    swap_heap_entry(heap + i, heap + parent);
+    i = parent;
+  }
+}
+
+static int
+sort_by_heap(grn_ctx *ctx, grn_obj *table, int offset, int limit,
+             grn_obj *result, grn_table_sort_key *keys, int n_keys)
+{
+  int i, n_entries = 0, n_heap_entries = offset + limit;
+  sort_heap_entry *heap;
+  sort_key_value *values;
+  grn_table_cursor *tc;
+
+  heap = GRN_MALLOC(sizeof(sort_heap_entry) * (n_heap_entries + 1));
+  values = GRN_MALLOC(sizeof(sort_key_value) * n_keys * (n_heap_entries + 1));
+  if (!heap || !values) {
+    if (heap) { GRN_FREE(heap); }
+    if (values) { GRN_FREE(values); }
+    return -1;
+  }
+  for (i = 0; i <= n_heap_entries; i++) {
+    heap[i].values = values + n_keys * i;
+  }
+
+  tc = grn_table_cursor_open(ctx, table, NULL, 0, NULL, 0, 0, -1, 0);
+  if (tc) {
+    grn_id id;
+    /* heap[n_heap_entries] is a buffer for the current candidate. */
+    sort_heap_entry *candidate = heap + n_heap_entries;
+    while ((id = grn_table_cursor_next_inline(ctx, tc))) {
+      if (n_entries < n_heap_entries) {
+        heap[n_entries].id = id;
+        heap[n_entries].n_values = 0;
+        sort_heap_sift_up(ctx, heap, n_entries, keys, n_keys);
+        n_entries++;
+      } else {
+        candidate->id = id;
+        candidate->n_values = 0;
+        if (compare_heap_entry(ctx, candidate, heap, keys, n_keys) < 0) {
+          swap_heap_entry(candidate, heap);
+          sort_heap_sift_down(ctx, heap, 0, n_entries, keys, n_keys);
+        }
+      }
+    }
+    grn_table_cursor_close(ctx, tc);
+  }
+
+  for (i = n_entries - 1; i > 0; i--) {
+    swap_heap_entry(heap, heap + i);
+    sort_heap_sift_down(ctx, heap, 0, i, keys, n_keys);
+  }
+
+  {
+    int n_results = 0;
+    grn_id *v;
+    for (i = offset; i < n_entries && n_results < limit; i++, n_results++) {
+      if (!grn_array_add(ctx, (grn_array *)result, (void **)&v)) { break; }
+      *v = heap[i].id;
+    }
+    GRN_FREE(values);
+    GRN_FREE(heap);
+    return n_results;
+  }
+}
+
+/* Normalized key sort: all sort keys of a record are encoded into one
+   fixed size byte string whose byte order is the sort order. Signed
+   integers get their sign bit flipped, floats are mapped to ordered
+   unsigned integers and descending keys are inverted. The strings are
+   sorted by MSD radix sort that only descends into buckets that overlap
+   the requested range. Key values are read once per record instead of
+   on every comparison. It is used for multiple keys that are all fixed
+   size. Records that have the same key values keep the cursor order. */
+
+#define SORT_NORMALIZED_MIN_N_RECORDS 256
+#define SORT_NORMALIZED_INSERTION_SORT_THRESHOLD 32
+#define SORT_NORMALIZED_MAX_KEY_SIZE 256
+
+static int
+sort_normalized_key_size(grn_table_sort_key *key)
+{
+  switch (key->offset) {
+  case KEY_ID :
+    return sizeof(grn_id);
+  case KEY_INT8 :
+  case KEY_UINT8 :
+    return 1 + 1;
+  case KEY_INT16 :
+  case KEY_UINT16 :
+    return 1 + 2;
+  case KEY_INT32 :
+  case KEY_UINT32 :
+  case KEY_FLOAT32 :
+    return 1 + 4;
+  case KEY_INT64 :
+  case KEY_UINT64 :
+  case KEY_FLOAT64 :
+    return 1 + 8;
+  default :
+    return -1;
+  }
+}
+
+inline static void
+sort_normalized_encode_uint(byte *dest, uint64_t value, int size)
+{
+  while (size--) {
+    dest[size] = (byte)(value & 0xff);
+    value >>= 8;
+  }
+}
+
+typedef struct {
+  grn_table_sort_key *key;
+  int size;
+  grn_obj *table;
+  grn_ra *ra;
+  grn_ra_cache cache;
+} sort_normalized_reader;
+
+/* Fixed size columns are read through a segment cache instead of
+   referring a segment for each value. */
+static void
+sort_normalized_reader_init(grn_ctx *ctx, sort_normalized_reader *reader,
+                            grn_table_sort_key *key)
+{
+  grn_obj *column = key->key;
+  reader->key = key;
+  reader->size = sort_normalized_key_size(key);
+  reader->table = NULL;
+  reader->ra = NULL;
+  if (column->header.type == GRN_ACCESSOR) {
+    grn_accessor *a = (grn_accessor *)column;
+    if (a->action == GRN_ACCESSOR_GET_KEY &&
+        a->next && a->next->action == GRN_ACCESSOR_GET_COLUMN_VALUE &&
+        a->next->obj && !a->next->next) {
+      reader->table = a->obj;
+      column = a->next->obj;
+    }
+  }
+  if (column->header.type == GRN_COLUMN_FIX_SIZE) {
+    reader->ra = (grn_ra *)column;
+    GRN_RA_CACHE_INIT(reader->ra, &(reader->cache));
+  } else {
+    reader->table = NULL;
+  }
+}
+
+static void
+sort_normalized_reader_fin(grn_ctx *ctx, sort_normalized_reader *reader)
+{
+  if (reader->ra) {
+    GRN_RA_CACHE_FIN(reader->ra, &(reader->cache));
+  }
+}
+
+static const byte *
+sort_normalized_reader_get(grn_ctx *ctx, sort_normalized_reader *reader,
+                           grn_id id, uint32_t *size)
+{
+  const byte *value;
+  if (!reader->ra) {
+    return (const byte *)grn_obj_get_value_(ctx, reader->key->key, id, size);
+  }
+  if (reader->table) {
+    const grn_id *record_id;
+    record_id = (const grn_id *)_grn_table_key(ctx, reader->table, id, size);
+    if (!record_id) {
+      *size = 0;
+      return NULL;
+    }
+    id = *record_id;
+  }
+  value = grn_ra_ref_cache(ctx, reader->ra, id, &(reader->cache));
+  *size = value ? reader->ra->header->element_size : 0;
+  return value;
+}
+
+#define SORT_NORMALIZED_ENCODE_KEY(type, value_size, encode) do {\
+  for (i = 0; i < n_records; i++) {\
+    byte *record = records + (size_t)record_size * i;\
+    byte *dest = record + key_offset;\
+    grn_id id;\
+    uint32_t size;\
+    const byte *value;\
+    memcpy(&id, record, sizeof(grn_id));\
+    value = sort_normalized_reader_get(ctx, reader, id, &size);\
+    if (size) {\
+      type raw_value = *((const type *)value);\
+      uint64_t encoded_value;\
+      encode;\
+      dest[0] = 1 ^ mask;\
+      sort_normalized_encode_uint(dest + 1, encoded_value ^ mask64,\
+                                  value_size);\
+    } else {\
+      memset(dest, mask, 1 + value_size);\
+    }\
+  }\
+} while (0)
+
+/* It encodes the key read by reader into key_offset of all records. */
+static void
+sort_normalized_encode_key(grn_ctx *ctx, byte *records, int n_records,
+                           int record_size, int key_offset,
+                           sort_normalized_reader *reader)
+{
+  int i;
+  const byte mask = (reader->key->flags & GRN_TABLE_SORT_DESC) ? 0xff : 0;
+  const uint64_t mask64 = mask ? ~((uint64_t)0) : 0;
+
+  switch (reader->key->offset) {
+  case KEY_ID :
+    for (i = 0; i < n_records; i++) {
+      byte *record = records + (size_t)record_size * i;
+      grn_id id;
+      uint32_t size;
+      const byte *value;
+      memcpy(&id, record, sizeof(grn_id));
+      value = sort_normalized_reader_get(ctx, reader, id, &size);
+      sort_normalized_encode_uint(record + key_offset,
+                                  (uint64_t)(uintptr_t)value ^ mask64,
+                                  sizeof(grn_id));
+    }
+    break;
+  case KEY_INT8 :
+    SORT_NORMALIZED_ENCODE_KEY(int8_t, 1,
+                               encoded_value = (uint8_t)raw_value ^ 0x80);
+    break;
+  case KEY_UINT8 :
+    SORT_NORMALIZED_ENCODE_KEY(uint8_t, 1, encoded_value = raw_value);
+    break;
+  case KEY_INT16 :
+    SORT_NORMALIZED_ENCODE_KEY(int16_t, 2,
+                               encoded_value = (uint16_t)raw_value ^ 0x8000);
+    break;
+  case KEY_UINT16 :
+    SORT_NORMALIZED_ENCODE_KEY(uint16_t, 2, encoded_value = raw_value);
+    break;
+  case KEY_INT32 :
+    SORT_NORMALIZED_ENCODE_KEY(int32_t, 4,
+                               encoded_value =
+                               (uint32_t)raw_value ^ 0x80000000U);
+    break;
+  case KEY_UINT32 :
+    SORT_NORMALIZED_ENCODE_KEY(uint32_t, 4, encoded_value = raw_value);
+    break;
+  case KEY_INT64 :
+    SORT_NORMALIZED_ENCODE_KEY(int64_t, 8,
+                               encoded_value =
+                               (uint64_t)raw_value ^ ((uint64_t)1 << 63));
+    break;
+  case KEY_UINT64 :
+    SORT_NORMALIZED_ENCODE_KEY(uint64_t, 8, encoded_value = raw_value);
+    break;
+  case KEY_FLOAT32 :
+    /* Positive values get the sign bit and negative values are inverted
+       so that they are ordered as unsigned integers. -0.0 is 0.0. */
+    SORT_NORMALIZED_ENCODE_KEY(float, 4, {
+        uint32_t bits;
+        if (raw_value == 0.0) { raw_value = 0.0; }
+        memcpy(&bits, &raw_value, sizeof(bits));
+        if (bits & 0x80000000U) {
+          encoded_value = (uint32_t)~bits;
+        } else {
+          encoded_value = bits | 0x80000000U;
+        }
+      });
+    break;
+  case KEY_FLOAT64 :
+    SORT_NORMALIZED_ENCODE_KEY(double, 8, {
+        uint64_t bits;
+        if (raw_value == 0.0) { raw_value = 0.0; }
+        memcpy(&bits, &raw_value, sizeof(bits));
+        if (bits & ((uint64_t)1 << 63)) {
+          encoded_value = ~bits;
+        } else {
+          encoded_value = bits | ((uint64_t)1 << 63);
+        }
+      });
+    break;
+  }
+}
+
+#undef SORT_NORMALIZED_ENCODE_KEY
+
+#define SORT_NORMALIZED_KEY(records, record_size, index) \
+  ((records) + (size_t)(record_size) * (index) + sizeof(grn_id))
+
+static void
+sort_normalized_insertion_sort(const byte *records, int record_size,
+                               uint32_t *indexes, int from, int to,
+                               int position, int key_size)
+{
+  int i, j;
+  for (i = from + 1; i < to; i++) {
+    uint32_t index = indexes[i];
+    const byte *key =
+      SORT_NORMALIZED_KEY(records, record_size, index) + position;
+    for (j = i; j > from; j--) {
+      const byte *prev_key =
+        SORT_NORMALIZED_KEY(records, record_size, indexes[j - 1]) + position;
+      if (memcmp(prev_key, key, key_size - position) <= 0) {
+        break;
+      }
+      indexes[j] = indexes[j - 1];
+    }
+    indexes[j] = index;
+  }
+}
+
+/* It sorts the record indexes in [from, to) of src by the key bytes at
+   positions[depth] and later. positions lists the key byte positions
+   that aren't the same in all records. Indexes are distributed to dest
+   and sorted there recursively with src as the work area, so sorted
+   indexes may end up in either array. Only indexes in [offset, e) are
+   guaranteed to be in the final order in sorted. counts is the
+   histogram of the byte at positions[depth] or NULL. */
+static void
+sort_normalized_msd(const byte *records, int record_size, int key_size,
+                    const int *positions, int n_positions,
+                    uint32_t *sorted, uint32_t *src, uint32_t *dest,
+                    int from, int to, int depth, int offset, int e,
+                    const uint32_t *counts)
+{
+  uint32_t counts_buffer[256];
+  uint32_t offsets[256];
+  int i, b, begin, position;
+
+  for (;; depth++, counts = NULL) {
+    if (to - from <= 1 || depth >= n_positions) {
+      break;
+    }
+    position = positions[depth];
+    if (to - from < SORT_NORMALIZED_INSERTION_SORT_THRESHOLD) {
+      sort_normalized_insertion_sort(records, record_size, src, from, to,
+                                     position, key_size);
+      break;
+    }
+    if (!counts) {
+      memset(counts_buffer, 0, sizeof(counts_buffer));
+      for (i = from; i < to; i++) {
+        counts_buffer[SORT_NORMALIZED_KEY(records, record_size,
+                                          src[i])[position]]++;
+      }
+      counts = counts_buffer;
+    }
+    if (counts[SORT_NORMALIZED_KEY(records, record_size,
+                                   src[from])[position]] ==
+        (uint32_t)(to - from)) {
+      /* All records have the same byte. */
+      continue;
+    }
+
+    begin = from;
+    for (b = 0; b < 256; b++) {
+      offsets[b] = begin;
+      begin += counts[b];
+    }
+    for (i = from; i < to; i++) {
+      uint32_t index = src[i];
+      const byte *key = SORT_NORMALIZED_KEY(records, record_size, index);
+      dest[offsets[key[position]]++] = index;
+    }
+
+    begin = from;
+    for (b = 0; b < 256; b++) {
+      int end = begin + counts[b];
+      if (begin < e && end > offset) {
+        sort_normalized_msd(records, record_size, key_size,
+                            positions, n_positions,
+                            sorted, dest, src, begin, end, depth + 1,
+                            offset, e, NULL);
+      }
+      begin = end;
+    }
+    return;
+  }
+
+  if (src != sorted) {
+    int copy_from = from < offset ? offset : from;
+    int copy_to = to > e ? e : to;
+    if (copy_from < copy_to) {
+      memcpy(sorted + copy_from, src + copy_from,
+             sizeof(uint32_t) * (copy_to - copy_from));
+    }
+  }
+}
+
+/* It returns the number of sorted records or -1 when this sort mode
+   can't be used. */
+static int
+sort_by_normalized_key(grn_ctx *ctx, grn_obj *table, int n,
+                       int offset, int limit,
+                       grn_obj *result, grn_table_sort_key *keys, int n_keys)
+{
+  int i, n_records = 0, n_results = 0;
+  int key_size = 0, record_size;
+  byte *records;
+  uint32_t *indexes, *buffer;
+  byte differences[SORT_NORMALIZED_MAX_KEY_SIZE];
+  int positions[SORT_NORMALIZED_MAX_KEY_SIZE];
+  grn_table_cursor *tc;
+
+  for (i = 0; i < n_keys; i++) {
+    int size = sort_normalized_key_size(keys + i);
+    if (size < 0) { return -1; }
+    key_size += size;
+  }
+  if (key_size > SORT_NORMALIZED_MAX_KEY_SIZE) { return -1; }
+  record_size = sizeof(grn_id) + key_size;
+
+  records = GRN_MALLOC((size_t)record_size * n);
+  indexes = GRN_MALLOC(sizeof(uint32_t) * n);
+  buffer = GRN_MALLOC(sizeof(uint32_t) * n);
+  if (!records || !indexes || !buffer) {
+    if (records) { GRN_FREE(records); }
+    if (indexes) { GRN_FREE(indexes); }
+    if (buffer) { GRN_FREE(buffer); }
+    return -1;
+  }
+
+  tc = grn_table_cursor_open(ctx, table, NULL, 0, NULL, 0, 0, -1, 0);
+  if (tc) {
+    grn_id id;
+    while (n_records < n && (id = grn_table_cursor_next_inline(ctx, tc))) {
+      memcpy(records + (size_t)record_size * n_records, &id, sizeof(grn_id));
+      n_records++;
+    }
+    grn_table_cursor_close(ctx, tc);
+  }
+
+  {
+    int key_offset = sizeof(grn_id);
+    for (i = 0; i < n_keys; i++) {
+      sort_normalized_reader reader;
+      sort_normalized_reader_init(ctx, &reader, keys + i);
+      sort_normalized_encode_key(ctx, records, n_records,
+                                 record_size, key_offset, &reader);
+      sort_normalized_reader_fin(ctx, &reader);
+      key_offset += reader.size;
+    }
+  }
+
+  if (offset < n_records) {
+    int e = offset + limit;
+    int j, n_positions = 0;
+    const byte *first_key = SORT_NORMALIZED_KEY(records, record_size, 0);
+
+    /* Bytes that are the same in all records, such as the high bytes
+       of small integers, don't need to be sorted. */
+    memset(differences, 0, key_size);
+    for (i = 0; i < n_records; i++) {
+      const byte *key = SORT_NORMALIZED_KEY(records, record_size, i);
+      indexes[i] = i;
+      for (j = 0; j < key_size; j++) {
+        differences[j] |= key[j] ^ first_key[j];
+      }
+    }
+    for (j = 0; j < key_size; j++) {
+      if (differences[j]) {
+        positions[n_positions++] = j;
+      }
+    }
+
+    if (e > n_records) { e = n_records; }
+    sort_normalized_msd(records, record_size, key_size,
+                        positions, n_positions,
+                        indexes, indexes, buffer, 0, n_records, 0,
+                        offset, e, NULL);
+    for (i = offset; i < e; i++) {
+      grn_id *v;
+      if (!grn_array_add(ctx, (grn_array *)result, (void **)&v)) { break; }
+      memcpy(v, records + (size_t)record_size * indexes[i], sizeof(grn_id));
+      n_results++;
+    }
+  }
+
+  GRN_FREE(records);
+  GRN_FREE(indexes);
+  GRN_FREE(buffer);
+  return n_results;
+}
+
+#undef SORT_NORMALIZED_KEY
+
 static int
 range_is_idp(grn_obj *obj)
 {
@@ -8878,7 +10304,10 @@ grn_table_sort(grn_ctx *ctx, grn_obj *table, int offset, int limit,
   grn_obj *index;
   int n, e, i = 0;
   sort_entry *array, *ep;
+  uint32_t values_mark;
   GRN_API_ENTER;
+  /* Sort entries refer values of compressed columns until the end. */
+  values_mark = grn_obj_get_values_mark_(ctx);
   if (!n_keys || !keys) {
     WARN(GRN_INVALID_ARGUMENT, "keys is null");
     goto exit;
@@ -9003,6 +10432,24 @@ grn_table_sort(grn_ctx *ctx, grn_obj *table, int offset, int limit,
         }
       }
     }
+    if (e > 0 && e <= SORT_HEAP_MAX_N_RESULTS &&
+        e <= n / SORT_HEAP_MIN_N_RECORDS_PER_RESULT) {
+      if ((i = sort_by_heap(ctx, table, offset, limit,
+                            result, keys, n_keys)) >= 0) {
+        goto exit;
+      }
+      i = 0;
+    }
+    if (n_keys > 1 && n >= SORT_NORMALIZED_MIN_N_RECORDS) {
+      if ((i = sort_by_normalized_key(ctx, table, n, offset, limit,
+                                      result, keys, n_keys)) >= 0) {
+        goto exit;
+      }
+      i = 0;
+    }
+    /* _sort() only sorts partitions that overlap [offset, e). So it
+       works as quickselect for large limits and as a full sort when all
+       records are requested. */
     if (!(array = GRN_MALLOC(sizeof(sort_entry) * n))) {
       goto exit;
     }
@@ -9021,6 +10468,7 @@ grn_table_sort(grn_ctx *ctx, grn_obj *table, int offset, int limit,
     }
   }
 exit :
+  grn_obj_release_values_(ctx, values_mark);
   GRN_API_RETURN(i);
 }
 
@@ -10244,6 +11692,49 @@ brace_close(grn_ctx *ctx, grn_loader *loader)
   str++;\
 } while (0)
 
+#define JSON_WORD_ONES  0x0101010101010101ULL
+#define JSON_WORD_HIGHS 0x8080808080808080ULL
+#define JSON_WORD_HAS_ZERO(word) \
+  (((word) - JSON_WORD_ONES) & ~(word) & JSON_WORD_HIGHS)
+#define JSON_WORD_HAS_BYTE(word, byte) \
+  JSON_WORD_HAS_ZERO((word) ^ (JSON_WORD_ONES * (byte)))
+
+/*
+ * Returns the end of the run from str that can be appended to a string
+ * value as is: it stops at '"', '\\', '\0' and invalid characters. Runs
+ * of ASCII are checked 8 bytes at a time.
+ */
+static const char *
+json_read_string_run(grn_ctx *ctx, const char *str, const char *end)
+{
+  int len;
+  while (str < end) {
+    if (str + sizeof(uint64_t) <= end) {
+      uint64_t word;
+      memcpy(&word, str, sizeof(uint64_t));
+      if (!(word & JSON_WORD_HIGHS) &&
+          !JSON_WORD_HAS_ZERO(word) &&
+          !JSON_WORD_HAS_BYTE(word, '"') &&
+          !JSON_WORD_HAS_BYTE(word, '\\')) {
+        str += sizeof(uint64_t);
+        continue;
+      }
+    }
+    if (*str == '"' || *str == '\\' || *str == '\0') {
+      break;
+    }
+    if (!(*str & 0x80)) {
+      str++;
+      continue;
+    }
+    if (!(len = grn_charlen(ctx, str, end))) {
+      break;
+    }
+    str += len;
+  }
+  return str;
+}
+
 static void
 json_read(grn_ctx *ctx, grn_loader *loader, const char *str, unsigned int str_len)
 {
@@ -10369,8 +11860,18 @@ json_read(grn_ctx *ctx, grn_loader *loader, const char *str, unsigned int str_le
       case '+' : case '-' : case '.' : case 'e' : case 'E' :
       case '0' : case '1' : case '2' : case '3' : case '4' :
       case '5' : case '6' : case '7' : case '8' : case '9' :
-        GRN_TEXT_PUTC(ctx, loader->last, c);
-        str++;
+        {
+          const char *number_end = str + 1;
+          while (number_end < se &&
+                 (('0' <= *number_end && *number_end <= '9') ||
+                  *number_end == '.' || *number_end == 'e' ||
+                  *number_end == 'E' || *number_end == '+' ||
+                  *number_end == '-')) {
+            number_end++;
+          }
+          GRN_TEXT_PUT(ctx, loader->last, str, number_end - str);
+          str = number_end;
+        }
         break;
       default :
         {
@@ -10415,6 +11916,14 @@ json_read(grn_ctx *ctx, grn_loader *loader, const char *str, unsigned int str_le
         */
         break;
       default :
+        {
+          const char *run_end = json_read_string_run(ctx, str, se);
+          if (run_end > str) {
+            GRN_TEXT_PUT(ctx, loader->last, str, run_end - str);
+            str = run_end;
+            break;
+          }
+        }
         if ((len = grn_charlen(ctx, str, se))) {
           GRN_TEXT_PUT(ctx, loader->last, str, len);
           str += len;
@@ -62,6 +62,17 @@ typedef struct {
 #define GRN_RSET_SUBRECS_COPY(subrecs,size,n,src) \
   (memcpy(GRN_RSET_SUBRECS_NTH(subrecs, size, n), src, size + GRN_RSET_SCORE_SIZE))
 
+#define GRN_RSET_MAX_SIZE (sizeof(int64_t))
+#define GRN_RSET_MIN_SIZE (sizeof(int64_t))
+#define GRN_RSET_SUM_SIZE (sizeof(int64_t))
+#define GRN_RSET_AVG_SIZE (sizeof(double))
+
+#define GRN_TABLE_GROUP_CALC_AGGREGATORS \
+  (GRN_TABLE_GROUP_CALC_MAX |\
+   GRN_TABLE_GROUP_CALC_MIN |\
+   GRN_TABLE_GROUP_CALC_SUM |\
+   GRN_TABLE_GROUP_CALC_AVG)
+
 #define GRN_JSON_LOAD_OPEN_BRACKET 0x40000000
 #define GRN_JSON_LOAD_OPEN_BRACE   0x40000001
 
@@ -74,6 +85,7 @@ struct _grn_db {
   grn_ja *specs;
   grn_tiny_array values;
   grn_critical_section lock;
+  uint32_t schema_version;
 };
 
 typedef struct {
@@ -86,6 +98,12 @@ GRN_API grn_rc grn_db_close(grn_ctx *ctx, grn_obj *db);
 grn_obj *grn_db_keys(grn_obj *s);
 
 uint32_t grn_db_lastmod(grn_obj *s);
+uint32_t grn_db_schema_version(grn_obj *s);
+uint32_t grn_obj_lastmod(grn_ctx *ctx, grn_obj *obj);
+uint64_t grn_obj_prefetch(grn_ctx *ctx, grn_obj *obj);
+void grn_table_get_related_tables(grn_ctx *ctx, grn_obj *table,
+                                  grn_obj *tables);
+GRN_API void grn_table_touch_related_tables(grn_ctx *ctx, grn_obj *table);
 
 grn_rc _grn_table_delete_by_id(grn_ctx *ctx, grn_obj *table, grn_id id,
                                grn_table_delete_optarg *optarg);
@@ -104,6 +122,7 @@ grn_rc grn_table_search(grn_ctx *ctx, grn_obj *table,
                         grn_operator mode, grn_obj *res, grn_operator op);
 
 grn_id grn_table_next(grn_ctx *ctx, grn_obj *table, grn_id id);
+grn_id grn_table_curr_id(grn_ctx *ctx, grn_obj *table);
 
 int grn_table_get_key2(grn_ctx *ctx, grn_obj *table, grn_id id, grn_obj *bulk);
 
@@ -113,6 +132,19 @@ grn_table_cursor *grn_table_cursor_open_by_id(grn_ctx *ctx, grn_obj *table,
 void grn_table_add_subrec(grn_obj *table, grn_rset_recinfo *ri, int score,
                           grn_rset_posinfo *pi, int dir);
 
+uint32_t grn_rset_recinfo_calc_values_size(grn_ctx *ctx,
+                                           grn_table_group_flags flags);
+void grn_rset_recinfo_update_calc_values(grn_ctx *ctx, grn_rset_recinfo *ri,
+                                         grn_obj *table, grn_obj *value);
+int64_t *grn_rset_recinfo_get_max_(grn_ctx *ctx, grn_rset_recinfo *ri,
+                                   grn_obj *table);
+int64_t *grn_rset_recinfo_get_min_(grn_ctx *ctx, grn_rset_recinfo *ri,
+                                   grn_obj *table);
+int64_t *grn_rset_recinfo_get_sum_(grn_ctx *ctx, grn_rset_recinfo *ri,
+                                   grn_obj *table);
+double *grn_rset_recinfo_get_avg_(grn_ctx *ctx, grn_rset_recinfo *ri,
+                                  grn_obj *table);
+
 grn_obj *grn_obj_graft(grn_ctx *ctx, grn_obj *obj);
 
 grn_rc grn_column_name_(grn_ctx *ctx, grn_obj *obj, grn_obj *buf);
@@ -234,6 +266,10 @@ enum {
   GRN_ACCESSOR_GET_VALUE,
   GRN_ACCESSOR_GET_SCORE,
   GRN_ACCESSOR_GET_NSUBRECS,
+  GRN_ACCESSOR_GET_MAX,
+  GRN_ACCESSOR_GET_MIN,
+  GRN_ACCESSOR_GET_SUM,
+  GRN_ACCESSOR_GET_AVG,
   GRN_ACCESSOR_GET_COLUMN_VALUE,
   GRN_ACCESSOR_GET_DB_OBJ,
   GRN_ACCESSOR_LOOKUP,
@@ -243,6 +279,12 @@ enum {
 #define DB_OBJ(obj) ((grn_db_obj *)obj)
 
 GRN_API const char *grn_obj_get_value_(grn_ctx *ctx, grn_obj *obj, grn_id id, uint32_t *size);
+/* Values of compressed columns returned by grn_obj_get_value_() are
+   decompressed into buffers owned by ctx. grn_obj_release_values_() frees
+   the buffers added after mark returned by grn_obj_get_values_mark_().
+   Buffers that aren't released are freed at the end of each command. */
+GRN_API uint32_t grn_obj_get_values_mark_(grn_ctx *ctx);
+GRN_API void grn_obj_release_values_(grn_ctx *ctx, uint32_t mark);
 
 /* vector */
 
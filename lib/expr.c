@@ -811,12 +811,15 @@ grn_expr_get_var_by_offset(grn_ctx *ctx, grn_obj *expr, unsigned int offset)
           GRN_INT32_SET(ctx, x, -((int)value));                 \
         }                                                       \
       }                                                         \
+      x->header.impl_flags |= GRN_OBJ_EXPRCONST_FOLDED;         \
       break;                                                    \
     case GRN_DB_INT64:                                          \
       GRN_INT64_SET(ctx, x, -GRN_INT64_VALUE(x));               \
+      x->header.impl_flags |= GRN_OBJ_EXPRCONST_FOLDED;         \
       break;                                                    \
     case GRN_DB_FLOAT:                                          \
       GRN_FLOAT_SET(ctx, x, -GRN_FLOAT_VALUE(x));               \
+      x->header.impl_flags |= GRN_OBJ_EXPRCONST_FOLDED;         \
       break;                                                    \
     default:                                                    \
       PUSH_CODE(e, op, obj, nargs, code);                       \
@@ -976,6 +979,8 @@ grn_expr_append_obj(grn_ctx *ctx, grn_obj *expr, grn_obj *obj, grn_operator op,
               if (!grn_obj_cast(ctx, x, &dest, GRN_FALSE)) {
                 grn_obj_reinit(ctx, x, yd, 0);
                 grn_bulk_write(ctx, x, GRN_BULK_HEAD(&dest), GRN_BULK_VSIZE(&dest));
+              } else {
+                x->header.impl_flags |= GRN_OBJ_EXPRCONST_FOLDED;
               }
               GRN_OBJ_FIN(ctx, &dest);
             }
@@ -988,6 +993,8 @@ grn_expr_append_obj(grn_ctx *ctx, grn_obj *expr, grn_obj *obj, grn_operator op,
               if (!grn_obj_cast(ctx, y, &dest, GRN_FALSE)) {
                 grn_obj_reinit(ctx, y, xd, 0);
                 grn_bulk_write(ctx, y, GRN_BULK_HEAD(&dest), GRN_BULK_VSIZE(&dest));
+              } else {
+                y->header.impl_flags |= GRN_OBJ_EXPRCONST_FOLDED;
               }
               GRN_OBJ_FIN(ctx, &dest);
             }
@@ -3192,6 +3199,7 @@ grn_expr_exec(grn_ctx *ctx, grn_obj *expr, int nargs)
         {
           grn_obj *col, *rec;
           grn_obj pat_value;
+          uint32_t values_mark = grn_obj_get_values_mark_(ctx);
           GRN_TEXT_INIT(&pat_value, 0);
           do {
             uint32_t size;
@@ -3250,6 +3258,7 @@ grn_expr_exec(grn_ctx *ctx, grn_obj *expr, int nargs)
             }
             code++;
           } while (code < ce && code->op == GRN_OP_GET_VALUE);
+          grn_obj_release_values_(ctx, values_mark);
           GRN_OBJ_FIN(ctx, &pat_value);
         }
         break;
@@ -3372,6 +3381,7 @@ grn_expr_exec(grn_ctx *ctx, grn_obj *expr, int nargs)
               results.limit = 0;
               results.flags = 0;
               results.op = GRN_OP_OR;
+              results.calc_target = NULL;
               WITH_SPSAVE({
                 grn_table_group(ctx, table, keys, n_keys, &results, 1);
               });
@@ -4596,6 +4606,728 @@ exec_result_to_score(grn_ctx *ctx, grn_obj *result, grn_obj *score_buffer)
   }
 }
 
+#define GRN_TABLE_SELECT_BATCH_SIZE 512
+
+typedef union {
+  int32_t int32;
+  uint32_t uint32;
+  int64_t int64;
+  uint64_t uint64;
+  double float_;
+} grn_table_select_batch_value;
+
+typedef struct {
+  grn_obj *column;
+  grn_ra *ra;
+  grn_id x_domain;
+  grn_id common_domain;
+  grn_operator op;
+  grn_table_select_batch_value y;
+} grn_table_select_batch_condition;
+
+/*
+ * Returns the type that C uses to compare a value of x_domain with a value
+ * of y_domain. The batch evaluation converts both of them to the type, so
+ * it returns the same result as DO_COMPARE() and DO_EQ().
+ */
+static grn_id
+grn_table_select_batch_common_domain(grn_id x_domain, grn_id y_domain)
+{
+  grn_id domains[2];
+  int i;
+
+  if (x_domain == GRN_DB_FLOAT || y_domain == GRN_DB_FLOAT) {
+    return GRN_DB_FLOAT;
+  }
+  domains[0] = x_domain;
+  domains[1] = y_domain;
+  for (i = 0; i < 2; i++) {
+    switch (domains[i]) {
+    case GRN_DB_INT8 :
+    case GRN_DB_UINT8 :
+    case GRN_DB_INT16 :
+    case GRN_DB_UINT16 :
+      domains[i] = GRN_DB_INT32;
+      break;
+    default :
+      break;
+    }
+  }
+  if (domains[0] == domains[1]) {
+    return domains[0];
+  }
+  if (domains[0] == GRN_DB_UINT64 || domains[1] == GRN_DB_UINT64) {
+    return GRN_DB_UINT64;
+  }
+  if (domains[0] == GRN_DB_INT64 || domains[1] == GRN_DB_INT64) {
+    return GRN_DB_INT64;
+  }
+  return GRN_DB_UINT32;
+}
+
+static grn_bool
+grn_table_select_batch_is_supported_domain(grn_id domain)
+{
+  switch (domain) {
+  case GRN_DB_INT8 :
+  case GRN_DB_UINT8 :
+  case GRN_DB_INT16 :
+  case GRN_DB_UINT16 :
+  case GRN_DB_INT32 :
+  case GRN_DB_UINT32 :
+  case GRN_DB_INT64 :
+  case GRN_DB_UINT64 :
+  case GRN_DB_FLOAT :
+    return GRN_TRUE;
+  default :
+    return GRN_FALSE;
+  }
+}
+
+#define BATCH_VALUE_GET(domain, value, type) do {\
+  switch (domain) {\
+  case GRN_DB_INT8 :\
+    (value) = (type)GRN_INT8_VALUE(y);\
+    break;\
+  case GRN_DB_UINT8 :\
+    (value) = (type)GRN_UINT8_VALUE(y);\
+    break;\
+  case GRN_DB_INT16 :\
+    (value) = (type)GRN_INT16_VALUE(y);\
+    break;\
+  case GRN_DB_UINT16 :\
+    (value) = (type)GRN_UINT16_VALUE(y);\
+    break;\
+  case GRN_DB_INT32 :\
+    (value) = (type)GRN_INT32_VALUE(y);\
+    break;\
+  case GRN_DB_UINT32 :\
+    (value) = (type)GRN_UINT32_VALUE(y);\
+    break;\
+  case GRN_DB_INT64 :\
+    (value) = (type)GRN_INT64_VALUE(y);\
+    break;\
+  case GRN_DB_UINT64 :\
+    (value) = (type)GRN_UINT64_VALUE(y);\
+    break;\
+  case GRN_DB_FLOAT :\
+    (value) = (type)GRN_FLOAT_VALUE(y);\
+    break;\
+  }\
+} while (0)
+
+/*
+ * Recognizes "column OP constant" where column is a scalar fixed size
+ * numeric column of table and OP is a comparison operator. The current
+ * codes of expr must be exactly the condition.
+ */
+static grn_bool
+grn_table_select_batch_condition_init(grn_ctx *ctx, grn_obj *table,
+                                      grn_obj *expr,
+                                      grn_table_select_batch_condition *cond)
+{
+  grn_expr *e = (grn_expr *)expr;
+  grn_expr_code *codes = e->codes;
+  grn_obj *column, *y;
+  grn_id y_domain;
+
+  if (e->codes_curr != 3) {
+    return GRN_FALSE;
+  }
+  if (codes[0].op != GRN_OP_GET_VALUE || codes[0].nargs != 1) {
+    return GRN_FALSE;
+  }
+  if (codes[1].op != GRN_OP_PUSH) {
+    return GRN_FALSE;
+  }
+  switch (codes[2].op) {
+  case GRN_OP_EQUAL :
+  case GRN_OP_NOT_EQUAL :
+  case GRN_OP_LESS :
+  case GRN_OP_GREATER :
+  case GRN_OP_LESS_EQUAL :
+  case GRN_OP_GREATER_EQUAL :
+    break;
+  default :
+    return GRN_FALSE;
+  }
+  if (codes[2].nargs != 2) {
+    return GRN_FALSE;
+  }
+
+  column = codes[0].value;
+  if (!column || column->header.type != GRN_COLUMN_FIX_SIZE) {
+    return GRN_FALSE;
+  }
+  if (column->header.domain != DB_OBJ(table)->id) {
+    return GRN_FALSE;
+  }
+  if (!grn_table_select_batch_is_supported_domain(DB_OBJ(column)->range)) {
+    return GRN_FALSE;
+  }
+  y = codes[1].value;
+  if (!CONSTP(y) || y->header.type != GRN_BULK) {
+    return GRN_FALSE;
+  }
+  y_domain = y->header.domain;
+  if (!grn_table_select_batch_is_supported_domain(y_domain)) {
+    return GRN_FALSE;
+  }
+
+  cond->column = column;
+  cond->ra = (grn_ra *)column;
+  cond->x_domain = DB_OBJ(column)->range;
+  cond->common_domain =
+    grn_table_select_batch_common_domain(cond->x_domain, y_domain);
+  cond->op = codes[2].op;
+  switch (cond->common_domain) {
+  case GRN_DB_INT32 :
+    BATCH_VALUE_GET(y_domain, cond->y.int32, int32_t);
+    break;
+  case GRN_DB_UINT32 :
+    BATCH_VALUE_GET(y_domain, cond->y.uint32, uint32_t);
+    break;
+  case GRN_DB_INT64 :
+    BATCH_VALUE_GET(y_domain, cond->y.int64, int64_t);
+    break;
+  case GRN_DB_UINT64 :
+    BATCH_VALUE_GET(y_domain, cond->y.uint64, uint64_t);
+    break;
+  case GRN_DB_FLOAT :
+    BATCH_VALUE_GET(y_domain, cond->y.float_, double);
+    break;
+  }
+  return GRN_TRUE;
+}
+
+#undef BATCH_VALUE_GET
+
+#define BATCH_CONVERT(x_type, common_type) do {\
+  const x_type *xs_ = (const x_type *)xs;\
+  common_type *cs_ = (common_type *)common_values;\
+  for (i = 0; i < n; i++) {\
+    cs_[i] = (common_type)xs_[i];\
+  }\
+} while (0)
+
+#define BATCH_CONVERT_TO(common_type) do {\
+  switch (cond->x_domain) {\
+  case GRN_DB_INT8 :\
+    BATCH_CONVERT(int8_t, common_type);\
+    break;\
+  case GRN_DB_UINT8 :\
+    BATCH_CONVERT(uint8_t, common_type);\
+    break;\
+  case GRN_DB_INT16 :\
+    BATCH_CONVERT(int16_t, common_type);\
+    break;\
+  case GRN_DB_UINT16 :\
+    BATCH_CONVERT(uint16_t, common_type);\
+    break;\
+  case GRN_DB_INT32 :\
+    BATCH_CONVERT(int32_t, common_type);\
+    break;\
+  case GRN_DB_UINT32 :\
+    BATCH_CONVERT(uint32_t, common_type);\
+    break;\
+  case GRN_DB_INT64 :\
+    BATCH_CONVERT(int64_t, common_type);\
+    break;\
+  case GRN_DB_UINT64 :\
+    BATCH_CONVERT(uint64_t, common_type);\
+    break;\
+  case GRN_DB_FLOAT :\
+    BATCH_CONVERT(double, common_type);\
+    break;\
+  }\
+} while (0)
+
+#define BATCH_COMPARE(common_type, y_value) do {\
+  const common_type *cs_ = (const common_type *)common_values;\
+  const common_type y_ = (y_value);\
+  switch (cond->op) {\
+  case GRN_OP_EQUAL :\
+    for (i = 0; i < n; i++) { matched[i] = (cs_[i] == y_); }\
+    break;\
+  case GRN_OP_NOT_EQUAL :\
+    for (i = 0; i < n; i++) { matched[i] = (cs_[i] != y_); }\
+    break;\
+  case GRN_OP_LESS :\
+    for (i = 0; i < n; i++) { matched[i] = (cs_[i] < y_); }\
+    break;\
+  case GRN_OP_GREATER :\
+    for (i = 0; i < n; i++) { matched[i] = (cs_[i] > y_); }\
+    break;\
+  case GRN_OP_LESS_EQUAL :\
+    for (i = 0; i < n; i++) { matched[i] = (cs_[i] <= y_); }\
+    break;\
+  case GRN_OP_GREATER_EQUAL :\
+    for (i = 0; i < n; i++) { matched[i] = (cs_[i] >= y_); }\
+    break;\
+  default :\
+    break;\
+  }\
+} while (0)
+
+/*
+ * Evaluates cond against n raw column values in xs and stores 1 or 0 to
+ * matched. The values are converted to the common type block by block so
+ * that each loop is a simple one that compilers can vectorize.
+ */
+static void
+grn_table_select_batch_eval(grn_table_select_batch_condition *cond,
+                            const void *xs, int n, uint8_t *matched)
+{
+  grn_table_select_batch_value common_values[GRN_TABLE_SELECT_BATCH_SIZE];
+  int i;
+
+  switch (cond->common_domain) {
+  case GRN_DB_INT32 :
+    BATCH_CONVERT_TO(int32_t);
+    BATCH_COMPARE(int32_t, cond->y.int32);
+    break;
+  case GRN_DB_UINT32 :
+    BATCH_CONVERT_TO(uint32_t);
+    BATCH_COMPARE(uint32_t, cond->y.uint32);
+    break;
+  case GRN_DB_INT64 :
+    BATCH_CONVERT_TO(int64_t);
+    BATCH_COMPARE(int64_t, cond->y.int64);
+    break;
+  case GRN_DB_UINT64 :
+    BATCH_CONVERT_TO(uint64_t);
+    BATCH_COMPARE(uint64_t, cond->y.uint64);
+    break;
+  case GRN_DB_FLOAT :
+    BATCH_CONVERT_TO(double);
+    BATCH_COMPARE(double, cond->y.float_);
+    break;
+  }
+}
+
+#undef BATCH_COMPARE
+#undef BATCH_CONVERT_TO
+#undef BATCH_CONVERT
+
+static grn_bool
+grn_table_select_batch_or(grn_ctx *ctx, grn_obj *table,
+                          grn_table_select_batch_condition *cond,
+                          grn_obj *res)
+{
+  grn_hash *s = (grn_hash *)res;
+  grn_ra *ra = cond->ra;
+  grn_ra_cache cache;
+  uint8_t matched[GRN_TABLE_SELECT_BATCH_SIZE];
+  uint32_t n_elements_per_segment = ra->element_mask + 1;
+  grn_id id, max_id;
+
+  switch (table->header.type) {
+  case GRN_TABLE_HASH_KEY :
+  case GRN_TABLE_NO_KEY :
+    /* Their cursors return records in ID order like this scan. */
+    break;
+  default :
+    return GRN_FALSE;
+  }
+
+  max_id = grn_table_curr_id(ctx, table);
+  GRN_RA_CACHE_INIT(ra, &cache);
+  for (id = GRN_ID_NIL + 1; id <= max_id; ) {
+    const void *xs;
+    int i, n;
+    n = n_elements_per_segment - (id & ra->element_mask);
+    if (n > GRN_TABLE_SELECT_BATCH_SIZE) {
+      n = GRN_TABLE_SELECT_BATCH_SIZE;
+    }
+    if (n > max_id - id + 1) {
+      n = max_id - id + 1;
+    }
+    if (!(xs = grn_ra_ref_cache(ctx, ra, id, &cache))) {
+      ERR(GRN_NO_MEMORY_AVAILABLE, "ra get failed");
+      break;
+    }
+    grn_table_select_batch_eval(cond, xs, n, matched);
+    for (i = 0; i < n; i++) {
+      grn_id record_id = id + i;
+      grn_rset_recinfo *ri;
+      if (!matched[i]) {
+        continue;
+      }
+      if (grn_table_at(ctx, table, record_id) == GRN_ID_NIL) {
+        continue;
+      }
+      if (grn_hash_add(ctx, s, &record_id, s->key_size, (void **)&ri, NULL)) {
+        grn_table_add_subrec(res, ri, 1, (grn_rset_posinfo *)&record_id, 1);
+      }
+    }
+    id += n;
+  }
+  GRN_RA_CACHE_FIN(ra, &cache);
+  return GRN_TRUE;
+}
+
+static grn_bool
+grn_table_select_batch_and(grn_ctx *ctx, grn_obj *table,
+                           grn_table_select_batch_condition *cond,
+                           grn_obj *res, grn_operator op)
+{
+  grn_hash *s = (grn_hash *)res;
+  grn_ra *ra = cond->ra;
+  grn_ra_cache cache;
+  grn_hash_cursor *hc;
+  grn_id ids[GRN_TABLE_SELECT_BATCH_SIZE];
+  grn_id record_ids[GRN_TABLE_SELECT_BATCH_SIZE];
+  grn_rset_recinfo *ris[GRN_TABLE_SELECT_BATCH_SIZE];
+  grn_table_select_batch_value xs[GRN_TABLE_SELECT_BATCH_SIZE];
+  uint8_t matched[GRN_TABLE_SELECT_BATCH_SIZE];
+  uint32_t element_size = ra->header->element_size;
+  grn_bool eof = GRN_FALSE;
+
+  if (!(hc = grn_hash_cursor_open(ctx, s, NULL, 0, NULL, 0, 0, -1, 0))) {
+    return GRN_FALSE;
+  }
+  GRN_RA_CACHE_INIT(ra, &cache);
+  while (!eof) {
+    int i, n;
+    for (n = 0; n < GRN_TABLE_SELECT_BATCH_SIZE; n++) {
+      grn_id *record_id;
+      const void *x;
+      if (!(ids[n] = grn_hash_cursor_next(ctx, hc))) {
+        eof = GRN_TRUE;
+        break;
+      }
+      grn_hash_cursor_get_key_value(ctx, hc, (void **)&record_id, NULL,
+                                    (void **)&(ris[n]));
+      record_ids[n] = *record_id;
+      if (!(x = grn_ra_ref_cache(ctx, ra, record_ids[n], &cache))) {
+        ERR(GRN_NO_MEMORY_AVAILABLE, "ra get failed");
+        eof = GRN_TRUE;
+        break;
+      }
+      memcpy(((char *)xs) + element_size * n, x, element_size);
+    }
+    grn_table_select_batch_eval(cond, xs, n, matched);
+    for (i = 0; i < n; i++) {
+      if (op == GRN_OP_AND) {
+        if (matched[i]) {
+          grn_table_add_subrec(res, ris[i], 1,
+                               (grn_rset_posinfo *)&(record_ids[i]), 1);
+        } else {
+          grn_hash_delete_by_id(ctx, s, ids[i], NULL);
+        }
+      } else {
+        if (matched[i]) {
+          grn_hash_delete_by_id(ctx, s, ids[i], NULL);
+        }
+      }
+    }
+  }
+  GRN_RA_CACHE_FIN(ra, &cache);
+  grn_hash_cursor_close(ctx, hc);
+  return GRN_TRUE;
+}
+
+/*
+ * Evaluates a simple comparison against a fixed size column in blocks of
+ * GRN_TABLE_SELECT_BATCH_SIZE values read directly from the column's
+ * segments instead of running expr for each record. Returns GRN_FALSE
+ * when expr isn't such a comparison. A segment that can't be read is an
+ * error because res has been changed by then.
+ */
+static grn_bool
+grn_table_select_batch(grn_ctx *ctx, grn_obj *table, grn_obj *expr,
+                       grn_obj *res, grn_operator op)
+{
+  grn_table_select_batch_condition cond;
+
+  if (!grn_table_select_batch_condition_init(ctx, table, expr, &cond)) {
+    return GRN_FALSE;
+  }
+  switch (op) {
+  case GRN_OP_OR :
+    return grn_table_select_batch_or(ctx, table, &cond, res);
+  case GRN_OP_AND :
+  case GRN_OP_AND_NOT :
+    return grn_table_select_batch_and(ctx, table, &cond, res, op);
+  default :
+    return GRN_FALSE;
+  }
+}
+
+static grn_bool
+grn_table_select_parallel_is_available(grn_ctx *ctx, grn_obj *expr,
+                                       grn_obj *var)
+{
+  grn_expr *e = (grn_expr *)expr;
+  grn_expr_code *code, *code_end;
+
+  code_end = e->codes + e->codes_curr;
+  for (code = e->codes; code < code_end; code++) {
+    grn_obj *value = code->value;
+    if (code->op == GRN_OP_CALL) {
+      /* Functions may keep state or call back into the caller's context. */
+      return GRN_FALSE;
+    }
+    if (!value || value == var) {
+      continue;
+    }
+    if (CONSTP(value)) {
+      if (value->header.type != GRN_BULK) {
+        return GRN_FALSE;
+      }
+      continue;
+    }
+    switch (value->header.type) {
+    case GRN_ACCESSOR :
+    case GRN_TYPE :
+    case GRN_TABLE_HASH_KEY :
+    case GRN_TABLE_PAT_KEY :
+    case GRN_TABLE_DAT_KEY :
+    case GRN_TABLE_NO_KEY :
+    case GRN_COLUMN_FIX_SIZE :
+    case GRN_COLUMN_VAR_SIZE :
+    case GRN_COLUMN_INDEX :
+      break;
+    default :
+      return GRN_FALSE;
+    }
+  }
+  return GRN_TRUE;
+}
+
+/*
+ * Copies the codes of expr into a new expression owned by worker_ctx.
+ * Constants are copied because expressions are evaluated in place. Tables,
+ * columns and accessors are shared because they are only read.
+ */
+static grn_obj *
+grn_table_select_parallel_clone_expr(grn_ctx *worker_ctx, grn_obj *table,
+                                     grn_obj *expr, grn_obj *var,
+                                     grn_obj **worker_var)
+{
+  grn_ctx *ctx = worker_ctx;
+  grn_obj *clone;
+  grn_expr *e = (grn_expr *)expr;
+  grn_expr *ce;
+  uint32_t i;
+
+  GRN_EXPR_CREATE_FOR_QUERY(ctx, table, clone, *worker_var);
+  if (!clone) {
+    return NULL;
+  }
+  ce = (grn_expr *)clone;
+  if (!*worker_var || e->codes_curr > ce->codes_size) {
+    grn_obj_close(ctx, clone);
+    return NULL;
+  }
+  for (i = 0; i < e->codes_curr; i++) {
+    grn_expr_code *code = e->codes + i;
+    grn_expr_code *clone_code = ce->codes + i;
+    *clone_code = *code;
+    if (!code->value) {
+      continue;
+    }
+    if (code->value == var) {
+      clone_code->value = *worker_var;
+    } else if (CONSTP(code->value)) {
+      grn_obj *value = code->value;
+      grn_obj *clone_value;
+      if (!(clone_value = const_new(ctx, ce))) {
+        grn_obj_close(ctx, clone);
+        return NULL;
+      }
+      GRN_OBJ_INIT(clone_value, GRN_BULK, GRN_OBJ_EXPRCONST,
+                   value->header.domain);
+      grn_bulk_write(ctx, clone_value,
+                     GRN_BULK_HEAD(value), GRN_BULK_VSIZE(value));
+      clone_code->value = clone_value;
+    }
+  }
+  ce->codes_curr = e->codes_curr;
+  return clone;
+}
+
+typedef struct {
+  grn_ctx ctx;
+  grn_thread thread;
+  grn_bool thread_created;
+  grn_obj *table;
+  grn_obj *expr;
+  grn_obj *var;
+  grn_obj *res;
+  grn_id min;
+  grn_id max;
+  grn_rc rc;
+} grn_table_select_worker;
+
+static void * CALLBACK
+grn_table_select_worker_run(void *arg)
+{
+  grn_table_select_worker *worker = arg;
+  grn_ctx *ctx = &(worker->ctx);
+  grn_hash *s = (grn_hash *)(worker->res);
+  grn_obj score_buffer;
+  grn_id id;
+
+  GRN_INT32_INIT(&score_buffer, 0);
+  for (id = grn_table_next(ctx, worker->table, worker->min - 1);
+       id != GRN_ID_NIL && id <= worker->max;
+       id = grn_table_next(ctx, worker->table, id)) {
+    grn_obj *r;
+    int32_t score;
+    GRN_RECORD_SET(ctx, worker->var, id);
+    r = grn_expr_exec(ctx, worker->expr, 0);
+    if (ctx->rc) {
+      /* Keep it here because the following API calls clear ctx->rc. */
+      worker->rc = ctx->rc;
+      break;
+    }
+    score = exec_result_to_score(ctx, r, &score_buffer);
+    if (score > 0) {
+      grn_rset_recinfo *ri;
+      if (grn_hash_add(ctx, s, &id, s->key_size, (void **)&ri, NULL)) {
+        grn_table_add_subrec(worker->res, ri, score,
+                             (grn_rset_posinfo *)&id, 1);
+      }
+    }
+  }
+  GRN_OBJ_FIN(ctx, &score_buffer);
+  return NULL;
+}
+
+/*
+ * Evaluates expr against all records of table with
+ * grn_table_select_n_workers threads. Each worker scans a contiguous
+ * range of record IDs with its own context, expression and result set.
+ * The partial results are merged into res in ID order, so res is the same
+ * as the one of the sequential scan. Returns GRN_FALSE without touching res
+ * when expr or table isn't suitable for it.
+ */
+static grn_bool
+grn_table_select_parallel(grn_ctx *ctx, grn_obj *table, grn_obj *expr,
+                          grn_obj *v, grn_obj *res)
+{
+  grn_table_select_worker *workers;
+  grn_id max_id;
+  uint32_t n_records;
+  uint32_t n_ids_per_worker;
+  int i, n_workers, n_ready;
+  grn_bool processed = GRN_FALSE;
+
+  if (grn_table_select_n_workers < 2) {
+    return GRN_FALSE;
+  }
+  switch (table->header.type) {
+  case GRN_TABLE_HASH_KEY :
+  case GRN_TABLE_NO_KEY :
+    /* Their cursors return records in ID order like the workers. */
+    break;
+  default :
+    return GRN_FALSE;
+  }
+  n_records = grn_table_size(ctx, table);
+  if (grn_table_select_min_n_records_per_worker > 0) {
+    n_workers = n_records / grn_table_select_min_n_records_per_worker;
+  } else {
+    n_workers = n_records;
+  }
+  if (n_workers > grn_table_select_n_workers) {
+    n_workers = grn_table_select_n_workers;
+  }
+  if (n_workers < 2) {
+    return GRN_FALSE;
+  }
+  if (!grn_table_select_parallel_is_available(ctx, expr, v)) {
+    return GRN_FALSE;
+  }
+  max_id = grn_table_curr_id(ctx, table);
+  if (max_id == GRN_ID_NIL) {
+    return GRN_FALSE;
+  }
+
+  if (!(workers = GRN_MALLOCN(grn_table_select_worker, n_workers))) {
+    return GRN_FALSE;
+  }
+  n_ids_per_worker = (max_id + n_workers - 1) / n_workers;
+  for (n_ready = 0; n_ready < n_workers; n_ready++) {
+    grn_table_select_worker *worker = workers + n_ready;
+    grn_ctx *worker_ctx = &(worker->ctx);
+    grn_ctx_init(worker_ctx, 0);
+    grn_ctx_use(worker_ctx, grn_ctx_db(ctx));
+    worker->thread_created = GRN_FALSE;
+    worker->table = table;
+    worker->var = NULL;
+    worker->res = NULL;
+    worker->rc = GRN_SUCCESS;
+    worker->min = n_ready * n_ids_per_worker + 1;
+    worker->max = (n_ready + 1) * n_ids_per_worker;
+    worker->expr = grn_table_select_parallel_clone_expr(worker_ctx, table,
+                                                        expr, v,
+                                                        &(worker->var));
+    if (worker->expr) {
+      worker->res = grn_table_create(worker_ctx, NULL, 0, NULL,
+                                     GRN_TABLE_HASH_KEY|GRN_OBJ_WITH_SUBREC,
+                                     table, NULL);
+    }
+    if (!worker->res) {
+      if (worker->expr) {
+        grn_obj_close(worker_ctx, worker->expr);
+      }
+      grn_ctx_fin(worker_ctx);
+      break;
+    }
+  }
+
+  if (n_ready == n_workers) {
+    for (i = 0; i < n_workers; i++) {
+      grn_table_select_worker *worker = workers + i;
+      if (!THREAD_CREATE(worker->thread, grn_table_select_worker_run, worker)) {
+        worker->thread_created = GRN_TRUE;
+      } else {
+        grn_table_select_worker_run(worker);
+      }
+    }
+    for (i = 0; i < n_workers; i++) {
+      grn_table_select_worker *worker = workers + i;
+      if (worker->thread_created) {
+        THREAD_JOIN(worker->thread);
+      }
+    }
+    for (i = 0; i < n_workers; i++) {
+      grn_table_select_worker *worker = workers + i;
+      if (worker->rc != GRN_SUCCESS) {
+        if (ctx->rc == GRN_SUCCESS) {
+          ERR(worker->rc, "%s", worker->ctx.errbuf);
+        }
+      } else if (ctx->rc == GRN_SUCCESS) {
+        grn_hash *s = (grn_hash *)res;
+        grn_id *idp;
+        grn_rset_recinfo *worker_ri;
+        /* Add subrecords like the sequential scan does. */
+        GRN_HASH_EACH(ctx, (grn_hash *)(worker->res), hid,
+                      &idp, NULL, &worker_ri, {
+          grn_id id = *idp;
+          grn_rset_recinfo *ri;
+          if (grn_hash_add(ctx, s, &id, s->key_size, (void **)&ri, NULL)) {
+            grn_table_add_subrec(res, ri, worker_ri->score,
+                                 (grn_rset_posinfo *)&id, 1);
+          }
+        });
+      }
+    }
+    processed = GRN_TRUE;
+  }
+
+  for (i = 0; i < n_ready; i++) {
+    grn_table_select_worker *worker = workers + i;
+    grn_obj_close(&(worker->ctx), worker->res);
+    grn_obj_close(&(worker->ctx), worker->expr);
+    grn_ctx_fin(&(worker->ctx));
+  }
+  GRN_FREE(workers);
+  return processed;
+}
+
 static void
 grn_table_select_(grn_ctx *ctx, grn_obj *table, grn_obj *expr, grn_obj *v,
                   grn_obj *res, grn_operator op)
@@ -4611,6 +5343,12 @@ grn_table_select_(grn_ctx *ctx, grn_obj *table, grn_obj *expr, grn_obj *v,
   GRN_INT32_INIT(&score_buffer, 0);
   switch (op) {
   case GRN_OP_OR :
+    if (grn_table_select_batch(ctx, table, expr, res, op)) {
+      break;
+    }
+    if (grn_table_select_parallel(ctx, table, expr, v, res)) {
+      break;
+    }
     if ((tc = grn_table_cursor_open(ctx, table, NULL, 0, NULL, 0, 0, -1, 0))) {
       while ((id = grn_table_cursor_next(ctx, tc))) {
         GRN_RECORD_SET(ctx, v, id);
@@ -4627,6 +5365,9 @@ grn_table_select_(grn_ctx *ctx, grn_obj *table, grn_obj *expr, grn_obj *v,
     }
     break;
   case GRN_OP_AND :
+    if (grn_table_select_batch(ctx, table, expr, res, op)) {
+      break;
+    }
     if ((hc = grn_hash_cursor_open(ctx, s, NULL, 0, NULL, 0, 0, -1, 0))) {
       while (grn_hash_cursor_next(ctx, hc)) {
         grn_hash_cursor_get_key(ctx, hc, (void **) &idp);
@@ -4645,6 +5386,9 @@ grn_table_select_(grn_ctx *ctx, grn_obj *table, grn_obj *expr, grn_obj *v,
     }
     break;
   case GRN_OP_AND_NOT :
+    if (grn_table_select_batch(ctx, table, expr, res, op)) {
+      break;
+    }
     if ((hc = grn_hash_cursor_open(ctx, s, NULL, 0, NULL, 0, 0, -1, 0))) {
       while (grn_hash_cursor_next(ctx, hc)) {
         grn_hash_cursor_get_key(ctx, hc, (void **) &idp);
@@ -5171,6 +5915,65 @@ grn_table_select_index(grn_ctx *ctx, grn_obj *table, scan_info *si,
   return processed;
 }
 
+static grn_bool
+grn_table_select_top_k(grn_ctx *ctx, grn_obj *table, scan_info **sis, int n,
+                       grn_obj *res, int k)
+{
+  int i;
+  grn_obj *index = NULL, *lexicon = NULL;
+  grn_obj queries, weights;
+  grn_bool processed = GRN_FALSE;
+  uint32_t n_hits = 0;
+  GRN_PTR_INIT(&queries, GRN_OBJ_VECTOR, GRN_ID_NIL);
+  GRN_INT32_INIT(&weights, GRN_OBJ_VECTOR);
+  for (i = 0; i < n; i++) {
+    scan_info *si = sis[i];
+    int32_t weight;
+    if ((si->flags & (SCAN_PUSH|SCAN_POP)) ||
+        si->op != GRN_OP_MATCH || si->logical_op != GRN_OP_OR ||
+        GRN_BULK_VSIZE(&si->index) != sizeof(grn_obj *) ||
+        GRN_BULK_VSIZE(&si->wv) != sizeof(int32_t) * 2 ||
+        GRN_INT32_VALUE_AT(&si->wv, 0) != 0 ||
+        !si->query || si->query->header.type != GRN_BULK) {
+      goto exit;
+    }
+    if (!index) {
+      index = GRN_PTR_VALUE_AT(&si->index, 0);
+      if (index->header.type != GRN_COLUMN_INDEX ||
+          DB_OBJ(index)->range != DB_OBJ(table)->id ||
+          !(lexicon = grn_ctx_at(ctx, index->header.domain))) {
+        goto exit;
+      }
+    } else if (GRN_PTR_VALUE_AT(&si->index, 0) != index) {
+      goto exit;
+    }
+    if (!(GRN_DB_SHORT_TEXT <= si->query->header.domain &&
+          si->query->header.domain <= GRN_DB_LONG_TEXT &&
+          GRN_DB_SHORT_TEXT <= lexicon->header.domain &&
+          lexicon->header.domain <= GRN_DB_LONG_TEXT)) {
+      goto exit;
+    }
+    weight = GRN_INT32_VALUE_AT(&si->wv, 1);
+    GRN_PTR_PUT(ctx, &queries, si->query);
+    GRN_INT32_PUT(ctx, &weights, weight > 0 ? weight : 1);
+  }
+  if (index) {
+    processed = grn_ii_select_top_k(ctx, (grn_ii *)index,
+                                    (grn_obj **)GRN_BULK_HEAD(&queries),
+                                    (int *)GRN_BULK_HEAD(&weights), n,
+                                    (grn_hash *)res, k, &n_hits);
+    if (processed) {
+      ctx->impl->top_k_n_hits = n_hits;
+      GRN_QUERY_LOG(ctx, GRN_QUERY_LOG_SIZE,
+                    ":", "top_k(%d/%d)", grn_table_size(ctx, res), n_hits);
+    }
+  }
+exit :
+  GRN_OBJ_FIN(ctx, &queries);
+  GRN_OBJ_FIN(ctx, &weights);
+  return processed;
+}
+
 grn_obj *
 grn_table_select(grn_ctx *ctx, grn_obj *table, grn_obj *expr,
                  grn_obj *res, grn_operator op)
@@ -5178,6 +5981,12 @@ grn_table_select(grn_ctx *ctx, grn_obj *table, grn_obj *expr,
   grn_obj *v;
   unsigned int res_size;
   grn_bool res_created = GRN_FALSE;
+  int top_k = 0;
+  if (ctx->impl) {
+    /* only the outermost select can use the hint */
+    top_k = ctx->impl->top_k;
+    ctx->impl->top_k = 0;
+  }
   if (res) {
     if (res->header.type != GRN_TABLE_HASH_KEY ||
         (res->header.domain != DB_OBJ(table)->id)) {
@@ -5198,7 +6007,7 @@ grn_table_select(grn_ctx *ctx, grn_obj *table, grn_obj *expr,
   GRN_API_ENTER;
   res_size = GRN_HASH_SIZE((grn_hash *)res);
   if (op == GRN_OP_OR || res_size) {
-    int i, n;
+    int i, n, n_processed = 0;
     scan_info **sis;
     if ((sis = scan_info_build(ctx, expr, &n, op, res_size))) {
       grn_obj res_stack;
@@ -5206,7 +6015,11 @@ grn_table_select(grn_ctx *ctx, grn_obj *table, grn_obj *expr,
       grn_expr_code *codes = e->codes;
       uint32_t codes_curr = e->codes_curr;
       GRN_PTR_INIT(&res_stack, GRN_OBJ_VECTOR, GRN_ID_NIL);
-      for (i = 0; i < n; i++) {
+      if (top_k > 0 && !res_size &&
+          grn_table_select_top_k(ctx, table, sis, n, res, top_k)) {
+        n_processed = n;
+      }
+      for (i = n_processed; i < n; i++) {
         scan_info *si = sis[i];
         if (si->flags & SCAN_POP) {
           grn_obj *res_;
@@ -5318,6 +6131,7 @@ typedef struct {
   int weight_offset;
   grn_hash *weight_set;
   snip_cond *snip_conds;
+  grn_obj *literals;
 } efs_info;
 
 typedef struct {
@@ -6113,6 +6927,53 @@ get_string(grn_ctx *ctx, efs_info *q, char quote)
   return rc;
 }
 
+static const char *
+get_number(grn_ctx *ctx, const char *cur, const char *str_end, grn_obj *number)
+{
+  const char *rest;
+  int64_t int64 = grn_atoll(cur, str_end, &rest);
+  GRN_OBJ_FIN(ctx, number);
+  // checks to see grn_atoll was appropriate
+  // (NOTE: *cur begins with a digit. Thus, grn_atoll parses at leaset
+  //        one char.)
+  if (str_end != rest &&
+      (*rest == '.' || *rest == 'e' || *rest == 'E' ||
+       (*rest >= '0' && *rest <= '9'))) {
+    char *rest_float;
+    double d = strtod(cur, &rest_float);
+    GRN_FLOAT_INIT(number, 0);
+    GRN_FLOAT_SET(ctx, number, d);
+    rest = rest_float;
+  } else {
+    const char *rest64 = rest;
+    unsigned int uint32 = grn_atoui(cur, str_end, &rest);
+    // checks to see grn_atoi failed (see above NOTE)
+    if ((int64 > UINT32_MAX) ||
+        (str_end != rest && *rest >= '0' && *rest <= '9')) {
+      GRN_INT64_INIT(number, 0);
+      GRN_INT64_SET(ctx, number, int64);
+      rest = rest64;
+    } else {
+      GRN_UINT32_INIT(number, 0);
+      GRN_UINT32_SET(ctx, number, uint32);
+    }
+  }
+  return rest;
+}
+
+static void
+add_literal(grn_ctx *ctx, efs_info *q, const char *start, grn_obj *value)
+{
+  grn_expr *e = (grn_expr *)(q->e);
+  grn_expr_literal literal;
+  if (!q->literals || !value) { return; }
+  literal.offset = start - q->str;
+  literal.size = q->cur - start;
+  literal.domain = value->header.domain;
+  literal.nth_const = value - e->consts;
+  GRN_TEXT_PUT(ctx, q->literals, &literal, sizeof(grn_expr_literal));
+}
+
 static grn_obj *
 resolve_top_level_name(grn_ctx *ctx, const char *name, unsigned int name_size)
 {
@@ -6338,14 +7199,24 @@ parse_script(grn_ctx *ctx, efs_info *q)
       grn_expr_append_op(ctx, q->e, GRN_OP_CJUMP, 0);
       break;
     case '"' :
-      if ((rc = get_string(ctx, q, '"'))) { goto exit; }
-      PARSE(GRN_EXPR_TOKEN_STRING);
-      grn_expr_append_const(ctx, q->e, &q->buf, GRN_OP_PUSH, 1);
+      {
+        const char *start = q->cur;
+        grn_obj *value;
+        if ((rc = get_string(ctx, q, '"'))) { goto exit; }
+        PARSE(GRN_EXPR_TOKEN_STRING);
+        value = grn_expr_append_const(ctx, q->e, &q->buf, GRN_OP_PUSH, 1);
+        add_literal(ctx, q, start, value);
+      }
       break;
     case '\'' :
-      if ((rc = get_string(ctx, q, '\''))) { goto exit; }
-      PARSE(GRN_EXPR_TOKEN_STRING);
-      grn_expr_append_const(ctx, q->e, &q->buf, GRN_OP_PUSH, 1);
+      {
+        const char *start = q->cur;
+        grn_obj *value;
+        if ((rc = get_string(ctx, q, '\''))) { goto exit; }
+        PARSE(GRN_EXPR_TOKEN_STRING);
+        value = grn_expr_append_const(ctx, q->e, &q->buf, GRN_OP_PUSH, 1);
+        add_literal(ctx, q, start, value);
+      }
       break;
     case '*' :
       q->cur++;
@@ -6645,40 +7516,14 @@ parse_script(grn_ctx *ctx, efs_info *q)
     case '0' : case '1' : case '2' : case '3' : case '4' :
     case '5' : case '6' : case '7' : case '8' : case '9' :
       {
-        const char *rest;
-        int64_t int64 = grn_atoll(q->cur, q->str_end, &rest);
-        // checks to see grn_atoll was appropriate
-        // (NOTE: *q->cur begins with a digit. Thus, grn_atoll parses at leaset
-        //        one char.)
-        if (q->str_end != rest &&
-            (*rest == '.' || *rest == 'e' || *rest == 'E' ||
-             (*rest >= '0' && *rest <= '9'))) {
-          char *rest_float;
-          double d = strtod(q->cur, &rest_float);
-          grn_obj floatbuf;
-          GRN_FLOAT_INIT(&floatbuf, 0);
-          GRN_FLOAT_SET(ctx, &floatbuf, d);
-          grn_expr_append_const(ctx, q->e, &floatbuf, GRN_OP_PUSH, 1);
-          rest = rest_float;
-        } else {
-          const char *rest64 = rest;
-          unsigned int uint32 = grn_atoui(q->cur, q->str_end, &rest);
-          // checks to see grn_atoi failed (see above NOTE)
-          if ((int64 > UINT32_MAX) ||
-              (q->str_end != rest && *rest >= '0' && *rest <= '9')) {
-            grn_obj int64buf;
-            GRN_INT64_INIT(&int64buf, 0);
-            GRN_INT64_SET(ctx, &int64buf, int64);
-            grn_expr_append_const(ctx, q->e, &int64buf, GRN_OP_PUSH, 1);
-            rest = rest64;
-          } else {
-            grn_obj uint32buf;
-            GRN_UINT32_INIT(&uint32buf, 0);
-            GRN_UINT32_SET(ctx, &uint32buf, uint32);
-            grn_expr_append_const(ctx, q->e, &uint32buf, GRN_OP_PUSH, 1);
-          }
-        }
-        q->cur = rest;
+        const char *start = q->cur;
+        grn_obj number;
+        grn_obj *value;
+        GRN_VOID_INIT(&number);
+        q->cur = get_number(ctx, q->cur, q->str_end, &number);
+        value = grn_expr_append_const(ctx, q->e, &number, GRN_OP_PUSH, 1);
+        GRN_OBJ_FIN(ctx, &number);
+        add_literal(ctx, q, start, value);
         PARSE(GRN_EXPR_TOKEN_DECIMAL);
       }
       break;
@@ -6698,6 +7543,19 @@ grn_expr_parse(grn_ctx *ctx, grn_obj *expr,
                const char *str, unsigned int str_size,
                grn_obj *default_column, grn_operator default_mode,
                grn_operator default_op, grn_expr_flags flags)
+{
+  return grn_expr_parse_with_literals(ctx, expr, str, str_size,
+                                      default_column, default_mode,
+                                      default_op, flags, NULL);
+}
+
+grn_rc
+grn_expr_parse_with_literals(grn_ctx *ctx, grn_obj *expr,
+                             const char *str, unsigned int str_size,
+                             grn_obj *default_column,
+                             grn_operator default_mode,
+                             grn_operator default_op, grn_expr_flags flags,
+                             grn_obj *literals)
 {
   efs_info efsi;
   if (grn_expr_parser_open(ctx)) { return ctx->rc; }
@@ -6725,6 +7583,7 @@ grn_expr_parse(grn_ctx *ctx, grn_obj *expr,
     efsi.weight_offset = 0;
     efsi.opt.weight_vector = NULL;
     efsi.weight_set = NULL;
+    efsi.literals = literals;
 
     if (flags & (GRN_EXPR_SYNTAX_SCRIPT |
                  GRN_EXPR_SYNTAX_OUTPUT_COLUMNS |
@@ -6766,6 +7625,237 @@ grn_expr_parse(grn_ctx *ctx, grn_obj *expr,
   GRN_API_RETURN(ctx->rc);
 }
 
+/*
+ * Splits a script syntax string into its shape and its string and number
+ * literals. The shape is the string with each literal replaced by '\0'
+ * and the literal's domain, so strings that differ only in literal values
+ * have the same shape. The scanner follows parse_script() but it doesn't
+ * resolve anything. Callers must confirm that a parsed expression agrees
+ * with it by grn_expr_literals_bindable() before reusing the expression.
+ */
+grn_bool
+grn_expr_extract_literals(grn_ctx *ctx, const char *str, unsigned int str_size,
+                          grn_obj *shape, grn_obj *literals)
+{
+  const char *cur = str;
+  const char *str_end = str + str_size;
+  grn_bool succeeded = GRN_TRUE;
+  grn_obj number;
+
+  GRN_VOID_INIT(&number);
+  while (cur < str_end) {
+    const char *start = cur;
+    unsigned int len;
+    grn_expr_literal literal;
+
+    if (!(len = grn_charlen(ctx, cur, str_end))) {
+      succeeded = GRN_FALSE;
+      break;
+    }
+    if (grn_isspace(cur, ctx->encoding)) {
+      cur += len;
+      if (GRN_TEXT_LEN(shape) == 0 ||
+          GRN_TEXT_VALUE(shape)[GRN_TEXT_LEN(shape) - 1] != ' ') {
+        GRN_TEXT_PUTC(ctx, shape, ' ');
+      }
+      continue;
+    }
+    if (len > 1) {
+      /* Non-ASCII characters are parts of identifiers. */
+    } else {
+      switch (*cur) {
+      case '\0' :
+        cur = str_end;
+        continue;
+      case '"' :
+      case '\'' :
+        {
+          char quote = *cur;
+          grn_bool closed = GRN_FALSE;
+          for (cur++; cur < str_end; cur += len) {
+            if (!(len = grn_charlen(ctx, cur, str_end))) { break; }
+            if (len == 1) {
+              if (*cur == quote) {
+                cur++;
+                closed = GRN_TRUE;
+                break;
+              }
+              if (*cur == GRN_QUERY_ESCAPE && cur + 1 < str_end) {
+                cur++;
+                if (!(len = grn_charlen(ctx, cur, str_end))) { break; }
+              }
+            }
+          }
+          if (!closed) {
+            succeeded = GRN_FALSE;
+            goto exit;
+          }
+          literal.domain = GRN_DB_TEXT;
+        }
+        break;
+      case '0' : case '1' : case '2' : case '3' : case '4' :
+      case '5' : case '6' : case '7' : case '8' : case '9' :
+        cur = get_number(ctx, cur, str_end, &number);
+        literal.domain = number.header.domain;
+        break;
+      case '(' : case ')' : case '{' : case '}' : case '[' : case ']' :
+      case ',' : case '.' : case ':' : case '@' : case '~' : case '?' :
+      case '*' : case '+' : case '-' : case '|' : case '/' : case '%' :
+      case '!' : case '^' : case '&' : case '>' : case '<' : case '=' :
+        GRN_TEXT_PUTC(ctx, shape, *cur);
+        cur++;
+        continue;
+      default :
+        break;
+      }
+    }
+    if (cur == start) {
+      /* An identifier: the same delimiters as get_identifier(). */
+      for (; cur < str_end; cur += len) {
+        if (!(len = grn_charlen(ctx, cur, str_end))) {
+          succeeded = GRN_FALSE;
+          goto exit;
+        }
+        if (grn_isspace(cur, ctx->encoding)) { break; }
+        if (len == 1) {
+          switch (*cur) {
+          case '\0' : case '(' : case ')' : case '{' : case '}' :
+          case '[' : case ']' : case ',' : case ':' : case '@' :
+          case '?' : case '"' : case '*' : case '+' : case '-' :
+          case '|' : case '/' : case '%' : case '!' : case '^' :
+          case '&' : case '>' : case '<' : case '=' : case '~' :
+            goto identifier_end;
+          }
+        }
+      }
+    identifier_end :
+      GRN_TEXT_PUT(ctx, shape, start, cur - start);
+      continue;
+    }
+    literal.offset = start - str;
+    literal.size = cur - start;
+    literal.nth_const = 0;
+    GRN_TEXT_PUTC(ctx, shape, '\0');
+    GRN_TEXT_PUT(ctx, shape, &(literal.domain), sizeof(grn_id));
+    GRN_TEXT_PUT(ctx, literals, &literal, sizeof(grn_expr_literal));
+  }
+exit :
+  GRN_OBJ_FIN(ctx, &number);
+  return succeeded;
+}
+
+/*
+ * Checks that the literals recorded by grn_expr_parse_with_literals() are
+ * the ones grn_expr_extract_literals() found and that each of them is
+ * still pushed as is, so that grn_expr_bind_literals() can replace them.
+ */
+grn_bool
+grn_expr_literals_bindable(grn_ctx *ctx, grn_obj *expr,
+                           grn_obj *extracted_literals,
+                           grn_obj *parsed_literals)
+{
+  grn_expr *e = (grn_expr *)expr;
+  grn_expr_literal *extracted, *parsed;
+  unsigned int i, n_literals;
+
+  if (GRN_BULK_VSIZE(extracted_literals) != GRN_BULK_VSIZE(parsed_literals)) {
+    return GRN_FALSE;
+  }
+  extracted = (grn_expr_literal *)GRN_BULK_HEAD(extracted_literals);
+  parsed = (grn_expr_literal *)GRN_BULK_HEAD(parsed_literals);
+  n_literals = GRN_BULK_VSIZE(parsed_literals) / sizeof(grn_expr_literal);
+  for (i = 0; i < n_literals; i++) {
+    grn_obj *value;
+    grn_expr_code *code, *code_end;
+
+    if (extracted[i].offset != parsed[i].offset ||
+        extracted[i].size != parsed[i].size ||
+        extracted[i].domain != parsed[i].domain) {
+      return GRN_FALSE;
+    }
+    if (parsed[i].nth_const >= e->nconsts) {
+      return GRN_FALSE;
+    }
+    value = e->consts + parsed[i].nth_const;
+    if (value->header.type != GRN_BULK ||
+        (value->header.impl_flags & GRN_OBJ_EXPRCONST_FOLDED)) {
+      return GRN_FALSE;
+    }
+    code_end = e->codes + e->codes_curr;
+    for (code = e->codes; code < code_end; code++) {
+      if (code->value == value) { break; }
+    }
+    if (code == code_end) {
+      return GRN_FALSE;
+    }
+  }
+  return GRN_TRUE;
+}
+
+/*
+ * Replaces the literals of an expression parsed from a string of the same
+ * shape by the ones in str. Literals are casted to the domains that the
+ * parser gave them. It returns an error without changing the remaining
+ * literals when a literal can't be casted; parse str again in the case.
+ */
+grn_rc
+grn_expr_bind_literals(grn_ctx *ctx, grn_obj *expr, const char *str,
+                       grn_obj *extracted_literals, grn_obj *parsed_literals)
+{
+  grn_rc rc = GRN_SUCCESS;
+  grn_expr *e = (grn_expr *)expr;
+  grn_expr_literal *extracted, *parsed;
+  unsigned int i, n_literals;
+  grn_obj literal_value;
+
+  extracted = (grn_expr_literal *)GRN_BULK_HEAD(extracted_literals);
+  parsed = (grn_expr_literal *)GRN_BULK_HEAD(parsed_literals);
+  n_literals = GRN_BULK_VSIZE(parsed_literals) / sizeof(grn_expr_literal);
+  GRN_VOID_INIT(&literal_value);
+  for (i = 0; i < n_literals && rc == GRN_SUCCESS; i++) {
+    const char *start = str + extracted[i].offset;
+    const char *end = start + extracted[i].size;
+    grn_obj *value = e->consts + parsed[i].nth_const;
+
+    if (*start == '"' || *start == '\'') {
+      const char *s;
+      unsigned int len;
+      GRN_OBJ_FIN(ctx, &literal_value);
+      GRN_TEXT_INIT(&literal_value, 0);
+      for (s = start + 1; s < end - 1; s += len) {
+        if (!(len = grn_charlen(ctx, s, end))) { break; }
+        if (len == 1 && *s == GRN_QUERY_ESCAPE && s + 1 < end) {
+          s++;
+          if (!(len = grn_charlen(ctx, s, end))) { break; }
+        }
+        GRN_TEXT_PUT(ctx, &literal_value, s, len);
+      }
+    } else {
+      get_number(ctx, start, end, &literal_value);
+    }
+
+    if (value->header.domain == literal_value.header.domain) {
+      GRN_BULK_REWIND(value);
+      grn_bulk_write(ctx, value,
+                     GRN_BULK_HEAD(&literal_value),
+                     GRN_BULK_VSIZE(&literal_value));
+    } else {
+      grn_obj casted_value;
+      GRN_OBJ_INIT(&casted_value, GRN_BULK, 0, value->header.domain);
+      rc = grn_obj_cast(ctx, &literal_value, &casted_value, GRN_FALSE);
+      if (rc == GRN_SUCCESS) {
+        GRN_BULK_REWIND(value);
+        grn_bulk_write(ctx, value,
+                       GRN_BULK_HEAD(&casted_value),
+                       GRN_BULK_VSIZE(&casted_value));
+      }
+      GRN_OBJ_FIN(ctx, &casted_value);
+    }
+  }
+  GRN_OBJ_FIN(ctx, &literal_value);
+  return rc;
+}
+
 grn_rc
 grn_expr_parser_close(grn_ctx *ctx)
 {
@@ -60,6 +60,30 @@ grn_obj *grn_scan_info_get_arg(grn_ctx *ctx, scan_info *si, int i);
 
 int32_t grn_expr_code_get_weight(grn_ctx *ctx, grn_expr_code *ec);
 
+typedef struct {
+  uint32_t offset;
+  uint32_t size;
+  grn_id domain;
+  uint32_t nth_const;
+} grn_expr_literal;
+
+grn_rc grn_expr_parse_with_literals(grn_ctx *ctx, grn_obj *expr,
+                                    const char *str, unsigned int str_size,
+                                    grn_obj *default_column,
+                                    grn_operator default_mode,
+                                    grn_operator default_op,
+                                    grn_expr_flags flags,
+                                    grn_obj *literals);
+grn_bool grn_expr_extract_literals(grn_ctx *ctx,
+                                   const char *str, unsigned int str_size,
+                                   grn_obj *shape, grn_obj *literals);
+grn_bool grn_expr_literals_bindable(grn_ctx *ctx, grn_obj *expr,
+                                    grn_obj *extracted_literals,
+                                    grn_obj *parsed_literals);
+grn_rc grn_expr_bind_literals(grn_ctx *ctx, grn_obj *expr, const char *str,
+                              grn_obj *extracted_literals,
+                              grn_obj *parsed_literals);
+
 #ifdef __cplusplus
 }
 #endif
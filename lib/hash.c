@@ -855,6 +855,12 @@ grn_array_at(grn_ctx *ctx, grn_array *array, grn_id id)
   return id;
 }
 
+grn_id
+grn_array_curr_id(grn_ctx *ctx, grn_array *array)
+{
+  return grn_array_get_max_id(array);
+}
+
 grn_rc
 grn_array_copy_sort_key(grn_ctx *ctx, grn_array *array,
                         grn_table_sort_key *keys, int n_keys)
@@ -1485,6 +1491,12 @@ grn_hash_entry_compare_key(grn_ctx *ctx, grn_hash *hash,
     }
     if (key_size == sizeof(uint32_t)) {
       return GRN_TRUE;
+    } else if (key_size == sizeof(uint64_t)) {
+      uint64_t key_value, entry_key_value;
+      memcpy(&key_value, key, sizeof(uint64_t));
+      memcpy(&entry_key_value, entry->rich_entry.key_and_value,
+             sizeof(uint64_t));
+      return key_value == entry_key_value;
     } else {
       return !memcmp(key, entry->rich_entry.key_and_value, key_size);
     }
@@ -1601,6 +1613,7 @@ grn_io_hash_init(grn_ctx *ctx, grn_hash *hash, const char *path,
   header->n_entries = 0;
   header->n_garbages = 0;
   header->tokenizer = GRN_ID_NIL;
+  header->hash_function = GRN_HASH_FUNCTION_WORD;
   if (header->flags & GRN_OBJ_KEY_NORMALIZE) {
     header->flags &= ~GRN_OBJ_KEY_NORMALIZE;
     hash->normalizer = grn_ctx_get(ctx, GRN_NORMALIZER_AUTO_NAME, -1);
@@ -1624,6 +1637,7 @@ grn_io_hash_init(grn_ctx *ctx, grn_hash *hash, const char *path,
   hash->header = header;
   hash->lock = &header->lock;
   hash->tokenizer = NULL;
+  hash->hash_function = header->hash_function;
   return GRN_SUCCESS;
 }
 
@@ -1683,6 +1697,7 @@ grn_tiny_hash_init(grn_ctx *ctx, grn_hash *hash, const char *path,
   hash->garbages = GRN_ID_NIL;
   hash->tokenizer = NULL;
   hash->normalizer = NULL;
+  hash->hash_function = GRN_HASH_FUNCTION_WORD;
   grn_tiny_array_init(ctx, &hash->a, entry_size, GRN_TINY_ARRAY_CLEAR);
   grn_tiny_bitmap_init(ctx, &hash->bitmap);
   return GRN_SUCCESS;
@@ -1732,7 +1747,14 @@ grn_hash_open(grn_ctx *ctx, const char *path)
     if (io) {
       struct grn_hash_header * const header = grn_io_header(io);
       if (grn_io_get_type(io) == GRN_TABLE_HASH_KEY) {
-        grn_hash * const hash = (grn_hash *)GRN_MALLOC(sizeof(grn_hash));
+        grn_hash *hash;
+        if (header->hash_function > GRN_HASH_FUNCTION_WORD) {
+          ERR(GRN_INVALID_FORMAT, "unknown hash function: <%u>",
+              header->hash_function);
+          grn_io_close(ctx, io);
+          return NULL;
+        }
+        hash = (grn_hash *)GRN_MALLOC(sizeof(grn_hash));
         if (hash) {
           if (!(header->flags & GRN_HASH_TINY)) {
             GRN_DB_OBJ_SET_TYPE(hash, GRN_TABLE_HASH_KEY);
@@ -1748,6 +1770,7 @@ grn_hash_open(grn_ctx *ctx, const char *path)
             hash->header = header;
             hash->lock = &header->lock;
             hash->tokenizer = grn_ctx_at(ctx, header->tokenizer);
+            hash->hash_function = header->hash_function;
             if (header->flags & GRN_OBJ_KEY_NORMALIZE) {
               header->flags &= ~GRN_OBJ_KEY_NORMALIZE;
               hash->normalizer = grn_ctx_get(ctx, GRN_NORMALIZER_AUTO_NAME, -1);
@@ -1877,6 +1900,76 @@ grn_hash_calculate_hash_value(const void *ptr, uint32_t size)
   return hash_value;
 }
 
+#define GRN_HASH_WORD_PRIME1 0x9e3779b185ebca87ULL
+#define GRN_HASH_WORD_PRIME2 0xc2b2ae3d27d4eb4fULL
+#define GRN_HASH_WORD_ROTL(x, r) (((x) << (r)) | ((x) >> (64 - (r))))
+
+/*
+ * grn_hash_calculate_word_hash_value() reads a key 8 bytes at a time.
+ * It is used for hashes created by this version. Persistent hashes
+ * created by old versions keep using grn_hash_calculate_hash_value().
+ *
+ * Keys up to 8 bytes use grn_hash_calculate_hash_value(). It is as fast
+ * as the word loop for them and spreads keys that differ only in their
+ * last bytes, such as serial numbers, to neighbouring slots.
+ */
+inline static uint32_t
+grn_hash_calculate_word_hash_value(const void *ptr, uint32_t size)
+{
+  const uint8_t *p = ptr;
+  const uint8_t *end = p + (size & ~7U);
+  uint64_t hash_value = size * GRN_HASH_WORD_PRIME1;
+  if (size <= sizeof(uint64_t)) {
+    return grn_hash_calculate_hash_value(ptr, size);
+  }
+  for (; p < end; p += sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, p, sizeof(uint64_t));
+    hash_value ^= word * GRN_HASH_WORD_PRIME2;
+    hash_value = GRN_HASH_WORD_ROTL(hash_value, 27) * GRN_HASH_WORD_PRIME1;
+  }
+  if (size & 7) {
+    uint64_t word = 0;
+    switch (size & 7) {
+    case 7 : word |= (uint64_t)p[6] << 48; /* fallthru */
+    case 6 : word |= (uint64_t)p[5] << 40; /* fallthru */
+    case 5 : word |= (uint64_t)p[4] << 32; /* fallthru */
+    case 4 : word |= (uint64_t)p[3] << 24; /* fallthru */
+    case 3 : word |= (uint64_t)p[2] << 16; /* fallthru */
+    case 2 : word |= (uint64_t)p[1] << 8;  /* fallthru */
+    case 1 : word |= (uint64_t)p[0];
+    }
+    hash_value ^= word * GRN_HASH_WORD_PRIME2;
+  }
+  hash_value ^= hash_value >> 32;
+  hash_value *= GRN_HASH_WORD_PRIME1;
+  hash_value ^= hash_value >> 29;
+  return (uint32_t)hash_value;
+}
+
+/*
+ * grn_hash_calculate_key_hash_value() returns the hash value of key with
+ * the hash function of hash. Fixed 4 bytes keys are used as is.
+ */
+inline static uint32_t
+grn_hash_calculate_key_hash_value(grn_hash *hash,
+                                  const void *key, uint32_t key_size)
+{
+  if (!(hash->obj.header.flags & GRN_OBJ_KEY_VAR_SIZE)) {
+    if (key_size == sizeof(uint32_t)) {
+      return *((uint32_t *)key);
+    }
+    if (key_size == sizeof(uint64_t)) {
+      /* Both functions are the same for 8 bytes keys. */
+      return grn_hash_calculate_hash_value(key, sizeof(uint64_t));
+    }
+  }
+  if (hash->hash_function == GRN_HASH_FUNCTION_WORD) {
+    return grn_hash_calculate_word_hash_value(key, key_size);
+  }
+  return grn_hash_calculate_hash_value(key, key_size);
+}
+
 inline static uint32_t
 grn_hash_calculate_step(uint32_t hash_value)
 {
@@ -2116,18 +2209,13 @@ grn_hash_add(grn_ctx *ctx, grn_hash *hash, const void *key,
       ERR(GRN_INVALID_ARGUMENT, "too long key");
       return GRN_ID_NIL;
     }
-    hash_value = grn_hash_calculate_hash_value(key, key_size);
   } else {
     if (key_size != hash->key_size) {
       ERR(GRN_INVALID_ARGUMENT, "key size unmatch");
       return GRN_ID_NIL;
     }
-    if (key_size == sizeof(uint32_t)) {
-      hash_value = *((uint32_t *)key);
-    } else {
-      hash_value = grn_hash_calculate_hash_value(key, key_size);
-    }
   }
+  hash_value = grn_hash_calculate_key_hash_value(hash, key, key_size);
 
   {
     uint32_t i;
@@ -2204,17 +2292,12 @@ grn_hash_get(grn_ctx *ctx, grn_hash *hash, const void *key,
     if (key_size > hash->key_size) {
       return GRN_ID_NIL;
     }
-    hash_value = grn_hash_calculate_hash_value(key, key_size);
   } else {
     if (key_size != hash->key_size) {
       return GRN_ID_NIL;
     }
-    if (key_size == sizeof(uint32_t)) {
-      hash_value = *((uint32_t *)key);
-    } else {
-      hash_value = grn_hash_calculate_hash_value(key, key_size);
-    }
   }
+  hash_value = grn_hash_calculate_key_hash_value(hash, key, key_size);
 
   {
     uint32_t i;
@@ -2482,15 +2565,10 @@ grn_hash_delete(grn_ctx *ctx, grn_hash *hash, const void *key, uint32_t key_size
   grn_rc rc = GRN_INVALID_ARGUMENT;
   if (hash->obj.header.flags & GRN_OBJ_KEY_VAR_SIZE) {
     if (key_size > hash->key_size) { return GRN_INVALID_ARGUMENT; }
-    h = grn_hash_calculate_hash_value(key, key_size);
   } else {
     if (key_size != hash->key_size) { return GRN_INVALID_ARGUMENT; }
-    if (key_size == sizeof(uint32_t)) {
-      h = *((uint32_t *)key);
-    } else {
-      h = grn_hash_calculate_hash_value(key, key_size);
-    }
   }
+  h = grn_hash_calculate_key_hash_value(hash, key, key_size);
   s = grn_hash_calculate_step(h);
   {
     grn_id e, *ep;
@@ -2635,6 +2713,12 @@ grn_hash_at(grn_ctx *ctx, grn_hash *hash, grn_id id)
   return grn_hash_bitmap_at(ctx, hash, id) ? id : GRN_ID_NIL;
 }
 
+grn_id
+grn_hash_curr_id(grn_ctx *ctx, grn_hash *hash)
+{
+  return HASH_CURR_MAX(hash);
+}
+
 int
 grn_hash_cursor_get_key(grn_ctx *ctx, grn_hash_cursor *c, void **key)
 {
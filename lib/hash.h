@@ -194,6 +194,12 @@ GRN_API grn_id grn_table_queue_tail(grn_table_queue *queue);
 #define GRN_HASH_TINY         (0x01<<6)
 #define GRN_HASH_MAX_KEY_SIZE GRN_TABLE_MAX_KEY_SIZE
 
+/* Hash functions for keys. Files created by old versions use BYTE.
+   Old versions ignore this field, so they can't read files that use
+   another function. grn_hash_open() rejects unknown functions. */
+#define GRN_HASH_FUNCTION_BYTE 0
+#define GRN_HASH_FUNCTION_WORD 1
+
 struct _grn_hash {
   grn_db_obj obj;
   grn_ctx *ctx;
@@ -206,6 +212,7 @@ struct _grn_hash {
   uint32_t *max_offset;
   grn_obj *tokenizer;
   grn_obj *normalizer;
+  uint32_t hash_function;
 
   /* For grn_io_hash. */
   grn_io *io;
@@ -250,7 +257,8 @@ struct grn_hash_header {
   uint32_t n_garbages;
   uint32_t lock;
   grn_id normalizer;
-  uint32_t reserved[15];
+  uint32_t hash_function;
+  uint32_t reserved[14];
   grn_id garbages[GRN_HASH_MAX_KEY_SIZE];
   grn_table_queue queue;
 };
@@ -336,6 +344,8 @@ grn_rc grn_array_remove(grn_ctx *ctx, const char *path);
 
 grn_id grn_hash_at(grn_ctx *ctx, grn_hash *hash, grn_id id);
 grn_id grn_array_at(grn_ctx *ctx, grn_array *array, grn_id id);
+grn_id grn_hash_curr_id(grn_ctx *ctx, grn_hash *hash);
+grn_id grn_array_curr_id(grn_ctx *ctx, grn_array *array);
 
 void grn_hash_check(grn_ctx *ctx, grn_hash *hash);
 
@@ -18,6 +18,7 @@
 #include <stdio.h>
 #include <fcntl.h>
 #include <string.h>
+#include <math.h>
 #include <sys/stat.h>
 
 #include "ii.h"
@@ -46,6 +47,10 @@
 
 #define MAX_N_ELEMENTS           5
 
+/* The number of section lengths kept per record by an index with sections.
+   The lengths of the other sections are read from the sources. */
+#define N_SECTION_LENGTHS        4
+
 #define LSEG(pos) ((pos) >> 16)
 #define LPOS(pos) (((pos) & 0xffff) << 2)
 #define SEG2POS(seg,pos) ((((uint32_t)(seg)) << 16) + (((uint32_t)(pos)) >> 2))
@@ -1614,6 +1619,155 @@ grn_p_encv(grn_ctx *ctx, datavec *dv, uint32_t dvlen, uint8_t *res)
   p = _p; \
 } while (0)
 
+typedef uint8_t *(*unpack_func)(uint32_t *p, uint8_t *dp);
+
+static const unpack_func unpack_funcs[] = {
+  NULL,
+  unpack_1, unpack_2, unpack_3, unpack_4,
+  unpack_5, unpack_6, unpack_7, unpack_8,
+  unpack_9, unpack_10, unpack_11, unpack_12,
+  unpack_13, unpack_14, unpack_15, unpack_16,
+  unpack_17, unpack_18, unpack_19, unpack_20,
+  unpack_21, unpack_22, unpack_23, unpack_24,
+  unpack_25, unpack_26, unpack_27, unpack_28,
+  unpack_29, unpack_30, unpack_31, unpack_32
+};
+
+#if defined(__x86_64__) && \
+  ((defined(__GNUC__) && __GNUC_PREREQ(4, 9)) || defined(__clang__))
+# define USE_UNPACK_AVX2
+#endif
+
+#ifdef USE_UNPACK_AVX2
+#include <immintrin.h>
+
+/*
+ * AVX2 version of unpack_1 ... unpack_25. Values 0-3 and 4-7 of a group
+ * are loaded into each 128-bit lane. Each value's 4 bytes are gathered
+ * in big endian order by a shuffle and then shifted into place.
+ */
+#define UNPACK_AVX2_MAX_WIDTH 25
+
+/* generated: shuffle indexes and left shifts for each width */
+static const uint8_t unpack_avx2_shuffles[UNPACK_AVX2_MAX_WIDTH + 1][32] = {
+  {0},
+  {3, 2, 1, 0, 3, 2, 1, 0, 3, 2, 1, 0, 3, 2, 1, 0,
+   3, 2, 1, 0, 3, 2, 1, 0, 3, 2, 1, 0, 3, 2, 1, 0},
+  {3, 2, 1, 0, 3, 2, 1, 0, 3, 2, 1, 0, 3, 2, 1, 0,
+   3, 2, 1, 0, 3, 2, 1, 0, 3, 2, 1, 0, 3, 2, 1, 0},
+  {3, 2, 1, 0, 3, 2, 1, 0, 3, 2, 1, 0, 4, 3, 2, 1,
+   3, 2, 1, 0, 3, 2, 1, 0, 4, 3, 2, 1, 4, 3, 2, 1},
+  {3, 2, 1, 0, 3, 2, 1, 0, 4, 3, 2, 1, 4, 3, 2, 1,
+   3, 2, 1, 0, 3, 2, 1, 0, 4, 3, 2, 1, 4, 3, 2, 1},
+  {3, 2, 1, 0, 3, 2, 1, 0, 4, 3, 2, 1, 4, 3, 2, 1,
+   3, 2, 1, 0, 4, 3, 2, 1, 4, 3, 2, 1, 5, 4, 3, 2},
+  {3, 2, 1, 0, 3, 2, 1, 0, 4, 3, 2, 1, 5, 4, 3, 2,
+   3, 2, 1, 0, 3, 2, 1, 0, 4, 3, 2, 1, 5, 4, 3, 2},
+  {3, 2, 1, 0, 3, 2, 1, 0, 4, 3, 2, 1, 5, 4, 3, 2,
+   3, 2, 1, 0, 4, 3, 2, 1, 5, 4, 3, 2, 6, 5, 4, 3},
+  {3, 2, 1, 0, 4, 3, 2, 1, 5, 4, 3, 2, 6, 5, 4, 3,
+   3, 2, 1, 0, 4, 3, 2, 1, 5, 4, 3, 2, 6, 5, 4, 3},
+  {3, 2, 1, 0, 4, 3, 2, 1, 5, 4, 3, 2, 6, 5, 4, 3,
+   3, 2, 1, 0, 4, 3, 2, 1, 5, 4, 3, 2, 6, 5, 4, 3},
+  {3, 2, 1, 0, 4, 3, 2, 1, 5, 4, 3, 2, 6, 5, 4, 3,
+   3, 2, 1, 0, 4, 3, 2, 1, 5, 4, 3, 2, 6, 5, 4, 3},
+  {3, 2, 1, 0, 4, 3, 2, 1, 5, 4, 3, 2, 7, 6, 5, 4,
+   3, 2, 1, 0, 4, 3, 2, 1, 6, 5, 4, 3, 7, 6, 5, 4},
+  {3, 2, 1, 0, 4, 3, 2, 1, 6, 5, 4, 3, 7, 6, 5, 4,
+   3, 2, 1, 0, 4, 3, 2, 1, 6, 5, 4, 3, 7, 6, 5, 4},
+  {3, 2, 1, 0, 4, 3, 2, 1, 6, 5, 4, 3, 7, 6, 5, 4,
+   3, 2, 1, 0, 5, 4, 3, 2, 6, 5, 4, 3, 8, 7, 6, 5},
+  {3, 2, 1, 0, 4, 3, 2, 1, 6, 5, 4, 3, 8, 7, 6, 5,
+   3, 2, 1, 0, 4, 3, 2, 1, 6, 5, 4, 3, 8, 7, 6, 5},
+  {3, 2, 1, 0, 4, 3, 2, 1, 6, 5, 4, 3, 8, 7, 6, 5,
+   3, 2, 1, 0, 5, 4, 3, 2, 7, 6, 5, 4, 9, 8, 7, 6},
+  {3, 2, 1, 0, 5, 4, 3, 2, 7, 6, 5, 4, 9, 8, 7, 6,
+   3, 2, 1, 0, 5, 4, 3, 2, 7, 6, 5, 4, 9, 8, 7, 6},
+  {3, 2, 1, 0, 5, 4, 3, 2, 7, 6, 5, 4, 9, 8, 7, 6,
+   3, 2, 1, 0, 5, 4, 3, 2, 7, 6, 5, 4, 9, 8, 7, 6},
+  {3, 2, 1, 0, 5, 4, 3, 2, 7, 6, 5, 4, 9, 8, 7, 6,
+   3, 2, 1, 0, 5, 4, 3, 2, 7, 6, 5, 4, 9, 8, 7, 6},
+  {3, 2, 1, 0, 5, 4, 3, 2, 7, 6, 5, 4, 10, 9, 8, 7,
+   3, 2, 1, 0, 5, 4, 3, 2, 8, 7, 6, 5, 10, 9, 8, 7},
+  {3, 2, 1, 0, 5, 4, 3, 2, 8, 7, 6, 5, 10, 9, 8, 7,
+   3, 2, 1, 0, 5, 4, 3, 2, 8, 7, 6, 5, 10, 9, 8, 7},
+  {3, 2, 1, 0, 5, 4, 3, 2, 8, 7, 6, 5, 10, 9, 8, 7,
+   3, 2, 1, 0, 6, 5, 4, 3, 8, 7, 6, 5, 11, 10, 9, 8},
+  {3, 2, 1, 0, 5, 4, 3, 2, 8, 7, 6, 5, 11, 10, 9, 8,
+   3, 2, 1, 0, 5, 4, 3, 2, 8, 7, 6, 5, 11, 10, 9, 8},
+  {3, 2, 1, 0, 5, 4, 3, 2, 8, 7, 6, 5, 11, 10, 9, 8,
+   3, 2, 1, 0, 6, 5, 4, 3, 9, 8, 7, 6, 12, 11, 10, 9},
+  {3, 2, 1, 0, 6, 5, 4, 3, 9, 8, 7, 6, 12, 11, 10, 9,
+   3, 2, 1, 0, 6, 5, 4, 3, 9, 8, 7, 6, 12, 11, 10, 9},
+  {3, 2, 1, 0, 6, 5, 4, 3, 9, 8, 7, 6, 12, 11, 10, 9,
+   3, 2, 1, 0, 6, 5, 4, 3, 9, 8, 7, 6, 12, 11, 10, 9}
+};
+static const int32_t unpack_avx2_shifts[UNPACK_AVX2_MAX_WIDTH + 1][8] = {
+  {0},
+  {0, 1, 2, 3, 4, 5, 6, 7},
+  {0, 2, 4, 6, 0, 2, 4, 6},
+  {0, 3, 6, 1, 4, 7, 2, 5},
+  {0, 4, 0, 4, 0, 4, 0, 4},
+  {0, 5, 2, 7, 4, 1, 6, 3},
+  {0, 6, 4, 2, 0, 6, 4, 2},
+  {0, 7, 6, 5, 4, 3, 2, 1},
+  {0, 0, 0, 0, 0, 0, 0, 0},
+  {0, 1, 2, 3, 4, 5, 6, 7},
+  {0, 2, 4, 6, 0, 2, 4, 6},
+  {0, 3, 6, 1, 4, 7, 2, 5},
+  {0, 4, 0, 4, 0, 4, 0, 4},
+  {0, 5, 2, 7, 4, 1, 6, 3},
+  {0, 6, 4, 2, 0, 6, 4, 2},
+  {0, 7, 6, 5, 4, 3, 2, 1},
+  {0, 0, 0, 0, 0, 0, 0, 0},
+  {0, 1, 2, 3, 4, 5, 6, 7},
+  {0, 2, 4, 6, 0, 2, 4, 6},
+  {0, 3, 6, 1, 4, 7, 2, 5},
+  {0, 4, 0, 4, 0, 4, 0, 4},
+  {0, 5, 2, 7, 4, 1, 6, 3},
+  {0, 6, 4, 2, 0, 6, 4, 2},
+  {0, 7, 6, 5, 4, 3, 2, 1},
+  {0, 0, 0, 0, 0, 0, 0, 0},
+  {0, 1, 2, 3, 4, 5, 6, 7}
+};
+
+static int unpack_avx2_available = -1;
+
+inline static int
+unpack_avx2_is_available(void)
+{
+  if (unpack_avx2_available < 0) {
+    __builtin_cpu_init();
+    unpack_avx2_available = __builtin_cpu_supports("avx2") ? 1 : 0;
+  }
+  return unpack_avx2_available;
+}
+
+__attribute__((target("avx2")))
+static int
+unpack_avx2(uint32_t *p, uint8_t *dp, uint8_t *dpe, int w, int n_groups)
+{
+  int n = 0;
+  uint32_t b1 = (4 * w) >> 3;
+  __m256i shuffle =
+    _mm256_loadu_si256((const __m256i *)unpack_avx2_shuffles[w]);
+  __m256i lshifts =
+    _mm256_loadu_si256((const __m256i *)unpack_avx2_shifts[w]);
+  __m128i rshift = _mm_cvtsi32_si128(32 - w);
+  /* each lane reads 16 bytes, more than the group itself */
+  for (; n < n_groups && dp + b1 + 16 <= dpe; n++, p += 8, dp += w) {
+    __m128i lo = _mm_loadu_si128((const __m128i *)dp);
+    __m128i hi = _mm_loadu_si128((const __m128i *)(dp + b1));
+    __m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+    v = _mm256_shuffle_epi8(v, shuffle);
+    v = _mm256_sllv_epi32(v, lshifts);
+    v = _mm256_srl_epi32(v, rshift);
+    _mm256_storeu_si256((__m256i *)p, v);
+  }
+  return n;
+}
+#endif /* USE_UNPACK_AVX2 */
+
 static uint8_t *
 unpack(uint8_t *dp, uint8_t *dpe, int i, uint32_t *rp)
 {
@@ -1627,46 +1781,19 @@ unpack(uint8_t *dp, uint8_t *dpe, int i, uint32_t *rp)
   } else {
     m = (1 << w) - 1;
   }
+  if (w > 32) { return NULL; }
   if (w) {
-    while (i >= 8) {
-      if (dp + w > dpe) { return NULL; }
-      switch (w) {
-      case 1 : dp = unpack_1(p, dp); break;
-      case 2 : dp = unpack_2(p, dp); break;
-      case 3 : dp = unpack_3(p, dp); break;
-      case 4 : dp = unpack_4(p, dp); break;
-      case 5 : dp = unpack_5(p, dp); break;
-      case 6 : dp = unpack_6(p, dp); break;
-      case 7 : dp = unpack_7(p, dp); break;
-      case 8 : dp = unpack_8(p, dp); break;
-      case 9 : dp = unpack_9(p, dp); break;
-      case 10 : dp = unpack_10(p, dp); break;
-      case 11 : dp = unpack_11(p, dp); break;
-      case 12 : dp = unpack_12(p, dp); break;
-      case 13 : dp = unpack_13(p, dp); break;
-      case 14 : dp = unpack_14(p, dp); break;
-      case 15 : dp = unpack_15(p, dp); break;
-      case 16 : dp = unpack_16(p, dp); break;
-      case 17 : dp = unpack_17(p, dp); break;
-      case 18 : dp = unpack_18(p, dp); break;
-      case 19 : dp = unpack_19(p, dp); break;
-      case 20 : dp = unpack_20(p, dp); break;
-      case 21 : dp = unpack_21(p, dp); break;
-      case 22 : dp = unpack_22(p, dp); break;
-      case 23 : dp = unpack_23(p, dp); break;
-      case 24 : dp = unpack_24(p, dp); break;
-      case 25 : dp = unpack_25(p, dp); break;
-      case 26 : dp = unpack_26(p, dp); break;
-      case 27 : dp = unpack_27(p, dp); break;
-      case 28 : dp = unpack_28(p, dp); break;
-      case 29 : dp = unpack_29(p, dp); break;
-      case 30 : dp = unpack_30(p, dp); break;
-      case 31 : dp = unpack_31(p, dp); break;
-      case 32 : dp = unpack_32(p, dp); break;
-      }
-      i -= 8;
-      p += 8;
-    }
+    unpack_func unpacker = unpack_funcs[w];
+    if (dp + w * (i >> 3) > dpe) { return NULL; }
+#ifdef USE_UNPACK_AVX2
+    if (w <= UNPACK_AVX2_MAX_WIDTH && i >= 8 && unpack_avx2_is_available()) {
+      int n = unpack_avx2(p, dp, dpe, w, i >> 3);
+      i -= n * 8;
+      p += n * 8;
+      dp += n * w;
+    }
+#endif /* USE_UNPACK_AVX2 */
+    for (; i >= 8; i -= 8, p += 8) { dp = unpacker(p, dp); }
     {
       int b;
       uint32_t v, *pe;
@@ -3442,11 +3569,22 @@ buffer_new(grn_ctx *ctx, grn_ii *ii, int size, uint32_t *pos,
 
 /* ii */
 
+static uint32_t
+section_lengths_element_size(uint32_t flags)
+{
+  if (flags & GRN_OBJ_WITH_SECTION) {
+    return sizeof(uint32_t) * N_SECTION_LENGTHS;
+  } else {
+    return sizeof(uint32_t);
+  }
+}
+
 static grn_ii *
 _grn_ii_create(grn_ctx *ctx, grn_ii *ii, const char *path, grn_obj *lexicon, uint32_t flags)
 {
   int i;
   grn_io *seg, *chunk;
+  grn_ra *section_lengths;
   char path2[PATH_MAX];
   struct grn_ii_header *header;
   grn_obj_flags lflags;
@@ -3465,6 +3603,7 @@ _grn_ii_create(grn_ctx *ctx, grn_ii *ii, const char *path, grn_obj *lexicon, uin
   seg = grn_io_create(ctx, path, sizeof(struct grn_ii_header),
                       S_SEGMENT, GRN_II_MAX_LSEG, grn_io_auto, GRN_IO_EXPIRE_SEGMENT);
   if (!seg) { return NULL; }
+  grn_io_pin(seg);
   if (path) {
     strcpy(path2, path);
     strcat(path2, ".c");
@@ -3477,6 +3616,20 @@ _grn_ii_create(grn_ctx *ctx, grn_ii *ii, const char *path, grn_obj *lexicon, uin
     grn_io_close(ctx, seg);
     return NULL;
   }
+  if (path) {
+    strcpy(path2, path);
+    strcat(path2, ".l");
+    section_lengths = grn_ra_create(ctx, path2,
+                                    section_lengths_element_size(flags));
+  } else {
+    section_lengths = grn_ra_create(ctx, NULL,
+                                    section_lengths_element_size(flags));
+  }
+  if (!section_lengths) {
+    grn_io_close(ctx, seg);
+    grn_io_close(ctx, chunk);
+    return NULL;
+  }
   header = grn_io_header(seg);
   grn_io_set_type(seg, GRN_COLUMN_INDEX);
   for (i = 0; i < GRN_II_MAX_LSEG; i++) {
@@ -3490,6 +3643,7 @@ _grn_ii_create(grn_ctx *ctx, grn_ii *ii, const char *path, grn_obj *lexicon, uin
   header->flags = flags;
   ii->seg = seg;
   ii->chunk = chunk;
+  ii->section_lengths = section_lengths;
   ii->lexicon = lexicon;
   ii->lflags = lflags;
   ii->encoding = encoding;
@@ -3521,10 +3675,15 @@ grn_ii_remove(grn_ctx *ctx, const char *path)
 {
   grn_rc rc;
   char buffer[PATH_MAX];
+  struct stat s;
   if (!path || strlen(path) > PATH_MAX - 4) { return GRN_INVALID_ARGUMENT; }
   if ((rc = grn_io_remove(ctx, path))) { goto exit; }
   snprintf(buffer, PATH_MAX, "%s.c", path);
-  rc = grn_io_remove(ctx, buffer);
+  if ((rc = grn_io_remove(ctx, buffer))) { goto exit; }
+  snprintf(buffer, PATH_MAX, "%s.l", path);
+  if (!stat(buffer, &s)) {
+    rc = grn_io_remove(ctx, buffer);
+  }
 exit :
   return rc;
 }
@@ -3533,8 +3692,8 @@ grn_rc
 grn_ii_truncate(grn_ctx *ctx, grn_ii *ii)
 {
   grn_rc rc;
-  const char *io_segpath, *io_chunkpath;
-  char *segpath, *chunkpath = NULL;
+  const char *io_segpath, *io_chunkpath, *io_lengthspath;
+  char *segpath, *chunkpath = NULL, *lengthspath = NULL;
   grn_obj *lexicon;
   uint32_t flags;
   if ((io_segpath = grn_io_path(ii->seg)) && *io_segpath != '\0') {
@@ -3550,6 +3709,15 @@ grn_ii_truncate(grn_ctx *ctx, grn_ii *ii)
     } else {
       chunkpath = NULL;
     }
+    if (ii->section_lengths &&
+        (io_lengthspath = grn_io_path(ii->section_lengths->io)) &&
+        *io_lengthspath != '\0') {
+      if (!(lengthspath = GRN_STRDUP(io_lengthspath))) {
+        ERR(GRN_NO_MEMORY_AVAILABLE, "cannot duplicate path: <%s>",
+            io_lengthspath);
+        return GRN_NO_MEMORY_AVAILABLE;
+      }
+    }
   } else {
     segpath = NULL;
   }
@@ -3557,16 +3725,23 @@ grn_ii_truncate(grn_ctx *ctx, grn_ii *ii)
   flags = ii->header->flags;
   if ((rc = grn_io_close(ctx, ii->seg))) { goto exit; }
   if ((rc = grn_io_close(ctx, ii->chunk))) { goto exit; }
+  if (ii->section_lengths &&
+      (rc = grn_ra_close(ctx, ii->section_lengths))) {
+    goto exit;
+  }
   ii->seg = NULL;
   ii->chunk = NULL;
+  ii->section_lengths = NULL;
   if (segpath && (rc = grn_io_remove(ctx, segpath))) { goto exit; }
   if (chunkpath && (rc = grn_io_remove(ctx, chunkpath))) { goto exit; }
+  if (lengthspath && (rc = grn_io_remove(ctx, lengthspath))) { goto exit; }
   if (!_grn_ii_create(ctx, ii, segpath, lexicon, flags)) {
     rc = GRN_UNKNOWN_ERROR;
   }
 exit:
   if (segpath) { GRN_FREE(segpath); }
   if (chunkpath) { GRN_FREE(chunkpath); }
+  if (lengthspath) { GRN_FREE(lengthspath); }
   return rc;
 }
 
@@ -3574,8 +3749,10 @@ grn_ii *
 grn_ii_open(grn_ctx *ctx, const char *path, grn_obj *lexicon)
 {
   grn_io *seg, *chunk;
+  grn_ra *section_lengths = NULL;
   grn_ii *ii;
   char path2[PATH_MAX];
+  struct stat s;
   struct grn_ii_header *header;
   grn_obj_flags lflags;
   grn_encoding encoding;
@@ -3588,6 +3765,7 @@ grn_ii_open(grn_ctx *ctx, const char *path, grn_obj *lexicon)
   strcat(path2, ".c");
   seg = grn_io_open(ctx, path, grn_io_auto);
   if (!seg) { return NULL; }
+  grn_io_pin(seg);
   chunk = grn_io_open(ctx, path2, grn_io_auto);
   if (!chunk) {
     grn_io_close(ctx, seg);
@@ -3600,14 +3778,24 @@ grn_ii_open(grn_ctx *ctx, const char *path, grn_obj *lexicon)
     grn_io_close(ctx, chunk);
     return NULL;
   }
+  strcpy(path2, path);
+  strcat(path2, ".l");
+  /* Indexes created by old versions don't have section lengths. */
+  if (!stat(path2, &s) && !(section_lengths = grn_ra_open(ctx, path2))) {
+    grn_io_close(ctx, seg);
+    grn_io_close(ctx, chunk);
+    return NULL;
+  }
   if (!(ii = GRN_GMALLOC(sizeof(grn_ii)))) {
     grn_io_close(ctx, seg);
     grn_io_close(ctx, chunk);
+    if (section_lengths) { grn_ra_close(ctx, section_lengths); }
     return NULL;
   }
   GRN_DB_OBJ_SET_TYPE(ii, GRN_COLUMN_INDEX);
   ii->seg = seg;
   ii->chunk = chunk;
+  ii->section_lengths = section_lengths;
   ii->lexicon = lexicon;
   ii->lflags = lflags;
   ii->encoding = encoding;
@@ -3626,6 +3814,10 @@ grn_ii_close(grn_ctx *ctx, grn_ii *ii)
   if (!ii) { return GRN_INVALID_ARGUMENT; }
   if ((rc = grn_io_close(ctx, ii->seg))) { return rc; }
   if ((rc = grn_io_close(ctx, ii->chunk))) { return rc; }
+  if (ii->section_lengths &&
+      (rc = grn_ra_close(ctx, ii->section_lengths))) {
+    return rc;
+  }
   GRN_GFREE(ii);
   /*
   {
@@ -3930,6 +4122,7 @@ struct _grn_ii_cursor {
   int nelements;
   uint32_t nchunks;
   uint32_t curr_chunk;
+  grn_id crid;
   chunk_info *cinfo;
   grn_io_win iw;
   uint8_t *cp;
@@ -4068,7 +4261,10 @@ grn_ii_cursor_open(grn_ctx *ctx, grn_ii *ii, grn_id tid,
             GRN_B_DEC(c->cinfo[i].size, c->cp);
             GRN_B_DEC(c->cinfo[i].dgap, c->cp);
             crid += c->cinfo[i].dgap;
-            if (crid < min) { c->curr_chunk = i + 1; }
+            if (crid < min) {
+              c->curr_chunk = i + 1;
+              c->crid = crid;
+            }
           }
           if (chunk_is_reused(ctx, ii, c, chunk, c->buf->header.chunk_size)) {
             grn_ii_cursor_close(ctx, c);
@@ -4185,6 +4381,9 @@ grn_ii_cursor_next(grn_ctx *ctx, grn_ii_cursor *c)
               c->pc.rid = 0;
               c->pc.sid = 0;
               c->pc.rest = 0;
+              if (c->curr_chunk < c->nchunks) {
+                c->crid += c->cinfo[c->curr_chunk].dgap;
+              }
               c->curr_chunk++;
               continue;
             } else {
@@ -4275,6 +4474,53 @@ grn_ii_cursor_next(grn_ctx *ctx, grn_ii_cursor *c)
   return c->post;
 }
 
+/*
+  Advances the cursor to the first posting which is equal to or greater
+  than (rid, sid). Split chunks whose last record ID is less than rid are
+  skipped without decoding them and the rest of the current chunk is
+  walked without merging with the buffer.
+*/
+grn_ii_posting *
+grn_ii_cursor_seek(grn_ctx *ctx, grn_ii_cursor *c, grn_id rid, uint32_t sid)
+{
+  if (c->post &&
+      (c->post->rid > rid || (c->post->rid == rid && c->post->sid >= sid))) {
+    return c->post;
+  }
+  if (c->buf && c->pc.rid < rid) {
+    if (c->crid < rid && c->curr_chunk < c->nchunks) {
+      c->crp = c->cdp + c->cdf;
+      while (c->curr_chunk < c->nchunks &&
+             c->crid + c->cinfo[c->curr_chunk].dgap < rid) {
+        c->crid += c->cinfo[c->curr_chunk].dgap;
+        c->curr_chunk++;
+      }
+      c->pc.rid = 0;
+    } else {
+      while (c->crp < c->cdp + c->cdf && c->pc.rid + *c->crp < rid) {
+        uint32_t dgap = *c->crp++;
+        c->pc.rid += dgap;
+        if (dgap) { c->pc.sid = 0; }
+        if ((c->ii->header->flags & GRN_OBJ_WITH_SECTION)) {
+          c->pc.sid += 1 + *c->csp++;
+        } else {
+          c->pc.sid = 1;
+        }
+        c->cpp += c->pc.rest;
+        c->pc.rest = c->pc.tf = 1 + *c->ctp++;
+        if ((c->ii->header->flags & GRN_OBJ_WITH_WEIGHT)) { c->cwp++; }
+      }
+    }
+    c->stat |= CHUNK_USED;
+  }
+  while (grn_ii_cursor_next(ctx, c)) {
+    if (c->post->rid > rid || (c->post->rid == rid && c->post->sid >= sid)) {
+      break;
+    }
+  }
+  return c->post;
+}
+
 grn_ii_posting *
 grn_ii_cursor_next_pos(grn_ctx *ctx, grn_ii_cursor *c)
 {
@@ -4388,6 +4634,121 @@ grn_ii_estimate_size(grn_ctx *ctx, grn_ii *ii, grn_id tid)
   return res;
 }
 
+static uint64_t
+ii_prefetch_chunk(grn_ctx *ctx, grn_ii *ii, uint32_t chunk,
+                  uint32_t pos, uint32_t size)
+{
+  return grn_io_prefetch(ctx, ii->chunk,
+                         chunk >> GRN_II_N_CHUNK_VARIATION,
+                         ((chunk & ((1 << GRN_II_N_CHUNK_VARIATION) - 1))
+                          << GRN_II_W_LEAST_CHUNK) + pos,
+                         size);
+}
+
+static uint64_t
+ii_prefetch_term(grn_ctx *ctx, grn_ii *ii, grn_id tid)
+{
+  uint64_t n_bytes = 0;
+  uint32_t pos, *a;
+  a = array_at(ctx, ii, tid);
+  if (!a) { return 0; }
+  if ((pos = a[0]) && !(pos & 1)) {
+    buffer *b;
+    buffer_term *bt;
+    uint32_t pseg, chunk;
+    if ((pseg = buffer_open(ctx, ii, pos, &bt, &b)) != NOT_ASSIGNED) {
+      if (bt->size_in_chunk && (chunk = b->header.chunk) != NOT_ASSIGNED) {
+        n_bytes += ii_prefetch_chunk(ctx, ii, chunk,
+                                     bt->pos_in_chunk, bt->size_in_chunk);
+        if ((bt->tid & CHUNK_SPLIT)) {
+          grn_io_win iw;
+          uint8_t *cp, *cpe;
+          if ((cp = WIN_MAP2(ii->chunk, ctx, &iw, chunk, bt->pos_in_chunk,
+                             bt->size_in_chunk, grn_io_rdonly))) {
+            uint32_t i, nchunks, segno, size, dgap;
+            cpe = cp + bt->size_in_chunk;
+            GRN_B_DEC(nchunks, cp);
+            for (i = 0; i < nchunks && cp < cpe; i++) {
+              GRN_B_DEC(segno, cp);
+              GRN_B_DEC(size, cp);
+              GRN_B_DEC(dgap, cp);
+              n_bytes += ii_prefetch_chunk(ctx, ii, segno, 0, size);
+            }
+            grn_io_win_unmap2(&iw);
+          }
+        }
+      }
+      buffer_close(ctx, ii, pseg);
+    }
+  }
+  array_unref(ii, tid);
+  return n_bytes;
+}
+
+typedef struct {
+  grn_id tid;
+  uint32_t size;
+} prefetch_term;
+
+static int
+prefetch_term_compare(const void *t1, const void *t2)
+{
+  const prefetch_term *x = t1, *y = t2;
+  if (x->size == y->size) { return x->tid < y->tid ? -1 : (x->tid > y->tid); }
+  return x->size > y->size ? -1 : 1;
+}
+
+/*
+  Prefetches the buffer and array segments of ii and then the chunks of its
+  terms in descending order of grn_ii_estimate_size() so that the postings
+  of frequent terms get into the page cache first.
+*/
+uint64_t
+grn_ii_prefetch(grn_ctx *ctx, grn_ii *ii)
+{
+  uint64_t n_bytes;
+  uint32_t i, n_terms = 0, max_n_terms;
+  prefetch_term *terms;
+  grn_table_cursor *tc;
+  char name[GRN_TABLE_MAX_KEY_SIZE];
+  int name_size;
+  name_size = grn_obj_name(ctx, (grn_obj *)ii, name, GRN_TABLE_MAX_KEY_SIZE);
+  n_bytes = grn_io_prefetch(ctx, ii->seg, 0, 0, 0);
+  max_n_terms = grn_table_size(ctx, ii->lexicon);
+  if (!max_n_terms) { return n_bytes; }
+  if (!(terms = GRN_MALLOC(sizeof(prefetch_term) * max_n_terms))) {
+    return n_bytes;
+  }
+  if ((tc = grn_table_cursor_open(ctx, ii->lexicon, NULL, 0, NULL, 0, 0, -1,
+                                  GRN_CURSOR_BY_ID))) {
+    grn_id tid;
+    while (n_terms < max_n_terms &&
+           (tid = grn_table_cursor_next(ctx, tc)) != GRN_ID_NIL) {
+      uint32_t size = grn_ii_estimate_size(ctx, ii, tid);
+      /* 1 means that the posting is stored in the array segment. */
+      if (size > 1) {
+        terms[n_terms].tid = tid;
+        terms[n_terms].size = size;
+        n_terms++;
+      }
+    }
+    grn_table_cursor_close(ctx, tc);
+  }
+  qsort(terms, n_terms, sizeof(prefetch_term), prefetch_term_compare);
+  for (i = 0; i < n_terms; i++) {
+    uint32_t progress = (uint32_t)((uint64_t)(i + 1) * 10 / n_terms);
+    n_bytes += ii_prefetch_term(ctx, ii, terms[i].tid);
+    if (progress != (uint32_t)((uint64_t)i * 10 / n_terms)) {
+      GRN_LOG(ctx, GRN_LOG_INFO,
+              "[ii][prefetch] <%.*s>: %u/%u terms: %" GRN_FMT_LLU " bytes",
+              name_size, name, i + 1, n_terms,
+              (unsigned long long int)n_bytes);
+    }
+  }
+  GRN_FREE(terms);
+  return n_bytes;
+}
+
 int
 grn_ii_entry_info(grn_ctx *ctx, grn_ii *ii, grn_id tid, unsigned int *a,
                    unsigned int *chunk, unsigned int *chunk_size, unsigned int *buffer_free,
@@ -4565,6 +4926,26 @@ cursor_heap_pop(grn_ctx *ctx, cursor_heap *h)
   }
 }
 
+static inline void
+cursor_heap_skip(grn_ctx *ctx, cursor_heap *h, grn_id rid, uint32_t sid)
+{
+  grn_ii_cursor *c;
+  while ((c = cursor_heap_min(h))) {
+    if (c->post->rid > rid || (c->post->rid == rid && c->post->sid >= sid)) {
+      break;
+    }
+    if (!grn_ii_cursor_seek(ctx, c, rid, sid)) {
+      grn_ii_cursor_close(ctx, c);
+      h->bins[0] = h->bins[--h->n_entries];
+    } else if (!grn_ii_cursor_next_pos(ctx, c)) {
+      GRN_LOG(ctx, GRN_LOG_ERROR, "invalid ii_cursor e");
+      grn_ii_cursor_close(ctx, c);
+      h->bins[0] = h->bins[--h->n_entries];
+    }
+    if (h->n_entries > 1) { cursor_heap_recalc_min(h); }
+  }
+}
+
 static inline void
 cursor_heap_pop_pos(grn_ctx *ctx, cursor_heap *h)
 {
@@ -4926,6 +5307,67 @@ grn_uvector2updspecs(grn_ctx *ctx, grn_ii *ii, grn_id rid, unsigned int section,
   return GRN_SUCCESS;
 }
 
+static uint32_t
+section_length(grn_ctx *ctx, grn_obj *value)
+{
+  switch (value->header.type) {
+  case GRN_BULK :
+    return GRN_BULK_VSIZE(value);
+  case GRN_VECTOR :
+    return value->u.v.body ? GRN_BULK_VSIZE(value->u.v.body) : 0;
+  case GRN_UVECTOR :
+    return GRN_BULK_VSIZE(value) / sizeof(grn_id);
+  default :
+    return 0;
+  }
+}
+
+/* keeps the average section length for the BM25 scorer model */
+static void
+section_stat_update(grn_ii *ii, uint32_t old_length, uint32_t new_length)
+{
+  struct grn_ii_header *header = ii->header;
+  if (old_length) {
+    if (header->n_sections) { header->n_sections--; }
+    if (header->total_section_length >= old_length) {
+      header->total_section_length -= old_length;
+    } else {
+      header->total_section_length = 0;
+    }
+  }
+  if (new_length) {
+    header->n_sections++;
+    header->total_section_length += new_length;
+  }
+}
+
+static grn_bool
+section_length_offset(grn_ii *ii, uint32_t sid, uint32_t *offset)
+{
+  if (!(ii->header->flags & GRN_OBJ_WITH_SECTION)) {
+    *offset = 0;
+    return GRN_TRUE;
+  }
+  if (sid < 1 || sid > N_SECTION_LENGTHS) { return GRN_FALSE; }
+  *offset = sid - 1;
+  return GRN_TRUE;
+}
+
+/* keeps the section length of each record for the BM25 scorer model */
+static void
+section_length_set(grn_ctx *ctx, grn_ii *ii, grn_id rid, uint32_t sid,
+                   uint32_t length)
+{
+  uint32_t offset, *lengths;
+  if (!ii->section_lengths || !section_length_offset(ii, sid, &offset)) {
+    return;
+  }
+  if ((lengths = grn_ra_ref(ctx, ii->section_lengths, rid))) {
+    lengths[offset] = length;
+    grn_ra_unref(ctx, ii->section_lengths, rid);
+  }
+}
+
 grn_rc
 grn_ii_column_update(grn_ctx *ctx, grn_ii *ii, grn_id rid, unsigned int section,
                      grn_obj *oldvalue, grn_obj *newvalue, grn_obj *posting)
@@ -4935,15 +5377,24 @@ grn_ii_column_update(grn_ctx *ctx, grn_ii *ii, grn_id rid, unsigned int section,
   grn_rc rc = GRN_SUCCESS;
   grn_ii_updspec **u, **un;
   grn_obj *old_, *old = oldvalue, *new_, *new = newvalue, oldv, newv, buf, *post = NULL;
+  uint32_t old_length, new_length;
+  uint32_t n_deletes = 0;
+  grn_bool locked = GRN_FALSE;
   if (!ii || !ii->lexicon || !rid) {
     ERR(GRN_INVALID_ARGUMENT, "grn_ii_column_update: invalid argument");
     return GRN_INVALID_ARGUMENT;
   }
+  old_length = oldvalue ? section_length(ctx, oldvalue) : 0;
+  new_length = newvalue ? section_length(ctx, newvalue) : 0;
   if (posting) {
     GRN_RECORD_INIT(&buf, GRN_OBJ_VECTOR, grn_obj_id(ctx, ii->lexicon));
     post = &buf;
   }
-  if (grn_io_lock(ctx, ii->seg, grn_lock_timeout)) { return ctx->rc; }
+  /*
+   * Tokenization and the diff between the old and the new values don't
+   * touch ii. The lexicon is locked by itself while tokens are added. So
+   * ii->seg is locked only while the postings are updated.
+   */
   if (new) {
     unsigned char type = (ii->obj.header.domain == new->header.domain)
       ? GRN_UVECTOR
@@ -5090,10 +5541,43 @@ grn_ii_column_update(grn_ctx *ctx, grn_ii *ii, grn_id rid, unsigned int section,
           grn_ii_updspec_close(ctx, *un);
           grn_hash_delete_by_id(ctx, n, eid, NULL);
         }
+        grn_ii_updspec_close(ctx, *u);
+        *u = NULL;
       } else {
+        n_deletes++;
+      }
+    });
+  }
+
+  if (!n_deletes &&
+      !(new && GRN_HASH_SIZE((grn_hash *)new) > 0) &&
+      old_length == new_length) {
+    /* The same value is set again. There is nothing to update. */
+    goto exit;
+  }
+  if (grn_io_lock(ctx, ii->seg, grn_lock_timeout)) {
+    if (old) {
+      GRN_HASH_EACH(ctx, (grn_hash *)old, id, &tp, NULL, &u, {
+        if (*u) { grn_ii_updspec_close(ctx, *u); }
+      });
+    }
+    if (new) {
+      GRN_HASH_EACH(ctx, (grn_hash *)new, id, &tp, NULL, &u, {
+        grn_ii_updspec_close(ctx, *u);
+      });
+    }
+    goto exit;
+  }
+  locked = GRN_TRUE;
+  if (n_deletes) {
+    grn_hash *o = (grn_hash *)old;
+    grn_hash *n = (grn_hash *)new;
+    GRN_HASH_EACH(ctx, o, id, &tp, NULL, &u, {
+      if (*u) {
         grn_ii_delete_one(ctx, ii, *tp, *u, n);
+        grn_ii_updspec_close(ctx, *u);
+        *u = NULL;
       }
-      grn_ii_updspec_close(ctx, *u);
     });
   }
   if (new) {
@@ -5108,8 +5592,12 @@ grn_ii_column_update(grn_ctx *ctx, grn_ii *ii, grn_id rid, unsigned int section,
       /* todo: delete key when all sections deleted */
     }
   }
+  section_stat_update(ii, old_length, new_length);
+  section_length_set(ctx, ii, rid, section, new_length);
 exit :
-  grn_io_unlock(ii->seg);
+  if (locked) {
+    grn_io_unlock(ii->seg);
+  }
   if (old && old != oldvalue) { grn_obj_close(ctx, old); }
   if (new && new != newvalue) { grn_obj_close(ctx, new); }
   return ctx->rc;
@@ -5279,12 +5767,9 @@ token_info_skip(grn_ctx *ctx, token_info *ti, uint32_t rid, uint32_t sid)
 {
   grn_ii_cursor *c;
   grn_ii_posting *p;
-  for (;;) {
-    if (!(c = cursor_heap_min(ti->cursors))) { return GRN_END_OF_DATA; }
-    p = c->post;
-    if (p->rid > rid || (p->rid == rid && p->sid >= sid)) { break; }
-    cursor_heap_pop(ctx, ti->cursors);
-  }
+  cursor_heap_skip(ctx, ti->cursors, rid, sid);
+  if (!(c = cursor_heap_min(ti->cursors))) { return GRN_END_OF_DATA; }
+  p = c->post;
   ti->pos = p->pos - ti->offset;
   ti->p = p;
   return GRN_SUCCESS;
@@ -5598,6 +6083,144 @@ get_weight(grn_ctx *ctx, grn_hash *s, grn_id rid, int sid,
   }
 }
 
+typedef struct {
+  grn_scorer_model model;
+  double k1;
+  double b;
+  double idf;
+  double avgdl;
+  grn_ii *ii;
+  grn_ra_cache section_lengths_cache;
+  int n_sources;
+  grn_obj **sources;
+  grn_obj value;
+} scorer;
+
+static void
+scorer_init(grn_ctx *ctx, scorer *sc, grn_ii *ii, grn_select_optarg *optarg,
+            uint32_t df)
+{
+  grn_obj *table;
+  double n_records = 0, n = df;
+  sc->model = optarg ? optarg->scorer_model : GRN_SCORER_MODEL_TF;
+  sc->ii = ii;
+  sc->n_sources = 0;
+  sc->sources = NULL;
+  if (sc->model == GRN_SCORER_MODEL_TF) { return; }
+  sc->k1 = optarg->scorer_bm25_k1;
+  sc->b = optarg->scorer_bm25_b;
+  sc->avgdl = 0;
+  if ((table = grn_ctx_at(ctx, DB_OBJ(ii)->range))) {
+    n_records = grn_table_size(ctx, table);
+  }
+  if (n > n_records) { n = n_records; }
+  if (sc->model == GRN_SCORER_MODEL_TFIDF) {
+    sc->idf = (n > 0) ? log(n_records / n) + 1.0 : 1.0;
+  } else {
+    sc->idf = log(1.0 + (n_records - n + 0.5) / (n + 0.5));
+  }
+  if (sc->model == GRN_SCORER_MODEL_BM25 && sc->b > 0 &&
+      ii->header->n_sections) {
+    grn_id *source = DB_OBJ(ii)->source;
+    int i, n_sources = DB_OBJ(ii)->source_size / sizeof(grn_id);
+    if (n_sources && (sc->sources = GRN_MALLOCN(grn_obj *, n_sources))) {
+      for (i = 0; i < n_sources; i++) {
+        if (!(sc->sources[i] = grn_ctx_at(ctx, source[i]))) { break; }
+      }
+      if (i == n_sources) {
+        sc->n_sources = n_sources;
+        sc->avgdl = (double)ii->header->total_section_length /
+          ii->header->n_sections;
+        GRN_TEXT_INIT(&sc->value, 0);
+        if (ii->section_lengths) {
+          GRN_RA_CACHE_INIT(ii->section_lengths, &sc->section_lengths_cache);
+        }
+      } else {
+        GRN_FREE(sc->sources);
+        sc->sources = NULL;
+      }
+    }
+  }
+}
+
+static void
+scorer_fin(grn_ctx *ctx, scorer *sc)
+{
+  if (sc->sources) {
+    if (sc->ii->section_lengths) {
+      GRN_RA_CACHE_FIN(sc->ii->section_lengths, &sc->section_lengths_cache);
+    }
+    GRN_OBJ_FIN(ctx, &sc->value);
+    GRN_FREE(sc->sources);
+  }
+}
+
+static double
+scorer_section_length(grn_ctx *ctx, scorer *sc, grn_id rid, uint32_t sid)
+{
+  grn_obj *source;
+  uint32_t offset;
+  if (sc->ii->section_lengths &&
+      section_length_offset(sc->ii, sid, &offset)) {
+    const uint32_t *lengths;
+    lengths = grn_ra_ref_cache(ctx, sc->ii->section_lengths, rid,
+                               &sc->section_lengths_cache);
+    return lengths ? lengths[offset] : 0;
+  }
+  /* Indexes created by old versions and sections that don't have the
+     lengths: read the value. */
+  if (sc->n_sources > 1 && sid <= sc->n_sources) {
+    source = sc->sources[sid - 1];
+  } else {
+    source = sc->sources[0];
+  }
+  grn_obj_reinit_for(ctx, &sc->value, source);
+  if (GRN_OBJ_TABLEP(source)) {
+    grn_table_get_key2(ctx, source, rid, &sc->value);
+  } else {
+    grn_obj_get_value(ctx, source, rid, &sc->value);
+  }
+  return section_length(ctx, &sc->value);
+}
+
+#define SCORER_SCALE 1000
+
+static int
+scorer_compute(scorer *sc, int tf, double norm)
+{
+  double score;
+  switch (sc->model) {
+  case GRN_SCORER_MODEL_TFIDF :
+    score = tf * sc->idf;
+    break;
+  case GRN_SCORER_MODEL_BM25 :
+    score = sc->idf * (tf * (sc->k1 + 1.0)) / (tf + sc->k1 * norm);
+    break;
+  default :
+    return tf;
+  }
+  score *= SCORER_SCALE;
+  return score < 1.0 ? 1 : (int)(score + 0.5);
+}
+
+static int
+scorer_score(grn_ctx *ctx, scorer *sc, grn_id rid, uint32_t sid, int tf)
+{
+  double norm = 1.0;
+  if (sc->sources) {
+    norm = 1.0 - sc->b +
+      sc->b * scorer_section_length(ctx, sc, rid, sid) / sc->avgdl;
+  }
+  return scorer_compute(sc, tf, norm);
+}
+
+/* upper bound of scorer_score(): an empty section gets the best norm */
+static int
+scorer_max_score(scorer *sc, int tf)
+{
+  return scorer_compute(sc, tf, sc->sources ? 1.0 - sc->b : 1.0);
+}
+
 grn_rc
 grn_ii_similar_search(grn_ctx *ctx, grn_ii *ii,
                       const char *string, unsigned int string_len,
@@ -5817,6 +6440,8 @@ grn_ii_select(grn_ctx *ctx, grn_ii *ii, const char *string, unsigned int string_
   grn_operator mode = GRN_OP_EXACT;
   grn_wv_mode wvm = grn_wv_none;
   grn_obj *lexicon = ii->lexicon;
+  scorer sc;
+  sc.sources = NULL;
   if (!lexicon || !ii || !s) { return GRN_INVALID_ARGUMENT; }
   if (optarg) {
     mode = optarg->mode;
@@ -5857,6 +6482,7 @@ grn_ii_select(grn_ctx *ctx, grn_ii *ii, const char *string, unsigned int string_
   }
   qsort(tis, n, sizeof(token_info *), token_compare);
   tie = tis + n;
+  scorer_init(ctx, &sc, ii, optarg, (*tis)->size);
   /*
   for (tip = tis; tip < tie; tip++) {
     ti = *tip;
@@ -5957,7 +6583,10 @@ grn_ii_select(grn_ctx *ctx, grn_ii *ii, const char *string, unsigned int string_
             }
           }
         }
-        if (noccur && !rep) { res_add(ctx, s, &pi, (noccur + tscore) * weight, op); }
+        if (noccur && !rep) {
+          int score = scorer_score(ctx, &sc, rid, sid, noccur + tscore);
+          res_add(ctx, s, &pi, score * weight, op);
+        }
 #undef SKIP_OR_BREAK
       }
     }
@@ -5968,6 +6597,7 @@ exit :
     if (*tip) { token_info_close(ctx, *tip); }
   }
   if (tis) { GRN_FREE(tis); }
+  scorer_fin(ctx, &sc);
   grn_ii_resolve_sel_and(ctx, s, op);
   //  grn_hash_cursor_clear(r);
   bt_close(ctx, bt);
@@ -5982,6 +6612,190 @@ exit :
   return rc;
 }
 
+typedef struct {
+  grn_id rid;
+  int score;
+  int n_subrecs;
+} top_k_entry;
+
+typedef struct {
+  int term;
+  uint32_t sid;
+  int tf;
+} top_k_posting;
+
+inline static void
+top_k_heap_down(top_k_entry *heap, int n, int i)
+{
+  top_k_entry e = heap[i];
+  for (;;) {
+    int c = i * 2 + 1;
+    if (c >= n) { break; }
+    if (c + 1 < n && heap[c + 1].score < heap[c].score) { c++; }
+    if (heap[c].score >= e.score) { break; }
+    heap[i] = heap[c];
+    i = c;
+  }
+  heap[i] = e;
+}
+
+inline static void
+top_k_heap_up(top_k_entry *heap, int i)
+{
+  top_k_entry e = heap[i];
+  while (i) {
+    int p = (i - 1) / 2;
+    if (heap[p].score <= e.score) { break; }
+    heap[i] = heap[p];
+    i = p;
+  }
+  heap[i] = e;
+}
+
+static int
+top_k_entry_compare_rid(const void *a, const void *b)
+{
+  grn_id ra = ((const top_k_entry *)a)->rid, rb = ((const top_k_entry *)b)->rid;
+  return ra < rb ? -1 : ra > rb;
+}
+
+/*
+ * Evaluates "queries[0] OR queries[1] OR ..." and keeps only the best k
+ * records in s. Every matched record is still counted into *n_hits but
+ * records whose score upper bound can't enter the top k are neither
+ * scored exactly nor added to s. It returns GRN_FALSE without touching s
+ * when a query isn't a single token or match escalation would be used.
+ */
+grn_bool
+grn_ii_select_top_k(grn_ctx *ctx, grn_ii *ii, grn_obj **queries, int *weights,
+                    int n_queries, grn_hash *s, int k, uint32_t *n_hits)
+{
+  int i, n_entries = 0;
+  uint32_t n_matched = 0, n_first_matched = 0;
+  grn_bool processed = GRN_FALSE;
+  token_info **tis = NULL;
+  scorer *scorers = NULL;
+  top_k_entry *heap = NULL;
+  grn_obj postings;
+  grn_select_optarg arg = {GRN_OP_EXACT, 0, 0, NULL, 0, NULL, NULL, 0,
+                           GRN_SCORER_MODEL_TF, 0, 0};
+  if (!ii->lexicon || k <= 0 || n_queries <= 0 ||
+      s->key_size != sizeof(grn_id) || GRN_HASH_SIZE(s) ||
+      DB_OBJ(s)->max_n_subrecs) {
+    return GRN_FALSE;
+  }
+  arg.scorer_model = ctx->impl->scorer_model;
+  arg.scorer_bm25_k1 = ctx->impl->scorer_bm25_k1;
+  arg.scorer_bm25_b = ctx->impl->scorer_bm25_b;
+  GRN_TEXT_INIT(&postings, 0);
+  if (!(tis = GRN_CALLOC(sizeof(token_info *) * n_queries)) ||
+      !(scorers = GRN_CALLOC(sizeof(scorer) * n_queries)) ||
+      !(heap = GRN_MALLOCN(top_k_entry, k))) {
+    goto exit;
+  }
+  for (i = 0; i < n_queries; i++) {
+    const char *string = GRN_TEXT_VALUE(queries[i]);
+    unsigned int string_len = GRN_TEXT_LEN(queries[i]);
+    token_info **buf;
+    uint32_t j, n = 0;
+    grn_rc rc;
+    if (!string_len) { continue; }
+    if (!(buf = GRN_MALLOC(sizeof(token_info *) * string_len * 2))) {
+      goto exit;
+    }
+    rc = token_info_build(ctx, ii->lexicon, ii, string, string_len,
+                          buf, &n, GRN_OP_EXACT);
+    if (!rc && n == 1) {
+      tis[i] = buf[0];
+      scorer_init(ctx, &scorers[i], ii, &arg, tis[i]->size);
+    } else {
+      for (j = 0; j < n; j++) {
+        if (buf[j]) { token_info_close(ctx, buf[j]); }
+      }
+    }
+    GRN_FREE(buf);
+    if (!rc && n > 1) { goto exit; }
+  }
+  for (;;) {
+    grn_id rid = GRN_ID_MAX;
+    int ub = 0, score;
+    top_k_posting *p, *pe;
+    for (i = 0; i < n_queries; i++) {
+      if (tis[i] && tis[i]->p->rid < rid) { rid = tis[i]->p->rid; }
+    }
+    if (rid == GRN_ID_MAX) { break; }
+    GRN_BULK_REWIND(&postings);
+    for (i = 0; i < n_queries; i++) {
+      token_info *ti = tis[i];
+      while (ti && ti->p->rid == rid) {
+        uint32_t sid = ti->p->sid;
+        if (ti->p->tf) {
+          top_k_posting posting;
+          posting.term = i;
+          posting.sid = sid;
+          posting.tf = ti->p->tf + ti->p->weight;
+          GRN_TEXT_PUT(ctx, &postings, &posting, sizeof(top_k_posting));
+          ub += scorer_max_score(&scorers[i], posting.tf) * weights[i];
+          if (!i) { n_first_matched++; }
+        }
+        if (token_info_skip(ctx, ti, rid, sid + 1)) {
+          token_info_close(ctx, ti);
+          tis[i] = ti = NULL;
+        }
+      }
+    }
+    p = (top_k_posting *)GRN_BULK_HEAD(&postings);
+    pe = (top_k_posting *)GRN_BULK_CURR(&postings);
+    if (p == pe) { continue; }
+    n_matched++;
+    if (n_entries == k && ub <= heap[0].score) { continue; }
+    for (score = 0; p < pe; p++) {
+      score += scorer_score(ctx, &scorers[p->term], rid, p->sid, p->tf) *
+        weights[p->term];
+    }
+    if (n_entries < k) {
+      heap[n_entries].rid = rid;
+      heap[n_entries].score = score;
+      heap[n_entries].n_subrecs = pe - (top_k_posting *)GRN_BULK_HEAD(&postings);
+      top_k_heap_up(heap, n_entries++);
+    } else if (score > heap[0].score) {
+      heap[0].rid = rid;
+      heap[0].score = score;
+      heap[0].n_subrecs = pe - (top_k_posting *)GRN_BULK_HEAD(&postings);
+      top_k_heap_down(heap, n_entries, 0);
+    }
+  }
+  if (ctx->impl->match_escalation_threshold >= 0 &&
+      (int64_t)n_first_matched <= ctx->impl->match_escalation_threshold) {
+    goto exit;
+  }
+  qsort(heap, n_entries, sizeof(top_k_entry), top_k_entry_compare_rid);
+  for (i = 0; i < n_entries; i++) {
+    grn_rset_recinfo *ri;
+    grn_rset_posinfo pi = {heap[i].rid, 0, 0};
+    if (grn_hash_add(ctx, s, &pi, s->key_size, (void **)&ri, NULL)) {
+      ri->score = heap[i].score;
+      ri->n_subrecs = heap[i].n_subrecs;
+    }
+  }
+  *n_hits = n_matched;
+  processed = GRN_TRUE;
+exit :
+  if (tis) {
+    for (i = 0; i < n_queries; i++) {
+      if (tis[i]) { token_info_close(ctx, tis[i]); }
+    }
+    GRN_FREE(tis);
+  }
+  if (scorers) {
+    for (i = 0; i < n_queries; i++) { scorer_fin(ctx, &scorers[i]); }
+    GRN_FREE(scorers);
+  }
+  if (heap) { GRN_FREE(heap); }
+  GRN_OBJ_FIN(ctx, &postings);
+  return processed;
+}
+
 grn_rc
 grn_ii_sel(grn_ctx *ctx, grn_ii *ii, const char *string, unsigned int string_len,
            grn_hash *s, grn_operator op, grn_search_optarg *optarg)
@@ -5989,8 +6803,12 @@ grn_ii_sel(grn_ctx *ctx, grn_ii *ii, const char *string, unsigned int string_len
   ERRCLR(ctx);
   GRN_LOG(ctx, GRN_LOG_INFO, "grn_ii_sel > (%.*s)", string_len, string);
   {
-    grn_select_optarg arg = {GRN_OP_EXACT, 0, 0, NULL, 0, NULL, NULL, 0};
+    grn_select_optarg arg = {GRN_OP_EXACT, 0, 0, NULL, 0, NULL, NULL, 0,
+                             GRN_SCORER_MODEL_TF, 0, 0};
     if (!s) { return GRN_INVALID_ARGUMENT; }
+    arg.scorer_model = ctx->impl->scorer_model;
+    arg.scorer_bm25_k1 = ctx->impl->scorer_bm25_k1;
+    arg.scorer_bm25_b = ctx->impl->scorer_bm25_b;
     if (optarg) {
       switch (optarg->mode) {
       case GRN_OP_NEAR :
@@ -6410,6 +7228,11 @@ struct _grn_ii_buffer {
   size_t packed_buf_size;
   size_t packed_len;
   size_t total_chunk_size;
+  // stuff for parallel parsing
+  grn_ii_buffer *parent;
+  grn_critical_section lock;
+  uint64_t n_sections;
+  uint64_t total_section_length;
 };
 
 static ii_buffer_block *
@@ -6426,7 +7249,6 @@ block_new(grn_ctx *ctx, grn_ii_buffer *ii_buffer)
     ii_buffer->blocks = blocks;
   }
   block = &ii_buffer->blocks[ii_buffer->nblocks];
-  block->head = ii_buffer->filepos;
   block->rest = 0;
   block->buffer = NULL;
   block->buffersize = 0;
@@ -6621,22 +7443,32 @@ grn_ii_buffer_flush(grn_ctx *ctx, grn_ii_buffer *ii_buffer)
   size_t encsize;
   uint8_t *outbuf;
   ii_buffer_block *block;
+  /* Workers share the lexicon and the temporary file of their parent. */
+  grn_ii_buffer *shared = ii_buffer->parent ? ii_buffer->parent : ii_buffer;
   GRN_LOG(ctx, GRN_LOG_NOTICE, "flushing:%d npostings:%zu",
           ii_buffer->nblocks, ii_buffer->block_pos);
   if (!(block = block_new(ctx, ii_buffer))) { return; }
   if (!(outbuf = allocate_outbuf(ctx, ii_buffer))) { return; }
+  CRITICAL_SECTION_ENTER(shared->lock);
   encsize = encode_terms(ctx, ii_buffer, outbuf, block);
+  CRITICAL_SECTION_LEAVE(shared->lock);
   encode_postings(ctx, ii_buffer, outbuf);
   encode_last_tf(ctx, ii_buffer, outbuf);
   {
-    ssize_t r = GRN_WRITE(ii_buffer->tmpfd, outbuf, encsize);
+    ssize_t r;
+    CRITICAL_SECTION_ENTER(shared->lock);
+    block->head = shared->filepos;
+    r = GRN_WRITE(shared->tmpfd, outbuf, encsize);
+    if (r == encsize) {
+      shared->filepos += r;
+    }
+    CRITICAL_SECTION_LEAVE(shared->lock);
     if (r != encsize) {
       ERR(GRN_INPUT_OUTPUT_ERROR, "write returned %" GRN_FMT_LLD " != %" GRN_FMT_LLU,
           (long long int)r, (unsigned long long int)encsize);
       return;
     }
-    ii_buffer->filepos += r;
-    block->tail = ii_buffer->filepos;
+    block->tail = block->head + r;
   }
   GRN_FREE(outbuf);
   memset(ii_buffer->counters, 0,
@@ -7077,13 +7909,18 @@ grn_ii_buffer_merge(grn_ctx *ctx, grn_ii_buffer *ii_buffer,
   }
 }
 
-grn_ii_buffer *
-grn_ii_buffer_open(grn_ctx *ctx, grn_ii *ii,
-                   long long unsigned int update_buffer_size)
+static grn_ii_buffer *
+grn_ii_buffer_open_internal(grn_ctx *ctx, grn_ii *ii,
+                            long long unsigned int update_buffer_size,
+                            grn_ii_buffer *parent)
 {
   if (ii && ii->lexicon) {
     grn_ii_buffer *ii_buffer = GRN_MALLOCN(grn_ii_buffer, 1);
     if (ii_buffer) {
+      ii_buffer->parent = parent;
+      ii_buffer->n_sections = 0;
+      ii_buffer->total_section_length = 0;
+      ii_buffer->tmpfd = -1;
       ii_buffer->ii = ii;
       ii_buffer->lexicon = ii->lexicon;
       ii_buffer->tmp_lexicon = NULL;
@@ -7104,6 +7941,10 @@ grn_ii_buffer_open(grn_ctx *ctx, grn_ii *ii,
       ii_buffer->total_chunk_size = 0;
       if (ii_buffer->counters) {
         ii_buffer->block_buf = GRN_MALLOCN(grn_id, II_BUFFER_BLOCK_SIZE);
+        if (ii_buffer->block_buf && parent) {
+          ii_buffer->block_buf_size = II_BUFFER_BLOCK_SIZE;
+          return ii_buffer;
+        }
         if (ii_buffer->block_buf) {
           snprintf(ii_buffer->tmpfpath, PATH_MAX,
                    "%sXXXXXX", grn_io_path(ii->seg));
@@ -7118,6 +7959,7 @@ grn_ii_buffer_open(grn_ctx *ctx, grn_ii *ii,
               grn_pat_cache_enable(ctx, (grn_pat *)ii->lexicon,
                                    PAT_CACHE_SIZE);
             }
+            CRITICAL_SECTION_INIT(ii_buffer->lock);
             return ii_buffer;
           } else {
             SERR("mkostemp");
@@ -7134,6 +7976,13 @@ grn_ii_buffer_open(grn_ctx *ctx, grn_ii *ii,
   return NULL;
 }
 
+grn_ii_buffer *
+grn_ii_buffer_open(grn_ctx *ctx, grn_ii *ii,
+                   long long unsigned int update_buffer_size)
+{
+  return grn_ii_buffer_open_internal(ctx, ii, update_buffer_size, NULL);
+}
+
 grn_rc
 grn_ii_buffer_append(grn_ctx *ctx, grn_ii_buffer *ii_buffer,
                      grn_id rid, unsigned int sid, grn_obj *value)
@@ -7235,10 +8084,13 @@ grn_rc
 grn_ii_buffer_close(grn_ctx *ctx, grn_ii_buffer *ii_buffer)
 {
   uint32_t i;
-  grn_obj_flags flags;
-  grn_table_get_info(ctx, ii_buffer->ii->lexicon, &flags, NULL, NULL, NULL);
-  if ((flags & GRN_OBJ_TABLE_TYPE_MASK) == GRN_OBJ_TABLE_PAT_KEY) {
-    grn_pat_cache_disable(ctx, (grn_pat *)ii_buffer->ii->lexicon);
+  if (!ii_buffer->parent) {
+    grn_obj_flags flags;
+    grn_table_get_info(ctx, ii_buffer->ii->lexicon, &flags, NULL, NULL, NULL);
+    if ((flags & GRN_OBJ_TABLE_TYPE_MASK) == GRN_OBJ_TABLE_PAT_KEY) {
+      grn_pat_cache_disable(ctx, (grn_pat *)ii_buffer->ii->lexicon);
+    }
+    CRITICAL_SECTION_FIN(ii_buffer->lock);
   }
   if (ii_buffer->tmp_lexicon) {
     grn_obj_close(ctx, ii_buffer->tmp_lexicon);
@@ -7265,6 +8117,61 @@ grn_ii_buffer_close(grn_ctx *ctx, grn_ii_buffer *ii_buffer)
   return ctx->rc;
 }
 
+static void
+grn_ii_buffer_parse_record(grn_ctx *ctx, grn_ii_buffer *ii_buffer,
+                           grn_id rid, int ncols, grn_obj **cols,
+                           grn_obj *rv)
+{
+  int sid;
+  grn_obj **col;
+  for (sid = 1, col = cols; sid <= ncols; sid++, col++) {
+    uint32_t length;
+    grn_obj_reinit_for(ctx, rv, *col);
+    if (GRN_OBJ_TABLEP(*col)) {
+      grn_table_get_key2(ctx, *col, rid, rv);
+    } else {
+      grn_obj_get_value(ctx, *col, rid, rv);
+    }
+    switch (rv->header.type) {
+    case GRN_BULK :
+      grn_ii_buffer_tokenize(ctx, ii_buffer, rid, sid, 0,
+                             GRN_TEXT_VALUE(rv), GRN_TEXT_LEN(rv));
+      break;
+    case GRN_VECTOR :
+      if (rv->u.v.body) {
+        int i;
+        int n_sections = rv->u.v.n_sections;
+        grn_section *sections = rv->u.v.sections;
+        const char *head = GRN_BULK_HEAD(rv->u.v.body);
+        for (i = 0; i < n_sections; i++) {
+          grn_section *section = sections + i;
+          if (section->length == 0) {
+            continue;
+          }
+          grn_ii_buffer_tokenize(ctx, ii_buffer, rid,
+                                 sid, section->weight,
+                                 head + section->offset, section->length);
+        }
+      }
+      break;
+    default :
+      ERR(GRN_INVALID_ARGUMENT, "[index] invalid object assigned as value");
+      break;
+    }
+    length = section_length(ctx, rv);
+    section_length_set(ctx, ii_buffer->ii, rid, sid, length);
+    if (ii_buffer->parent) {
+      /* The header is updated by the parent after the workers finish. */
+      if (length) {
+        ii_buffer->n_sections++;
+        ii_buffer->total_section_length += length;
+      }
+    } else {
+      section_stat_update(ii_buffer->ii, 0, length);
+    }
+  }
+}
+
 static void
 grn_ii_buffer_parse(grn_ctx *ctx, grn_ii_buffer *ii_buffer,
                     grn_obj *target, int ncols, grn_obj **cols)
@@ -7277,46 +8184,180 @@ grn_ii_buffer_parse(grn_ctx *ctx, grn_ii_buffer *ii_buffer,
     grn_obj rv;
     GRN_TEXT_INIT(&rv, 0);
     while ((rid = grn_table_cursor_next(ctx, tc)) != GRN_ID_NIL) {
-      int sid;
-      grn_obj **col;
-      for (sid = 1, col = cols; sid <= ncols; sid++, col++) {
-        grn_obj_reinit_for(ctx, &rv, *col);
-        if (GRN_OBJ_TABLEP(*col)) {
-          grn_table_get_key2(ctx, *col, rid, &rv);
-        } else {
-          grn_obj_get_value(ctx, *col, rid, &rv);
+      grn_ii_buffer_parse_record(ctx, ii_buffer, rid, ncols, cols, &rv);
+    }
+    GRN_OBJ_FIN(ctx, &rv);
+    grn_table_cursor_close(ctx, tc);
+  }
+}
+
+typedef struct {
+  grn_ctx ctx;
+  grn_thread thread;
+  grn_bool thread_created;
+  grn_ii_buffer *ii_buffer;
+  grn_obj *target;
+  int ncols;
+  grn_obj **cols;
+  grn_id min;
+  grn_id max;
+  grn_rc rc;
+} grn_ii_build_worker;
+
+static void * CALLBACK
+grn_ii_build_worker_run(void *arg)
+{
+  grn_ii_build_worker *worker = arg;
+  grn_ctx *ctx = &(worker->ctx);
+  grn_ii_buffer *ii_buffer = worker->ii_buffer;
+  grn_obj rv;
+  grn_id rid;
+
+  GRN_TEXT_INIT(&rv, 0);
+  for (rid = grn_table_next(ctx, worker->target, worker->min - 1);
+       rid != GRN_ID_NIL && rid <= worker->max;
+       rid = grn_table_next(ctx, worker->target, rid)) {
+    grn_ii_buffer_parse_record(ctx, ii_buffer, rid,
+                               worker->ncols, worker->cols, &rv);
+    if (ctx->rc != GRN_SUCCESS) {
+      /* Keep it here because the following API calls clear ctx->rc. */
+      worker->rc = ctx->rc;
+      break;
+    }
+  }
+  GRN_OBJ_FIN(ctx, &rv);
+  if (worker->rc == GRN_SUCCESS && ii_buffer->block_pos) {
+    grn_ii_buffer_flush(ctx, ii_buffer);
+    worker->rc = ctx->rc;
+  }
+  return NULL;
+}
+
+/*
+ * Tokenizes the records of target with grn_ii_build_n_workers threads.
+ * Each worker parses a contiguous range of record IDs with its own context
+ * and writes sorted blocks to the temporary file of ii_buffer. Lexicon
+ * insertions and file writes are serialized by ii_buffer->lock. The blocks
+ * are appended to ii_buffer in range order, so grn_ii_buffer_commit() sees
+ * record IDs in ascending order as it does for the sequential parse.
+ * Returns GRN_FALSE without touching ii_buffer when target is too small.
+ */
+static grn_bool
+grn_ii_buffer_parse_parallel(grn_ctx *ctx, grn_ii_buffer *ii_buffer,
+                             grn_obj *target, int ncols, grn_obj **cols)
+{
+  grn_ii_build_worker *workers;
+  grn_id max_id;
+  uint32_t n_records;
+  uint32_t n_ids_per_worker;
+  int i, n_workers, n_ready;
+  grn_bool processed = GRN_FALSE;
+
+  if (grn_ii_build_n_workers < 2) {
+    return GRN_FALSE;
+  }
+  n_records = grn_table_size(ctx, target);
+  if (grn_ii_build_min_n_records_per_worker > 0) {
+    n_workers = n_records / grn_ii_build_min_n_records_per_worker;
+  } else {
+    n_workers = n_records;
+  }
+  if (n_workers > grn_ii_build_n_workers) {
+    n_workers = grn_ii_build_n_workers;
+  }
+  if (n_workers < 2) {
+    return GRN_FALSE;
+  }
+  max_id = grn_table_curr_id(ctx, target);
+  if (max_id == GRN_ID_NIL) {
+    return GRN_FALSE;
+  }
+
+  if (!(workers = GRN_MALLOCN(grn_ii_build_worker, n_workers))) {
+    return GRN_FALSE;
+  }
+  n_ids_per_worker = (max_id + n_workers - 1) / n_workers;
+  for (n_ready = 0; n_ready < n_workers; n_ready++) {
+    grn_ii_build_worker *worker = workers + n_ready;
+    grn_ctx *worker_ctx = &(worker->ctx);
+    grn_ctx_init(worker_ctx, 0);
+    grn_ctx_use(worker_ctx, grn_ctx_db(ctx));
+    worker->thread_created = GRN_FALSE;
+    worker->target = target;
+    worker->ncols = ncols;
+    worker->cols = cols;
+    worker->rc = GRN_SUCCESS;
+    worker->min = n_ready * n_ids_per_worker + 1;
+    worker->max = (n_ready + 1) * n_ids_per_worker;
+    worker->ii_buffer = grn_ii_buffer_open_internal(worker_ctx, ii_buffer->ii,
+                                                    0, ii_buffer);
+    if (!worker->ii_buffer) {
+      grn_ctx_fin(worker_ctx);
+      break;
+    }
+  }
+
+  if (n_ready == n_workers) {
+    for (i = 0; i < n_workers; i++) {
+      grn_ii_build_worker *worker = workers + i;
+      if (!THREAD_CREATE(worker->thread, grn_ii_build_worker_run, worker)) {
+        worker->thread_created = GRN_TRUE;
+      } else {
+        grn_ii_build_worker_run(worker);
+      }
+    }
+    for (i = 0; i < n_workers; i++) {
+      grn_ii_build_worker *worker = workers + i;
+      if (worker->thread_created) {
+        THREAD_JOIN(worker->thread);
+      }
+    }
+    for (i = 0; i < n_workers; i++) {
+      grn_ii_build_worker *worker = workers + i;
+      grn_ii_buffer *worker_buffer = worker->ii_buffer;
+      if (worker->rc != GRN_SUCCESS) {
+        if (ctx->rc == GRN_SUCCESS) {
+          ERR(worker->rc, "%s", worker->ctx.errbuf);
         }
-        switch (rv.header.type) {
-        case GRN_BULK :
-          grn_ii_buffer_tokenize(ctx, ii_buffer, rid, sid, 0,
-                                 GRN_TEXT_VALUE(&rv), GRN_TEXT_LEN(&rv));
-          break;
-        case GRN_VECTOR :
-          if (rv.u.v.body) {
-            int i;
-            int n_sections = rv.u.v.n_sections;
-            grn_section *sections = rv.u.v.sections;
-            const char *head = GRN_BULK_HEAD(rv.u.v.body);
-            for (i = 0; i < n_sections; i++) {
-              grn_section *section = sections + i;
-              if (section->length == 0) {
-                continue;
-              }
-              grn_ii_buffer_tokenize(ctx, ii_buffer, rid,
-                                     sid, section->weight,
-                                     head + section->offset, section->length);
-            }
-          }
-          break;
-        default :
-          ERR(GRN_INVALID_ARGUMENT, "[index] invalid object assigned as value");
-          break;
+        continue;
+      }
+      if (ctx->rc != GRN_SUCCESS) {
+        continue;
+      }
+      if (worker_buffer->nblocks) {
+        uint32_t nblocks = ii_buffer->nblocks + worker_buffer->nblocks;
+        ii_buffer_block *blocks;
+        /* Keep the capacity that block_new() expects. */
+        blocks = GRN_REALLOC(ii_buffer->blocks,
+                             ((nblocks + 0x3ff) & ~0x3ff) *
+                             sizeof(ii_buffer_block));
+        if (!blocks) {
+          ERR(GRN_NO_MEMORY_AVAILABLE,
+              "failed to merge blocks parsed by workers: nblocks=%d", nblocks);
+          continue;
         }
+        memcpy(blocks + ii_buffer->nblocks, worker_buffer->blocks,
+               worker_buffer->nblocks * sizeof(ii_buffer_block));
+        ii_buffer->blocks = blocks;
+        ii_buffer->nblocks = nblocks;
       }
+      ii_buffer->total_size += worker_buffer->total_size;
+      ii_buffer->ii->header->n_sections += worker_buffer->n_sections;
+      ii_buffer->ii->header->total_section_length +=
+        worker_buffer->total_section_length;
     }
-    GRN_OBJ_FIN(ctx, &rv);
-    grn_table_cursor_close(ctx, tc);
+    GRN_LOG(ctx, GRN_LOG_NOTICE,
+            "parsed by %d workers: nblocks=%d", n_workers, ii_buffer->nblocks);
+    processed = GRN_TRUE;
   }
+
+  for (i = 0; i < n_ready; i++) {
+    grn_ii_build_worker *worker = workers + i;
+    grn_ii_buffer_close(&(worker->ctx), worker->ii_buffer);
+    grn_ctx_fin(&(worker->ctx));
+  }
+  GRN_FREE(workers);
+  return processed;
 }
 
 grn_rc
@@ -7339,8 +8380,16 @@ grn_ii_build(grn_ctx *ctx, grn_ii *ii, uint64_t sparsity)
             target = grn_ctx_at(ctx, target->header.domain);
           }
           if (target) {
-            grn_ii_buffer_parse(ctx, ii_buffer, target, ncols, cols);
-            grn_ii_buffer_commit(ctx, ii_buffer);
+            if (grn_ii_buffer_parse_parallel(ctx, ii_buffer,
+                                             target, ncols, cols)) {
+              /* Blocks of a failed worker are missing. */
+              if (ctx->rc == GRN_SUCCESS) {
+                grn_ii_buffer_commit(ctx, ii_buffer);
+              }
+            } else {
+              grn_ii_buffer_parse(ctx, ii_buffer, target, ncols, cols);
+              grn_ii_buffer_commit(ctx, ii_buffer);
+            }
           } else {
             ERR(GRN_INVALID_ARGUMENT, "failed to resolve the target");
           }
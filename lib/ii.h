@@ -43,6 +43,9 @@ struct _grn_ii {
   grn_db_obj obj;
   grn_io *seg;
   grn_io *chunk;
+  /* Section lengths of each record for the BM25 scorer model. It's NULL
+     for indexes created by old versions. */
+  grn_ra *section_lengths;
   grn_obj *lexicon;
   grn_obj_flags lflags;
   grn_encoding encoding;
@@ -70,7 +73,9 @@ struct grn_ii_header {
   uint32_t bgqhead;
   uint32_t bgqtail;
   uint32_t bgqbody[GRN_II_BGQSIZE];
-  uint32_t reserved[288];
+  uint64_t n_sections;
+  uint64_t total_section_length;
+  uint32_t reserved[284];
   uint32_t ainfo[GRN_II_MAX_LSEG];
   uint32_t binfo[GRN_II_MAX_LSEG];
   uint32_t free_chunks[GRN_II_N_CHUNK_VARIATION + 1];
@@ -114,6 +119,7 @@ grn_rc grn_ii_updspec_add(grn_ctx *ctx, grn_ii_updspec *u, int pos, int32_t weig
 int grn_ii_updspec_cmp(grn_ii_updspec *a, grn_ii_updspec *b);
 
 uint32_t grn_ii_estimate_size(grn_ctx *ctx, grn_ii *ii, uint32_t key);
+uint64_t grn_ii_prefetch(grn_ctx *ctx, grn_ii *ii);
 
 void grn_ii_expire(grn_ctx *ctx, grn_ii *ii);
 
@@ -137,6 +143,8 @@ grn_ii_cursor *grn_ii_cursor_openv1(grn_ii *ii, uint32_t key);
 grn_rc grn_ii_cursor_openv2(grn_ii_cursor **cursors, int ncursors);
 GRN_API grn_ii_posting *grn_ii_cursor_next(grn_ctx *ctx, grn_ii_cursor *c);
 grn_ii_posting *grn_ii_cursor_next_pos(grn_ctx *ctx, grn_ii_cursor *c);
+grn_ii_posting *grn_ii_cursor_seek(grn_ctx *ctx, grn_ii_cursor *c,
+                                   grn_id rid, uint32_t sid);
 GRN_API grn_rc grn_ii_cursor_close(grn_ctx *ctx, grn_ii_cursor *c);
 
 uint32_t grn_ii_max_section(grn_ii *ii);
@@ -165,6 +173,9 @@ struct _grn_select_optarg {
   int (*func)(grn_ctx *, grn_hash *, const void *, int, void *);
   void *func_arg;
   int max_size;
+  grn_scorer_model scorer_model;
+  double scorer_bm25_k1;
+  double scorer_bm25_b;
 };
 
 GRN_API grn_rc grn_ii_column_update(grn_ctx *ctx, grn_ii *ii, grn_id id,
@@ -179,6 +190,9 @@ GRN_API grn_rc grn_ii_select(grn_ctx *ctx, grn_ii *ii, const char *string, unsig
                              grn_hash *s, grn_operator op, grn_select_optarg *optarg);
 grn_rc grn_ii_sel(grn_ctx *ctx, grn_ii *ii, const char *string, unsigned int string_len,
                   grn_hash *s, grn_operator op, grn_search_optarg *optarg);
+grn_bool grn_ii_select_top_k(grn_ctx *ctx, grn_ii *ii, grn_obj **queries,
+                             int *weights, int n_queries, grn_hash *s,
+                             int k, uint32_t *n_hits);
 
 void grn_ii_resolve_sel_and(grn_ctx *ctx, grn_hash *s, grn_operator op);
 
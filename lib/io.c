@@ -93,6 +93,32 @@ inline static int grn_msync(grn_ctx *ctx, void *start, size_t length);
 inline static grn_rc grn_pread(grn_ctx *ctx, fileinfo *fi, void *buf, size_t count, off_t offset);
 inline static grn_rc grn_pwrite(grn_ctx *ctx, fileinfo *fi, void *buf, size_t count, off_t offset);
 
+/*
+  Mapped memory budget.
+
+  grn_io_max_mapped_memory bounds the total size of segments mapped by
+  registered grn_ios. When it isn't 0 and the total exceeds it, cold
+  segments are unmapped at the end of commands. grn_obj_get_value_() and
+  sorting keep addresses in segments after they drop their references,
+  so a segment is unmapped only when nobody can still refer it:
+  GRN_IO_SEG_REF() stores grn_gtick into grn_io_mapinfo::count and each
+  sweep advances grn_gtick, so a segment is cold if it hasn't been
+  referenced since the last sweep. A sweep is done only after every ctx
+  that was in an API call at the last sweep has returned from it. The
+  seqno of a ctx is odd in an API call and seqno2 holds its value at the
+  last sweep like grn_expire(). Only grn_ios with GRN_IO_EXPIRE_SEGMENT
+  alone (grn_ii chunks, grn_ja and grn_ra) are swept because only they
+  reference segments with nref. Pinned grn_ios aren't registered, so they
+  are never swept.
+*/
+static uint64_t grn_io_max_mapped_memory = 0;
+static uint32_t grn_io_n_segment_maps = 0;
+static uint32_t grn_io_n_segment_unmaps = 0;
+/* grn_io_n_segment_maps at the last sweep. */
+static uint32_t grn_io_n_segment_maps_at_sweep = 0;
+/* Whether segments still exceeded the budget at the last sweep. */
+static grn_bool grn_io_over_budget = GRN_FALSE;
+
 grn_rc
 grn_io_init(void)
 {
@@ -156,10 +182,12 @@ grn_io_register(grn_io *io)
 {
   if (io->fis && (io->flags & (GRN_IO_EXPIRE_GTICK|GRN_IO_EXPIRE_SEGMENT))) {
     grn_bool succeeded = GRN_FALSE;
+    grn_io **io_value;
     CRITICAL_SECTION_ENTER(grn_glock);
     if (grn_gctx.impl && grn_gctx.impl->ios &&
         grn_hash_add(&grn_gctx, grn_gctx.impl->ios, io->path, strlen(io->path),
-                     (void **)&io, NULL)) {
+                     (void **)&io_value, NULL)) {
+      *io_value = io;
       succeeded = GRN_TRUE;
     }
     CRITICAL_SECTION_LEAVE(grn_glock);
@@ -189,6 +217,21 @@ grn_io_unregister(grn_io *io)
   }
 }
 
+/*
+  Pins the segments of io: they stay mapped until io is closed.
+  GRN_IO_SEG_REF() and GRN_IO_SEG_UNREF() don't touch nref of a mapped
+  segment of a pinned grn_io, so concurrent readers share its grn_io_mapinfo
+  without writing to it. This must be called before the first
+  GRN_IO_SEG_REF() on io.
+*/
+void
+grn_io_pin(grn_io *io)
+{
+  if (!(io->flags & (GRN_IO_EXPIRE_GTICK|GRN_IO_EXPIRE_SEGMENT))) { return; }
+  grn_io_unregister(io);
+  io->flags &= ~(GRN_IO_EXPIRE_GTICK|GRN_IO_EXPIRE_SEGMENT);
+}
+
 grn_io *
 grn_io_create(grn_ctx *ctx, const char *path, uint32_t header_size, uint32_t segment_size,
               uint32_t max_segment, grn_io_mode mode, uint32_t flags)
@@ -517,6 +560,10 @@ grn_io_close(grn_ctx *ctx, grn_io *io)
     for (mi = io->maps, i = max_segment; i; mi++, i--) {
       if (mi->map) {
         /* if (atomic_read(mi->nref)) { return STILL_IN_USE ; } */
+        if (io->fis) {
+          uint32_t n_unmaps;
+          GRN_ATOMIC_ADD_EX(&grn_io_n_segment_unmaps, 1, n_unmaps);
+        }
 #ifdef WIN32
         if ((io->flags & GRN_IO_TEMPORARY)) {
           GRN_GFREE(mi->map);
@@ -1127,6 +1174,10 @@ void
 grn_io_seg_map_(grn_ctx *ctx, grn_io *io, uint32_t segno, grn_io_mapinfo *info)
 {
   SEG_MAP(io, segno, info);
+  if (info->map && io->fis) {
+    uint32_t n_maps;
+    GRN_ATOMIC_ADD_EX(&grn_io_n_segment_maps, 1, n_maps);
+  }
 }
 
 grn_rc
@@ -1159,10 +1210,12 @@ grn_io_seg_expire(grn_ctx *ctx, grn_io *io, uint32_t segno, uint32_t nretry)
         }
       } else {
         uint32_t nmaps;
+        uint32_t n_unmaps;
         GRN_MUNMAP(&grn_gctx, &info->fmo, info->map, io->header->segment_size);
         info->map = NULL;
         GRN_ATOMIC_ADD_EX(pnref, -(GRN_IO_MAX_REF + 1), nref);
         GRN_ATOMIC_ADD_EX(&io->nmaps, -1, nmaps);
+        GRN_ATOMIC_ADD_EX(&grn_io_n_segment_unmaps, 1, n_unmaps);
         GRN_FUTEX_WAKE(pnref);
         return GRN_SUCCESS;
       }
@@ -1198,6 +1251,10 @@ grn_io_expire(grn_ctx *ctx, grn_io *io, int count_thresh, uint32_t limit)
             n++;
           }
         }
+        if (n) {
+          uint32_t n_unmaps;
+          GRN_ATOMIC_ADD_EX(&grn_io_n_segment_unmaps, n, n_unmaps);
+        }
       }
       GRN_ATOMIC_ADD_EX(pnref, -1, nref);
     }
@@ -1215,8 +1272,10 @@ grn_io_expire(grn_ctx *ctx, grn_io *io, int count_thresh, uint32_t limit)
           uint32_t nmaps, nref, *pnref = &info->nref;
           GRN_ATOMIC_ADD_EX(pnref, 1, nref);
           if (!nref && info->map && (grn_gtick - info->count) > count_thresh) {
+            uint32_t n_unmaps;
             GRN_MUNMAP(&grn_gctx, &info->fmo, info->map, io->header->segment_size);
             GRN_ATOMIC_ADD_EX(&io->nmaps, -1, nmaps);
+            GRN_ATOMIC_ADD_EX(&grn_io_n_segment_unmaps, 1, n_unmaps);
             info->map = NULL;
             info->count = grn_gtick;
             n++;
@@ -1238,10 +1297,10 @@ static uint32_t
 grn_expire_(grn_ctx *ctx, int count_thresh, uint32_t limit)
 {
   uint32_t n = 0;
-  grn_io *io;
-  GRN_HASH_EACH(ctx, grn_gctx.impl->ios, id, NULL, NULL, (void **)&io, {
+  grn_io **io_value;
+  GRN_HASH_EACH(ctx, grn_gctx.impl->ios, id, NULL, NULL, (void **)&io_value, {
     grn_plugin_close(ctx, id);
-    n += grn_io_expire(ctx, io, count_thresh, limit);
+    n += grn_io_expire(ctx, *io_value, count_thresh, limit);
     if (n >= limit) { break; }
   });
   return n;
@@ -1270,6 +1329,188 @@ grn_expire(grn_ctx *ctx, int count_thresh, uint32_t limit)
   return n;
 }
 
+/* grn_glock must be held. */
+static uint64_t
+grn_io_mapped_memory_(void)
+{
+  uint64_t size = 0;
+  grn_io **io_value;
+  if (!grn_gctx.impl || !grn_gctx.impl->ios) { return 0; }
+  GRN_HASH_EACH(&grn_gctx, grn_gctx.impl->ios, id, NULL, NULL,
+                (void **)&io_value, {
+    grn_io *io = *io_value;
+    size += (uint64_t)io->nmaps * io->header->segment_size;
+  });
+  return size;
+}
+
+/* grn_glock must be held. grn_glock is also held by grn_io_close() to
+   unregister an io, so ios aren't closed while they are swept. */
+static uint32_t
+grn_io_enforce_budget_(grn_ctx *ctx)
+{
+  uint32_t n = 0, gtick;
+  uint64_t size;
+  grn_io **io_value;
+  grn_ctx *c;
+  for (c = grn_gctx.next; c != &grn_gctx; c = c->next) {
+    /* ctx is at the end of its command unless it's in a nested call. */
+    if (c == ctx && !ctx->subno) { continue; }
+    if ((c->seqno & 1) && c->seqno == c->seqno2) {
+      /* c may still refer segments that were cold at the last sweep. */
+      return 0;
+    }
+  }
+  size = grn_io_mapped_memory_();
+  if (size > grn_io_max_mapped_memory) {
+    GRN_HASH_EACH(ctx, grn_gctx.impl->ios, id, NULL, NULL,
+                  (void **)&io_value, {
+      grn_io *io = *io_value;
+      uint32_t segno;
+      uint32_t segment_size = io->header->segment_size;
+      if ((io->flags & (GRN_IO_EXPIRE_GTICK|GRN_IO_EXPIRE_SEGMENT)) !=
+          GRN_IO_EXPIRE_SEGMENT) {
+        continue;
+      }
+      for (segno = 0; segno <= io->max_map_seg; segno++) {
+        grn_io_mapinfo *info = &(io->maps[segno]);
+        /* Hot segments are kept even if the budget is exceeded. */
+        if (!info->map || info->count == grn_gtick) { continue; }
+        if (grn_io_seg_expire(ctx, io, segno, 0) == GRN_SUCCESS) {
+          n++;
+          size -= segment_size;
+          if (size <= grn_io_max_mapped_memory) { break; }
+        }
+      }
+      if (size <= grn_io_max_mapped_memory) { break; }
+    });
+  }
+  /* grn_gtick must be advanced before seqnos are read. A ctx that enters
+     an API call after that refers segments with the new grn_gtick. */
+  GRN_ATOMIC_ADD_EX(&grn_gtick, 1, gtick);
+  for (c = grn_gctx.next; c != &grn_gctx; c = c->next) {
+    c->seqno2 = c->seqno;
+  }
+  grn_io_n_segment_maps_at_sweep = grn_io_n_segment_maps;
+  grn_io_over_budget = size > grn_io_max_mapped_memory;
+  if (n) {
+    GRN_LOG(ctx, GRN_LOG_INFO,
+            "[io][budget] unmapped %u segments: "
+            "<%" GRN_FMT_LLU ">/<%" GRN_FMT_LLU ">",
+            n,
+            (unsigned long long int)size,
+            (unsigned long long int)grn_io_max_mapped_memory);
+  }
+  return n;
+}
+
+void
+grn_io_enforce_budget(grn_ctx *ctx)
+{
+  if (grn_io_max_mapped_memory == 0) { return; }
+  /* Nothing is mapped since the last sweep that met the budget. */
+  if (!grn_io_over_budget &&
+      grn_io_n_segment_maps == grn_io_n_segment_maps_at_sweep) {
+    return;
+  }
+  CRITICAL_SECTION_ENTER(grn_glock);
+  grn_io_enforce_budget_(ctx);
+  CRITICAL_SECTION_LEAVE(grn_glock);
+}
+
+grn_rc
+grn_set_max_mapped_memory(unsigned long long int size)
+{
+  CRITICAL_SECTION_ENTER(grn_glock);
+  grn_io_max_mapped_memory = size;
+  grn_io_over_budget = size > 0;
+  CRITICAL_SECTION_LEAVE(grn_glock);
+  return GRN_SUCCESS;
+}
+
+unsigned long long int
+grn_get_max_mapped_memory(void)
+{
+  return grn_io_max_mapped_memory;
+}
+
+void
+grn_io_get_statistics(grn_io_statistics *statistics)
+{
+  CRITICAL_SECTION_ENTER(grn_glock);
+  statistics->mapped_memory = grn_io_mapped_memory_();
+  CRITICAL_SECTION_LEAVE(grn_glock);
+  statistics->max_mapped_memory = grn_io_max_mapped_memory;
+  statistics->n_segment_maps = grn_io_n_segment_maps;
+  statistics->n_segment_unmaps = grn_io_n_segment_unmaps;
+}
+
+#ifdef HAVE_POSIX_FADVISE
+static grn_bool
+grn_io_prefetch_open_(grn_ctx *ctx, grn_io *io, uint32_t fno)
+{
+  fileinfo *fi = &io->fis[fno];
+  if (!grn_opened(fi)) {
+    char path[PATH_MAX];
+    struct stat s;
+    gen_pathname(io->path, path, fno);
+    /* Don't create files that aren't used yet. */
+    if (stat(path, &s) == -1) { return GRN_FALSE; }
+    if (grn_open(ctx, fi, path, O_RDWR, GRN_IO_FILE_SIZE)) { return GRN_FALSE; }
+  }
+  return GRN_TRUE;
+}
+#endif /* HAVE_POSIX_FADVISE */
+
+/*
+  Asks the OS to read size bytes from offset in segment of io into the page
+  cache without mapping them. size 0 means up to the end of io. Segments
+  that aren't mapped yet don't count against the mapped memory budget.
+  Returns the number of bytes that exist in files and are requested.
+*/
+uint64_t
+grn_io_prefetch(grn_ctx *ctx, grn_io *io, uint32_t segment, uint32_t offset,
+                uint64_t size)
+{
+  uint64_t n_bytes = 0;
+#ifdef HAVE_POSIX_FADVISE
+  uint32_t segment_size = io->header->segment_size;
+  uint32_t segments_per_file = GRN_IO_FILE_SIZE / segment_size;
+  uint32_t max_segment = io->header->segment_tail
+    ? io->header->segment_tail : io->header->max_segment;
+  uint32_t bs = io->base_seg;
+  uint32_t fno, max_nfiles = (uint32_t)(
+    ((uint64_t)segment_size * (max_segment + bs) + GRN_IO_FILE_SIZE - 1)
+    / GRN_IO_FILE_SIZE);
+  uint64_t rest = size;
+  if (!io->fis) { return 0; }
+  if (offset >= segment_size) {
+    segment += offset / segment_size;
+    offset = offset % segment_size;
+  }
+  if (segment >= io->header->max_segment) { return 0; }
+  for (fno = (segment + bs) / segments_per_file;
+       fno < max_nfiles && (!size || rest);
+       fno++, segment = fno * segments_per_file - bs, offset = 0) {
+    struct stat s;
+    uint32_t bseg = segment + bs;
+    off_t base = fno ? 0 : io->base - (uint64_t)segment_size * bs;
+    off_t pos = (uint64_t)segment_size * (bseg % segments_per_file) + offset + base;
+    off_t tail = (uint64_t)segment_size * segments_per_file + base;
+    if (size && pos + rest < tail) { tail = pos + rest; }
+    rest -= size ? tail - pos : 0;
+    if (!grn_io_prefetch_open_(ctx, io, fno)) { continue; }
+    if (fstat(io->fis[fno].fd, &s) == -1) { continue; }
+    if (s.st_size < tail) { tail = s.st_size; }
+    if (tail <= pos) { continue; }
+    if (!posix_fadvise(io->fis[fno].fd, pos, tail - pos, POSIX_FADV_WILLNEED)) {
+      n_bytes += tail - pos;
+    }
+  }
+#endif /* HAVE_POSIX_FADVISE */
+  return n_bytes;
+}
+
 void *
 grn_io_anon_map(grn_ctx *ctx, grn_io_mapinfo *mi, size_t length)
 {
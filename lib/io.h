@@ -72,6 +72,7 @@ typedef struct {
   void *addr;
   uint32_t diff;
   int32_t cached;
+  void *uncompressed_value;
 #if defined(WIN32) && defined(WIN32_FMO_EACH)
   HANDLE fmo;
 #endif /* defined(WIN32) && defined(WIN32_FMO_EACH) */
@@ -275,7 +276,6 @@ void grn_io_seg_map_(grn_ctx *ctx, grn_io *io, uint32_t segno, grn_io_mapinfo *i
         break;\
       }\
     }\
-    info->count = grn_gtick;\
   }\
   addr = info->map;\
 } while (0)
@@ -370,9 +370,24 @@ uint32_t grn_io_get_type(grn_io *io);
 grn_rc grn_io_init(void);
 grn_rc grn_io_fin(void);
 
+void grn_io_pin(grn_io *io);
 uint32_t grn_io_expire(grn_ctx *ctx, grn_io *io, int count_thresh, uint32_t limit);
 uint32_t grn_expire(grn_ctx *ctx, int count_thresh, uint32_t limit);
 
+typedef struct {
+  uint64_t mapped_memory;
+  uint64_t max_mapped_memory;
+  uint32_t n_segment_maps;
+  uint32_t n_segment_unmaps;
+} grn_io_statistics;
+
+void grn_io_get_statistics(grn_io_statistics *statistics);
+/* It unmaps cold segments if mapped segments exceed the mapped memory
+   budget. It's called at the end of a command. */
+void grn_io_enforce_budget(grn_ctx *ctx);
+uint64_t grn_io_prefetch(grn_ctx *ctx, grn_io *io, uint32_t segment,
+                         uint32_t offset, uint64_t size);
+
 /* encode/decode */
 
 #define GRN_B_ENC(v,p) do {\
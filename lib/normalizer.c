@@ -57,9 +57,19 @@ grn_normalizer_register(grn_ctx *ctx,
   return GRN_SUCCESS;
 }
 
+#ifdef GRN_WITH_NFKC
+static uint_least8_t utf8_ascii_char_types[0x80];
+#endif /* GRN_WITH_NFKC */
+
 grn_rc
 grn_normalizer_init(void)
 {
+#ifdef GRN_WITH_NFKC
+  unsigned char c[2] = {0, 0};
+  for (c[0] = 0; c[0] < 0x80; c[0]++) {
+    utf8_ascii_char_types[c[0]] = grn_nfkc_char_type(c);
+  }
+#endif /* GRN_WITH_NFKC */
   return GRN_SUCCESS;
 }
 
@@ -612,6 +622,20 @@ grn_str_charlen_utf8(grn_ctx *ctx, const unsigned char *str, const unsigned char
   return 0;
 }
 
+#define UTF8_WORD_ONES  0x0101010101010101ULL
+#define UTF8_WORD_HIGHS 0x8080808080808080ULL
+/* All bytes are printable ASCII except ' ': 0x21-0x7f. */
+#define UTF8_WORD_IS_GRAPH(word)                                        \
+  (!((word) & UTF8_WORD_HIGHS) &&                                       \
+   (((word) + UTF8_WORD_ONES * (0x80 - 0x21)) & UTF8_WORD_HIGHS) ==     \
+   UTF8_WORD_HIGHS)
+/* Sets 0x20 to bytes in 'A'-'Z'. The word must be 7 bit ASCII. */
+#define UTF8_WORD_DOWNCASE(word)                                        \
+  ((word) |                                                             \
+   (((((word) + UTF8_WORD_ONES * (0x80 - 'A')) &                        \
+      ~((word) + UTF8_WORD_ONES * (0x7f - 'Z'))) &                      \
+     UTF8_WORD_HIGHS) >> 2))
+
 inline static grn_obj *
 utf8_normalize(grn_ctx *ctx, grn_string *nstr)
 {
@@ -653,6 +677,64 @@ utf8_normalize(grn_ctx *ctx, grn_string *nstr)
   d_ = NULL;
   e = (unsigned char *)nstr->original + size;
   for (s = s_ = (unsigned char *)nstr->original; ; s += ls) {
+    /* ASCII fast path: NFKC only downcases 'A'-'Z' and never composes
+       ASCII with the previous character. Runs of printable ASCII are
+       processed 8 bytes at a time. */
+    if (s < e && 0 < *s && *s < 0x80 && (size_t)(e - s) < (size_t)(de - d)) {
+      while (s < e) {
+        unsigned char c;
+        if (s + sizeof(uint64_t) <= e && (!ch || s_ == s)) {
+          uint64_t word;
+          memcpy(&word, s, sizeof(uint64_t));
+          if (UTF8_WORD_IS_GRAPH(word)) {
+            size_t i;
+            word = UTF8_WORD_DOWNCASE(word);
+            memcpy(d, &word, sizeof(uint64_t));
+            if (cp) {
+              for (i = 0; i < sizeof(uint64_t); i++) {
+                *cp++ = utf8_ascii_char_types[d[i]];
+              }
+            }
+            if (ch) {
+              for (i = 0; i < sizeof(uint64_t); i++) { *ch++ = 1; }
+              s__ = s + sizeof(uint64_t) - 1;
+              s_ = s + sizeof(uint64_t);
+            }
+            d_ = d + sizeof(uint64_t) - 1;
+            d += sizeof(uint64_t);
+            length += sizeof(uint64_t);
+            s += sizeof(uint64_t);
+            continue;
+          }
+        }
+        c = *s;
+        if (c == '\0' || c >= 0x80) {
+          break;
+        }
+        if ((c == ' ' && removeblankp) || c < 0x20) {
+          if (cp > nstr->ctypes) { *(cp - 1) |= GRN_CHAR_BLANK; }
+        } else {
+          if ('A' <= c && c <= 'Z') { c += 'a' - 'A'; }
+          *d = c;
+          d_ = d;
+          d++;
+          length++;
+          if (cp) { *cp++ = utf8_ascii_char_types[c]; }
+          if (ch) {
+            if (s_ == s + 1) {
+              *ch++ = -1;
+            } else {
+              *ch++ = (int16_t)(s + 1 - s_);
+              s__ = s_;
+              s_ = s + 1;
+            }
+          }
+        }
+        s++;
+      }
+      ls = 0;
+      continue;
+    }
     if (!(ls = grn_str_charlen_utf8(ctx, s, e))) {
       break;
     }
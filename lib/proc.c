@@ -24,6 +24,7 @@
 #include "pat.h"
 #include "geo.h"
 #include "token.h"
+#include "expr.h"
 
 #include <string.h>
 #include <stdlib.h>
@@ -50,6 +51,7 @@ typedef struct {
 
 /**** globals for procs ****/
 const char *grn_document_root = NULL;
+int grn_select_condition_cache_size = GRN_SELECT_CONDITION_CACHE_DEFAULT_SIZE;
 
 #define VAR GRN_PROC_GET_VAR_BY_OFFSET
 
@@ -376,6 +378,7 @@ expand_query(grn_ctx *ctx, const char *query, unsigned int query_len,
 #define DEFAULT_DRILLDOWN_LIMIT           10
 #define DEFAULT_DRILLDOWN_OUTPUT_COLUMNS  "_key, _nsubrecs"
 #define DUMP_COLUMNS            "_id, _key, _value, *"
+#define MAX_TOP_K               1000
 
 static grn_expr_flags
 grn_parse_query_flags(grn_ctx *ctx, const char *query_flags,
@@ -416,6 +419,45 @@ grn_parse_query_flags(grn_ctx *ctx, const char *query_flags,
   return flags;
 }
 
+static grn_table_group_flags
+grn_parse_table_group_calc_types(grn_ctx *ctx,
+                                 const char *calc_types,
+                                 unsigned int calc_types_len)
+{
+  grn_table_group_flags flags = 0;
+  const char *calc_types_end = calc_types + calc_types_len;
+
+  while (calc_types < calc_types_end) {
+    if (*calc_types == ',' || *calc_types == ' ') {
+      calc_types += 1;
+      continue;
+    }
+
+#define CHECK_TABLE_GROUP_CALC_TYPE(name)\
+  if (((calc_types_end - calc_types) >= (sizeof(#name) - 1)) &&\
+      (!memcmp(calc_types, #name, sizeof(#name) - 1))) {\
+    flags |= GRN_TABLE_GROUP_CALC_ ## name;\
+    calc_types += sizeof(#name) - 1;\
+    continue;\
+  }
+
+    CHECK_TABLE_GROUP_CALC_TYPE(COUNT);
+    CHECK_TABLE_GROUP_CALC_TYPE(MAX);
+    CHECK_TABLE_GROUP_CALC_TYPE(MIN);
+    CHECK_TABLE_GROUP_CALC_TYPE(SUM);
+    CHECK_TABLE_GROUP_CALC_TYPE(AVG);
+
+    CHECK_TABLE_GROUP_CALC_TYPE(NONE);
+
+    ERR(GRN_INVALID_ARGUMENT, "invalid table group calc type: <%.*s>",
+        (int)(calc_types_end - calc_types), calc_types);
+    return 0;
+#undef CHECK_TABLE_GROUP_CALC_TYPE
+  }
+
+  return flags;
+}
+
 static inline grn_bool
 is_output_columns_format_v1(grn_ctx *ctx,
                             const char *output_columns,
@@ -537,6 +579,242 @@ grn_select_apply_adjuster(grn_ctx *ctx, grn_obj *table, grn_obj *res,
   }
 }
 
+/* Only the best offset + limit records are needed when they are sorted
+   by score and no other feature refers to the whole result set. */
+static int
+grn_select_top_k(grn_ctx *ctx,
+                 const char *sortby, unsigned int sortby_len,
+                 int offset, int limit,
+                 unsigned int drilldown_len, unsigned int scorer_len,
+                 unsigned int adjuster_len)
+{
+  const char *end = sortby + sortby_len;
+  if (drilldown_len || scorer_len || adjuster_len) { return 0; }
+  if (offset < 0 || limit <= 0 || offset + limit > MAX_TOP_K) { return 0; }
+  while (sortby < end && *sortby == ' ') { sortby++; }
+  while (sortby < end && end[-1] == ' ') { end--; }
+  if (end - sortby != 7 || memcmp(sortby, "-_score", 7)) { return 0; }
+  return offset + limit;
+}
+
+/*
+ * Parsed query and filter conditions of select are cached per context.
+ * The key is the table, match_columns, query and the shape of filter, so
+ * filters that differ only in string and number literals share one
+ * condition and only the literals are replaced for each call.
+ */
+typedef struct {
+  grn_obj *db;
+  uint32_t schema_version;
+  grn_obj *expr;
+  grn_obj *match_columns;
+  grn_obj literals;
+  grn_obj accessors;
+  grn_bool in_use;
+} grn_select_condition;
+
+static void
+grn_select_condition_collect_accessors(grn_ctx *ctx, grn_obj *expr,
+                                       grn_obj *accessors)
+{
+  grn_expr *e = (grn_expr *)expr;
+  grn_obj **objs = (grn_obj **)GRN_BULK_HEAD(&(e->objs));
+  unsigned int i, n_objs = GRN_BULK_VSIZE(&(e->objs)) / sizeof(grn_obj *);
+  for (i = 0; i < n_objs; i++) {
+    if (objs[i] && objs[i]->header.type == GRN_ACCESSOR) {
+      GRN_PTR_PUT(ctx, accessors, objs[i]);
+    }
+  }
+}
+
+static void
+grn_select_condition_close(grn_ctx *ctx, grn_select_condition *condition)
+{
+  unsigned int i, n_accessors;
+
+  /* Tables and columns in the expressions may be removed since they are
+     parsed. They are never closed by unlink. So only accessors are closed
+     and the rest are forgotten without touching them. */
+  n_accessors = GRN_BULK_VSIZE(&(condition->accessors)) / sizeof(grn_obj *);
+  for (i = 0; i < n_accessors; i++) {
+    grn_obj_unlink(ctx, GRN_PTR_VALUE_AT(&(condition->accessors), i));
+  }
+  GRN_BULK_REWIND(&(((grn_expr *)(condition->expr))->objs));
+  grn_obj_close(ctx, condition->expr);
+  if (condition->match_columns) {
+    GRN_BULK_REWIND(&(((grn_expr *)(condition->match_columns))->objs));
+    grn_obj_close(ctx, condition->match_columns);
+  }
+  GRN_OBJ_FIN(ctx, &(condition->literals));
+  GRN_OBJ_FIN(ctx, &(condition->accessors));
+  GRN_FREE(condition);
+}
+
+static void
+grn_select_conditions_clear(grn_ctx *ctx)
+{
+  grn_select_condition **value;
+  GRN_HASH_EACH(ctx, ctx->impl->select_conditions, id, NULL, NULL, &value, {
+    if (!(*value)->in_use) {
+      grn_select_condition_close(ctx, *value);
+      grn_hash_delete_by_id(ctx, ctx->impl->select_conditions, id, NULL);
+    }
+  });
+}
+
+void
+grn_select_conditions_fin(grn_ctx *ctx)
+{
+  if (!ctx->impl->select_conditions) {
+    return;
+  }
+  grn_select_conditions_clear(ctx);
+  grn_hash_close(ctx, ctx->impl->select_conditions);
+  ctx->impl->select_conditions = NULL;
+}
+
+/* key must be initialized. It is left empty when the condition can't be
+   cached. */
+static grn_select_condition *
+grn_select_condition_fetch(grn_ctx *ctx, grn_obj *table,
+                           const char *match_columns,
+                           unsigned int match_columns_len,
+                           const char *query, unsigned int query_len,
+                           grn_expr_flags query_flags,
+                           const char *filter, unsigned int filter_len,
+                           grn_obj *key, grn_obj *literals)
+{
+  grn_id table_id = DB_OBJ(table)->id;
+  grn_select_condition **value;
+  grn_select_condition *condition;
+  grn_id id;
+
+  if (grn_select_condition_cache_size <= 0) {
+    return NULL;
+  }
+
+  GRN_TEXT_PUT(ctx, key, &table_id, sizeof(grn_id));
+  GRN_TEXT_PUT(ctx, key, &(ctx->encoding), sizeof(grn_encoding));
+  GRN_TEXT_PUT(ctx, key, &query_flags, sizeof(grn_expr_flags));
+  GRN_TEXT_PUT(ctx, key, &match_columns_len, sizeof(unsigned int));
+  GRN_TEXT_PUT(ctx, key, match_columns, match_columns_len);
+  GRN_TEXT_PUT(ctx, key, &query_len, sizeof(unsigned int));
+  GRN_TEXT_PUT(ctx, key, query, query_len);
+  if (!grn_expr_extract_literals(ctx, filter, filter_len, key, literals) ||
+      GRN_TEXT_LEN(key) > GRN_TABLE_MAX_KEY_SIZE) {
+    GRN_BULK_REWIND(key);
+    return NULL;
+  }
+
+  if (!ctx->impl->select_conditions) {
+    return NULL;
+  }
+  id = grn_hash_get(ctx, ctx->impl->select_conditions,
+                    GRN_TEXT_VALUE(key), GRN_TEXT_LEN(key),
+                    (void **)&value);
+  if (id == GRN_ID_NIL) {
+    return NULL;
+  }
+  condition = *value;
+  if (condition->in_use) {
+    return NULL;
+  }
+  if (condition->db != ctx->impl->db ||
+      condition->schema_version != grn_db_schema_version(ctx->impl->db)) {
+    grn_select_condition_close(ctx, condition);
+    grn_hash_delete_by_id(ctx, ctx->impl->select_conditions, id, NULL);
+    return NULL;
+  }
+  if (grn_expr_bind_literals(ctx, condition->expr, filter, literals,
+                             &(condition->literals)) != GRN_SUCCESS) {
+    /* The literal can't be casted as the cached one was. Parse it again
+       to report the same result as the parser. */
+    ERRCLR(ctx);
+    return NULL;
+  }
+  condition->in_use = GRN_TRUE;
+  return condition;
+}
+
+static grn_select_condition *
+grn_select_condition_add(grn_ctx *ctx, grn_obj *key,
+                         uint32_t schema_version,
+                         grn_obj *expr, grn_obj *match_columns,
+                         grn_obj *extracted_literals,
+                         grn_obj *parsed_literals)
+{
+  grn_select_condition **value;
+  grn_select_condition *condition;
+  int added;
+
+  if (GRN_TEXT_LEN(key) == 0 ||
+      ((grn_expr *)expr)->taintable ||
+      !grn_expr_literals_bindable(ctx, expr,
+                                  extracted_literals, parsed_literals)) {
+    return NULL;
+  }
+
+  if (!ctx->impl->select_conditions) {
+    ctx->impl->select_conditions =
+      grn_hash_create(ctx, NULL, GRN_TABLE_MAX_KEY_SIZE,
+                      sizeof(grn_select_condition *),
+                      GRN_OBJ_KEY_VAR_SIZE|GRN_HASH_TINY);
+    if (!ctx->impl->select_conditions) {
+      return NULL;
+    }
+  } else if (GRN_HASH_SIZE(ctx->impl->select_conditions) >=
+             grn_select_condition_cache_size) {
+    grn_select_conditions_clear(ctx);
+  }
+
+  if (!(condition = GRN_MALLOCN(grn_select_condition, 1))) {
+    return NULL;
+  }
+  if (!grn_hash_add(ctx, ctx->impl->select_conditions,
+                    GRN_TEXT_VALUE(key), GRN_TEXT_LEN(key),
+                    (void **)&value, &added) || !added) {
+    GRN_FREE(condition);
+    return NULL;
+  }
+  condition->db = ctx->impl->db;
+  condition->schema_version = schema_version;
+  condition->expr = expr;
+  condition->match_columns = match_columns;
+  GRN_TEXT_INIT(&(condition->literals), 0);
+  GRN_TEXT_PUT(ctx, &(condition->literals),
+               GRN_BULK_HEAD(parsed_literals), GRN_BULK_VSIZE(parsed_literals));
+  GRN_PTR_INIT(&(condition->accessors), GRN_OBJ_VECTOR, GRN_ID_NIL);
+  grn_select_condition_collect_accessors(ctx, expr, &(condition->accessors));
+  if (match_columns) {
+    grn_select_condition_collect_accessors(ctx, match_columns,
+                                           &(condition->accessors));
+  }
+  condition->in_use = GRN_TRUE;
+  *value = condition;
+  return condition;
+}
+
+static double
+grn_select_parse_double(grn_ctx *ctx, const char *name,
+                        const char *value, unsigned int value_len)
+{
+  char buffer[GRN_TABLE_MAX_KEY_SIZE];
+  char *rest;
+  double parsed;
+  if (value_len >= sizeof(buffer)) {
+    ERR(GRN_INVALID_ARGUMENT, "too long %s: <%.*s>", name, value_len, value);
+    return 0;
+  }
+  memcpy(buffer, value, value_len);
+  buffer[value_len] = '\0';
+  parsed = strtod(buffer, &rest);
+  if (rest != buffer + value_len) {
+    ERR(GRN_INVALID_ARGUMENT, "invalid %s: <%.*s>", name, value_len, value);
+    return 0;
+  }
+  return parsed;
+}
+
 grn_rc
 grn_select(grn_ctx *ctx, const char *table, unsigned int table_len,
            const char *match_columns, unsigned int match_columns_len,
@@ -554,7 +832,12 @@ grn_select(grn_ctx *ctx, const char *table, unsigned int table_len,
            const char *match_escalation_threshold, unsigned int match_escalation_threshold_len,
            const char *query_expander, unsigned int query_expander_len,
            const char *query_flags, unsigned int query_flags_len,
-           const char *adjuster, unsigned int adjuster_len)
+           const char *adjuster, unsigned int adjuster_len,
+           const char *scorer_model, unsigned int scorer_model_len,
+           const char *bm25_k1, unsigned int bm25_k1_len,
+           const char *bm25_b, unsigned int bm25_b_len,
+           const char *drilldown_calc_types, unsigned int drilldown_calc_types_len,
+           const char *drilldown_calc_target, unsigned int drilldown_calc_target_len)
 {
   uint32_t nkeys, nhits;
   uint16_t cacheable = 1, taintable = 0;
@@ -569,9 +852,23 @@ grn_select(grn_ctx *ctx, const char *table, unsigned int table_len,
     drilldown_len + 1 + drilldown_sortby_len + 1 +
     drilldown_output_columns_len + 1 + match_escalation_threshold_len + 1 +
     query_expander_len + 1 + query_flags_len + 1 + adjuster_len + 1 +
+    scorer_model_len + 1 + bm25_k1_len + 1 + bm25_b_len + 1 +
+    drilldown_calc_types_len + 1 + drilldown_calc_target_len + 1 +
     sizeof(grn_content_type) + sizeof(int) * 4;
   long long int threshold, original_threshold = 0;
+  grn_bool scorer_model_changed = GRN_FALSE;
+  grn_scorer_model original_scorer_model = GRN_SCORER_MODEL_TF;
+  double original_bm25_k1 = 0, original_bm25_b = 0;
   grn_cache *cache_obj = grn_cache_current_get(ctx);
+  grn_select_condition *condition = NULL;
+  grn_obj query_expander_buf;
+  grn_obj condition_key;
+  grn_obj extracted_literals;
+  grn_obj parsed_literals;
+  GRN_TEXT_INIT(&query_expander_buf, 0);
+  GRN_TEXT_INIT(&condition_key, 0);
+  GRN_TEXT_INIT(&extracted_literals, 0);
+  GRN_TEXT_INIT(&parsed_literals, 0);
   if (cache_key_size <= GRN_TABLE_MAX_KEY_SIZE) {
     grn_obj *cache_value;
     char *cp = cache_key;
@@ -603,6 +900,16 @@ grn_select(grn_ctx *ctx, const char *table, unsigned int table_len,
     cp += query_flags_len; *cp++ = '\0';
     memcpy(cp, adjuster, adjuster_len);
     cp += adjuster_len; *cp++ = '\0';
+    memcpy(cp, scorer_model, scorer_model_len);
+    cp += scorer_model_len; *cp++ = '\0';
+    memcpy(cp, bm25_k1, bm25_k1_len);
+    cp += bm25_k1_len; *cp++ = '\0';
+    memcpy(cp, bm25_b, bm25_b_len);
+    cp += bm25_b_len; *cp++ = '\0';
+    memcpy(cp, drilldown_calc_types, drilldown_calc_types_len);
+    cp += drilldown_calc_types_len; *cp++ = '\0';
+    memcpy(cp, drilldown_calc_target, drilldown_calc_target_len);
+    cp += drilldown_calc_target_len; *cp++ = '\0';
     memcpy(cp, &output_type, sizeof(grn_content_type)); cp += sizeof(grn_content_type);
     memcpy(cp, &offset, sizeof(int)); cp += sizeof(int);
     memcpy(cp, &limit, sizeof(int)); cp += sizeof(int);
@@ -629,59 +936,115 @@ grn_select(grn_ctx *ctx, const char *table, unsigned int table_len,
       grn_ctx_set_match_escalation_threshold(ctx, threshold);
     }
   }
+  if (scorer_model_len || bm25_k1_len || bm25_b_len) {
+    grn_scorer_model model = ctx->impl->scorer_model;
+    double k1 = ctx->impl->scorer_bm25_k1, b = ctx->impl->scorer_bm25_b;
+    original_scorer_model = model;
+    original_bm25_k1 = k1;
+    original_bm25_b = b;
+    if (scorer_model_len) {
+      if (scorer_model_len == 2 && !memcmp(scorer_model, "tf", 2)) {
+        model = GRN_SCORER_MODEL_TF;
+      } else if (scorer_model_len == 5 && !memcmp(scorer_model, "tfidf", 5)) {
+        model = GRN_SCORER_MODEL_TFIDF;
+      } else if (scorer_model_len == 4 && !memcmp(scorer_model, "bm25", 4)) {
+        model = GRN_SCORER_MODEL_BM25;
+      } else {
+        ERR(GRN_INVALID_ARGUMENT, "invalid scorer model: <%.*s>",
+            scorer_model_len, scorer_model);
+        goto exit;
+      }
+    }
+    if (bm25_k1_len) {
+      k1 = grn_select_parse_double(ctx, "bm25_k1", bm25_k1, bm25_k1_len);
+      if (ctx->rc) { goto exit; }
+    }
+    if (bm25_b_len) {
+      b = grn_select_parse_double(ctx, "bm25_b", bm25_b, bm25_b_len);
+      if (ctx->rc) { goto exit; }
+    }
+    if (grn_ctx_set_scorer_model(ctx, model, k1, b)) { goto exit; }
+    scorer_model_changed = GRN_TRUE;
+  }
   if ((table_ = grn_ctx_get(ctx, table, table_len))) {
     // match_columns_ = grn_obj_column(ctx, table_, match_columns, match_columns_len);
     if (query_len || filter_len) {
       grn_obj *v;
-      GRN_EXPR_CREATE_FOR_QUERY(ctx, table_, cond, v);
-      if (cond) {
-        if (match_columns_len) {
-          GRN_EXPR_CREATE_FOR_QUERY(ctx, table_, match_columns_, v);
-          if (match_columns_) {
-            grn_expr_parse(ctx, match_columns_, match_columns, match_columns_len,
-                           NULL, GRN_OP_MATCH, GRN_OP_AND,
-                           GRN_EXPR_SYNTAX_SCRIPT);
-          } else {
-            /* todo */
+      grn_expr_flags flags = 0;
+      uint32_t schema_version = grn_db_schema_version(ctx->impl->db);
+      if (query_len) {
+        flags = GRN_EXPR_SYNTAX_QUERY;
+        if (query_flags_len) {
+          flags |= grn_parse_query_flags(ctx, query_flags, query_flags_len);
+        } else {
+          flags |= GRN_EXPR_ALLOW_PRAGMA|GRN_EXPR_ALLOW_COLUMN;
+          if (ctx->rc) {
+            goto exit;
           }
         }
-        if (query_len) {
-          grn_expr_flags flags;
-          grn_obj query_expander_buf;
-          GRN_TEXT_INIT(&query_expander_buf, 0);
-          flags = GRN_EXPR_SYNTAX_QUERY;
-          if (query_flags_len) {
-            flags |= grn_parse_query_flags(ctx, query_flags, query_flags_len);
+        if (query_expander_len) {
+          if (expand_query(ctx, query, query_len, flags,
+                           query_expander, query_expander_len,
+                           &query_expander_buf) == GRN_SUCCESS) {
+            query = GRN_TEXT_VALUE(&query_expander_buf);
+            query_len = GRN_TEXT_LEN(&query_expander_buf);
           } else {
-            flags |= GRN_EXPR_ALLOW_PRAGMA|GRN_EXPR_ALLOW_COLUMN;
-            if (ctx->rc) {
-              goto exit;
-            }
+            goto exit;
           }
-          if (query_expander_len) {
-            if (expand_query(ctx, query, query_len, flags,
-                             query_expander, query_expander_len,
-                             &query_expander_buf) == GRN_SUCCESS) {
-              query = GRN_TEXT_VALUE(&query_expander_buf);
-              query_len = GRN_TEXT_LEN(&query_expander_buf);
+        }
+      }
+      if (!ctx->rc) {
+        condition = grn_select_condition_fetch(ctx, table_,
+                                               match_columns,
+                                               match_columns_len,
+                                               query, query_len, flags,
+                                               filter, filter_len,
+                                               &condition_key,
+                                               &extracted_literals);
+      }
+      if (condition) {
+        cond = condition->expr;
+        match_columns_ = condition->match_columns;
+      } else {
+        GRN_EXPR_CREATE_FOR_QUERY(ctx, table_, cond, v);
+      }
+      if (cond) {
+        if (condition) {
+          /* Parsed by a previous call. */
+        } else {
+          if (match_columns_len) {
+            GRN_EXPR_CREATE_FOR_QUERY(ctx, table_, match_columns_, v);
+            if (match_columns_) {
+              grn_expr_parse(ctx, match_columns_, match_columns, match_columns_len,
+                             NULL, GRN_OP_MATCH, GRN_OP_AND,
+                             GRN_EXPR_SYNTAX_SCRIPT);
             } else {
-              GRN_OBJ_FIN(ctx, &query_expander_buf);
-              goto exit;
+              /* todo */
             }
           }
-          grn_expr_parse(ctx, cond, query, query_len,
-                         match_columns_, GRN_OP_MATCH, GRN_OP_AND, flags);
-          GRN_OBJ_FIN(ctx, &query_expander_buf);
-          if (!ctx->rc && filter_len) {
-            grn_expr_parse(ctx, cond, filter, filter_len,
-                           match_columns_, GRN_OP_MATCH, GRN_OP_AND,
-                           GRN_EXPR_SYNTAX_SCRIPT);
-            if (!ctx->rc) { grn_expr_append_op(ctx, cond, GRN_OP_AND, 2); }
+          if (query_len) {
+            grn_expr_parse(ctx, cond, query, query_len,
+                           match_columns_, GRN_OP_MATCH, GRN_OP_AND, flags);
+            if (!ctx->rc && filter_len) {
+              grn_expr_parse_with_literals(ctx, cond, filter, filter_len,
+                                           match_columns_, GRN_OP_MATCH,
+                                           GRN_OP_AND, GRN_EXPR_SYNTAX_SCRIPT,
+                                           &parsed_literals);
+              if (!ctx->rc) { grn_expr_append_op(ctx, cond, GRN_OP_AND, 2); }
+            }
+          } else {
+            grn_expr_parse_with_literals(ctx, cond, filter, filter_len,
+                                         match_columns_, GRN_OP_MATCH,
+                                         GRN_OP_AND, GRN_EXPR_SYNTAX_SCRIPT,
+                                         &parsed_literals);
+          }
+          if (!ctx->rc) {
+            condition = grn_select_condition_add(ctx, &condition_key,
+                                                 schema_version,
+                                                 cond, match_columns_,
+                                                 &extracted_literals,
+                                                 &parsed_literals);
           }
-        } else {
-          grn_expr_parse(ctx, cond, filter, filter_len,
-                         match_columns_, GRN_OP_MATCH, GRN_OP_AND,
-                         GRN_EXPR_SYNTAX_SCRIPT);
         }
         cacheable *= ((grn_expr *)cond)->cacheable;
         taintable += ((grn_expr *)cond)->taintable;
@@ -693,7 +1056,14 @@ grn_select(grn_ctx *ctx, const char *table, unsigned int table_len,
         GRN_LOG(ctx, GRN_LOG_NOTICE, "query=(%s)", GRN_TEXT_VALUE(&strbuf));
         GRN_OBJ_FIN(ctx, &strbuf);
         */
-        if (!ctx->rc) { res = grn_table_select(ctx, table_, cond, NULL, GRN_OP_OR); }
+        if (!ctx->rc) {
+          ctx->impl->top_k = grn_select_top_k(ctx, sortby, sortby_len,
+                                              offset, limit, drilldown_len,
+                                              scorer_len, adjuster_len);
+          ctx->impl->top_k_n_hits = 0;
+          res = grn_table_select(ctx, table_, cond, NULL, GRN_OP_OR);
+          ctx->impl->top_k = 0;
+        }
       } else {
         /* todo */
         ERRCLR(ctx);
@@ -702,6 +1072,10 @@ grn_select(grn_ctx *ctx, const char *table, unsigned int table_len,
       res = table_;
     }
     nhits = res ? grn_table_size(ctx, res) : 0;
+    if (nhits < ctx->impl->top_k_n_hits) {
+      nhits = ctx->impl->top_k_n_hits;
+    }
+    ctx->impl->top_k_n_hits = 0;
     GRN_QUERY_LOG(ctx, GRN_QUERY_LOG_SIZE,
                   ":", "select(%d)", nhits);
 
@@ -827,16 +1201,47 @@ grn_select(grn_ctx *ctx, const char *table, unsigned int table_len,
                     ":", "output(%d)", limit);
       if (!ctx->rc && drilldown_len) {
         uint32_t i;
-        grn_table_group_result g = {NULL, 0, 0, 1, GRN_TABLE_GROUP_CALC_COUNT, 0};
-        if (gkeys) {
-          for (i = 0; i < ngkeys; i++) {
-            if ((g.table = grn_table_create_for_group(ctx, NULL, 0, NULL,
-                                                      gkeys[i].key, res, 0))) {
+        grn_table_group_flags calc_types = GRN_TABLE_GROUP_CALC_COUNT;
+        grn_obj *calc_target = NULL;
+        grn_table_group_result *results = NULL;
+        if (drilldown_calc_types_len) {
+          calc_types = grn_parse_table_group_calc_types(ctx,
+                                                        drilldown_calc_types,
+                                                        drilldown_calc_types_len);
+        }
+        if (!ctx->rc && drilldown_calc_target_len) {
+          calc_target = grn_obj_column(ctx, res,
+                                       drilldown_calc_target,
+                                       drilldown_calc_target_len);
+          if (!calc_target) {
+            ERR(GRN_INVALID_ARGUMENT, "invalid drilldown calc target: <%.*s>",
+                drilldown_calc_target_len, drilldown_calc_target);
+          }
+        }
+        if (ctx->rc) {
+          if (gkeys) { grn_table_sort_key_close(ctx, gkeys, ngkeys); }
+        } else if (gkeys) {
+          /* All drilldown keys are grouped by one scan of res. */
+          results = GRN_MALLOCN(grn_table_group_result, ngkeys);
+          if (results) {
+            for (i = 0; i < ngkeys; i++) {
+              results[i].table = NULL;
+              results[i].key_begin = i;
+              results[i].key_end = i + 1;
+              results[i].limit = 0;
+              results[i].flags = calc_types;
+              results[i].op = 0;
+              results[i].calc_target = calc_target;
+            }
+            grn_table_group(ctx, res, gkeys, ngkeys, results, ngkeys);
+          }
+          for (i = 0; results && i < ngkeys; i++) {
+            grn_obj *group = results[i].table;
+            if (group) {
               int n_drilldown_offset = drilldown_offset,
                   n_drilldown_limit = drilldown_limit;
 
-              grn_table_group(ctx, res, &gkeys[i], 1, &g, 1);
-              nhits = grn_table_size(ctx, g.table);
+              nhits = grn_table_size(ctx, group);
 
               grn_normalize_offset_and_limit(ctx, nhits,
                                              &n_drilldown_offset, &n_drilldown_limit);
@@ -844,10 +1249,10 @@ grn_select(grn_ctx *ctx, const char *table, unsigned int table_len,
               if (drilldown_sortby_len) {
                 if ((keys = grn_table_sort_key_from_str(ctx,
                                                         drilldown_sortby, drilldown_sortby_len,
-                                                        g.table, &nkeys))) {
+                                                        group, &nkeys))) {
                   if ((sorted = grn_table_create(ctx, NULL, 0, NULL, GRN_OBJ_TABLE_NO_KEY,
-                                                 NULL, g.table))) {
-                    grn_table_sort(ctx, g.table, n_drilldown_offset, n_drilldown_limit,
+                                                 NULL, group))) {
+                    grn_table_sort(ctx, group, n_drilldown_offset, n_drilldown_limit,
                                    sorted, keys, nkeys);
                     GRN_OBJ_FORMAT_INIT(&format, nhits, 0,
                                         n_drilldown_limit, n_drilldown_offset);
@@ -869,18 +1274,20 @@ grn_select(grn_ctx *ctx, const char *table, unsigned int table_len,
                 format.flags =
                   GRN_OBJ_FORMAT_WITH_COLUMN_NAMES|
                   GRN_OBJ_FORMAT_XML_ELEMENT_NAVIGATIONENTRY;
-                grn_obj_columns(ctx, g.table, drilldown_output_columns,
+                grn_obj_columns(ctx, group, drilldown_output_columns,
                                 drilldown_output_columns_len, &format.columns);
-                GRN_OUTPUT_OBJ(g.table, &format);
+                GRN_OUTPUT_OBJ(group, &format);
                 GRN_OBJ_FORMAT_FIN(ctx, &format);
               }
-              grn_obj_unlink(ctx, g.table);
+              grn_obj_unlink(ctx, group);
             }
             GRN_QUERY_LOG(ctx, GRN_QUERY_LOG_SIZE,
                           ":", "drilldown(%d)", nhits);
           }
+          if (results) { GRN_FREE(results); }
           grn_table_sort_key_close(ctx, gkeys, ngkeys);
         }
+        if (calc_target) { grn_obj_unlink(ctx, calc_target); }
       }
       if (res != table_) { grn_obj_unlink(ctx, res); }
     } else {
@@ -889,7 +1296,24 @@ grn_select(grn_ctx *ctx, const char *table, unsigned int table_len,
     GRN_OUTPUT_ARRAY_CLOSE();
     if (!ctx->rc && cacheable && cache_key_size <= GRN_TABLE_MAX_KEY_SIZE
         && (!cache || cache_len != 2 || *cache != 'n' || *(cache + 1) != 'o')) {
-      grn_cache_update(ctx, cache_obj, cache_key, cache_key_size, outbuf);
+      grn_obj dependencies;
+      GRN_RECORD_INIT(&dependencies, GRN_OBJ_VECTOR, GRN_ID_NIL);
+      grn_table_get_related_tables(ctx, table_, &dependencies);
+      if (query_expander_len) {
+        grn_obj *expander;
+        expander = grn_ctx_get(ctx, query_expander, query_expander_len);
+        if (expander &&
+            (expander->header.type == GRN_COLUMN_FIX_SIZE ||
+             expander->header.type == GRN_COLUMN_VAR_SIZE)) {
+          grn_table_get_related_tables(ctx,
+                                       grn_column_table(ctx, expander),
+                                       &dependencies);
+        }
+        if (expander) { grn_obj_unlink(ctx, expander); }
+      }
+      grn_cache_update(ctx, cache_obj, cache_key, cache_key_size, outbuf,
+                       &dependencies);
+      GRN_OBJ_FIN(ctx, &dependencies);
     }
     if (taintable) { grn_db_touch(ctx, DB_OBJ(table_)->db); }
     grn_obj_unlink(ctx, table_);
@@ -900,12 +1324,24 @@ exit:
   if (match_escalation_threshold_len) {
     grn_ctx_set_match_escalation_threshold(ctx, original_threshold);
   }
-  if (match_columns_) {
-    grn_obj_unlink(ctx, match_columns_);
+  if (scorer_model_changed) {
+    grn_ctx_set_scorer_model(ctx, original_scorer_model,
+                             original_bm25_k1, original_bm25_b);
   }
-  if (cond) {
-    grn_obj_unlink(ctx, cond);
+  if (condition) {
+    condition->in_use = GRN_FALSE;
+  } else {
+    if (match_columns_) {
+      grn_obj_unlink(ctx, match_columns_);
+    }
+    if (cond) {
+      grn_obj_unlink(ctx, cond);
+    }
   }
+  GRN_OBJ_FIN(ctx, &query_expander_buf);
+  GRN_OBJ_FIN(ctx, &condition_key);
+  GRN_OBJ_FIN(ctx, &extracted_literals);
+  GRN_OBJ_FIN(ctx, &parsed_literals);
   /* GRN_LOG(ctx, GRN_LOG_NONE, "%d", ctx->seqno); */
   return ctx->rc;
 }
@@ -959,7 +1395,12 @@ proc_select(grn_ctx *ctx, int nargs, grn_obj **args, grn_user_data *user_data)
                  GRN_TEXT_VALUE(VAR(15)), GRN_TEXT_LEN(VAR(15)),
                  GRN_TEXT_VALUE(query_expander), GRN_TEXT_LEN(query_expander),
                  GRN_TEXT_VALUE(VAR(17)), GRN_TEXT_LEN(VAR(17)),
-                 GRN_TEXT_VALUE(adjuster), GRN_TEXT_LEN(adjuster))) {
+                 GRN_TEXT_VALUE(adjuster), GRN_TEXT_LEN(adjuster),
+                 GRN_TEXT_VALUE(VAR(20)), GRN_TEXT_LEN(VAR(20)),
+                 GRN_TEXT_VALUE(VAR(21)), GRN_TEXT_LEN(VAR(21)),
+                 GRN_TEXT_VALUE(VAR(22)), GRN_TEXT_LEN(VAR(22)),
+                 GRN_TEXT_VALUE(VAR(23)), GRN_TEXT_LEN(VAR(23)),
+                 GRN_TEXT_VALUE(VAR(24)), GRN_TEXT_LEN(VAR(24)))) {
   }
   return NULL;
 }
@@ -995,7 +1436,7 @@ proc_load(grn_ctx *ctx, int nargs, grn_obj **args, grn_user_data *user_data)
   } else {
     GRN_OUTPUT_INT64(ctx->impl->loader.nrecords);
     if (ctx->impl->loader.table) {
-      grn_db_touch(ctx, DB_OBJ(ctx->impl->loader.table)->db);
+      grn_table_touch_related_tables(ctx, ctx->impl->loader.table);
     }
     /* maybe necessary : grn_ctx_loader_clear(ctx); */
   }
@@ -1008,11 +1449,13 @@ proc_status(grn_ctx *ctx, int nargs, grn_obj **args, grn_user_data *user_data)
   grn_timeval now;
   grn_cache *cache;
   grn_cache_statistics statistics;
+  grn_io_statistics io_statistics;
 
   grn_timeval_now(ctx, &now);
   cache = grn_cache_current_get(ctx);
   grn_cache_get_statistics(ctx, cache, &statistics);
-  GRN_OUTPUT_MAP_OPEN("RESULT", 18);
+  grn_io_get_statistics(&io_statistics);
+  GRN_OUTPUT_MAP_OPEN("RESULT", 22);
   GRN_OUTPUT_CSTR("alloc_count");
   GRN_OUTPUT_INT32(grn_alloc_count());
   GRN_OUTPUT_CSTR("starttime");
@@ -1037,6 +1480,48 @@ proc_status(grn_ctx *ctx, int nargs, grn_obj **args, grn_user_data *user_data)
   GRN_OUTPUT_INT32(grn_get_default_command_version());
   GRN_OUTPUT_CSTR("max_command_version");
   GRN_OUTPUT_INT32(GRN_COMMAND_VERSION_MAX);
+  GRN_OUTPUT_CSTR("cache");
+  GRN_OUTPUT_MAP_OPEN("CACHE", 10);
+  GRN_OUTPUT_CSTR("n_entries");
+  GRN_OUTPUT_INT64(statistics.nentries);
+  GRN_OUTPUT_CSTR("max_n_entries");
+  GRN_OUTPUT_INT64(statistics.max_nentries);
+  GRN_OUTPUT_CSTR("n_bytes");
+  GRN_OUTPUT_INT64(statistics.nbytes);
+  GRN_OUTPUT_CSTR("max_n_bytes");
+  GRN_OUTPUT_INT64(statistics.max_nbytes);
+  GRN_OUTPUT_CSTR("shards");
+  {
+    int i;
+    GRN_OUTPUT_ARRAY_OPEN("SHARDS", GRN_CACHE_N_SHARDS);
+    for (i = 0; i < GRN_CACHE_N_SHARDS; i++) {
+      grn_cache_statistics shard_statistics;
+      grn_cache_get_shard_statistics(ctx, cache, i, &shard_statistics);
+      GRN_OUTPUT_MAP_OPEN("SHARD", 8);
+      GRN_OUTPUT_CSTR("n_entries");
+      GRN_OUTPUT_INT64(shard_statistics.nentries);
+      GRN_OUTPUT_CSTR("n_bytes");
+      GRN_OUTPUT_INT64(shard_statistics.nbytes);
+      GRN_OUTPUT_CSTR("n_fetches");
+      GRN_OUTPUT_INT64(shard_statistics.nfetches);
+      GRN_OUTPUT_CSTR("n_hits");
+      GRN_OUTPUT_INT64(shard_statistics.nhits);
+      GRN_OUTPUT_MAP_CLOSE();
+    }
+    GRN_OUTPUT_ARRAY_CLOSE();
+  }
+  GRN_OUTPUT_MAP_CLOSE();
+  GRN_OUTPUT_CSTR("mapped_memory");
+  GRN_OUTPUT_MAP_OPEN("MAPPED_MEMORY", 8);
+  GRN_OUTPUT_CSTR("size");
+  GRN_OUTPUT_INT64(io_statistics.mapped_memory);
+  GRN_OUTPUT_CSTR("max_size");
+  GRN_OUTPUT_INT64(io_statistics.max_mapped_memory);
+  GRN_OUTPUT_CSTR("n_segment_maps");
+  GRN_OUTPUT_INT64(io_statistics.n_segment_maps);
+  GRN_OUTPUT_CSTR("n_segment_unmaps");
+  GRN_OUTPUT_INT64(io_statistics.n_segment_unmaps);
+  GRN_OUTPUT_MAP_CLOSE();
   GRN_OUTPUT_MAP_CLOSE();
   return NULL;
 }
@@ -1107,6 +1592,18 @@ grn_parse_column_create_flags(grn_ctx *ctx, const char *nptr, const char *end)
     } else if (!memcmp(nptr, "RING_BUFFER", 11)) {
       flags |= GRN_OBJ_RING_BUFFER;
       nptr += 11;
+    } else if (!memcmp(nptr, "COMPRESS_ZLIB", 13)) {
+      flags |= GRN_OBJ_COMPRESS_ZLIB;
+      nptr += 13;
+    } else if (!memcmp(nptr, "COMPRESS_LZO", 12)) {
+      flags |= GRN_OBJ_COMPRESS_LZO;
+      nptr += 12;
+    } else if (!memcmp(nptr, "COMPRESS_LZ4", 12)) {
+      flags |= GRN_OBJ_COMPRESS_LZ4;
+      nptr += 12;
+    } else if (!memcmp(nptr, "COMPRESS_ZSTD", 13)) {
+      flags |= GRN_OBJ_COMPRESS_ZSTD;
+      nptr += 13;
     } else {
       ERR(GRN_INVALID_ARGUMENT, "invalid flags option: %.*s",
           (int)(end - nptr), nptr);
@@ -1178,6 +1675,12 @@ grn_column_create_flags_to_text(grn_ctx *ctx, grn_obj *buf, grn_obj_flags flags)
   case GRN_OBJ_COMPRESS_LZO:
     GRN_TEXT_PUTS(ctx, buf, "|COMPRESS_LZO");
     break;
+  case GRN_OBJ_COMPRESS_LZ4:
+    GRN_TEXT_PUTS(ctx, buf, "|COMPRESS_LZ4");
+    break;
+  case GRN_OBJ_COMPRESS_ZSTD:
+    GRN_TEXT_PUTS(ctx, buf, "|COMPRESS_ZSTD");
+    break;
   }
   if (flags & GRN_OBJ_PERSISTENT) {
     GRN_TEXT_PUTS(ctx, buf, "|PERSISTENT");
@@ -2774,6 +3277,18 @@ proc_cache_limit(grn_ctx *ctx, int nargs, grn_obj **args, grn_user_data *user_da
           (int)GRN_TEXT_LEN(VAR(0)), GRN_TEXT_VALUE(VAR(0)));
     }
   }
+  if (ctx->rc == GRN_SUCCESS && GRN_TEXT_LEN(VAR(1))) {
+    const char *rest;
+    int64_t max_n_bytes = grn_atoll(GRN_TEXT_VALUE(VAR(1)),
+                                    GRN_BULK_CURR(VAR(1)), &rest);
+    if (GRN_BULK_CURR(VAR(1)) == rest && max_n_bytes >= 0) {
+      grn_cache_set_max_n_bytes(ctx, cache, max_n_bytes);
+    } else {
+      ERR(GRN_INVALID_ARGUMENT,
+          "max_n_bytes value is invalid unsigned integer format: <%.*s>",
+          (int)GRN_TEXT_LEN(VAR(1)), GRN_TEXT_VALUE(VAR(1)));
+    }
+  }
   if (ctx->rc == GRN_SUCCESS) {
     GRN_OUTPUT_INT64(current_max_n_entries);
   }
@@ -2941,6 +3456,135 @@ proc_truncate(grn_ctx *ctx, int nargs, grn_obj **args, grn_user_data *user_data)
   return NULL;
 }
 
+static void
+warm_up_object(grn_ctx *ctx, grn_obj *object)
+{
+  char name[GRN_TABLE_MAX_KEY_SIZE];
+  int name_size;
+  uint64_t n_bytes;
+  n_bytes = grn_obj_prefetch(ctx, object);
+  name_size = grn_obj_name(ctx, object, name, GRN_TABLE_MAX_KEY_SIZE);
+  GRN_LOG(ctx, GRN_LOG_INFO,
+          "[warm_up] <%.*s>: %" GRN_FMT_LLU " bytes",
+          name_size, name, (unsigned long long int)n_bytes);
+}
+
+/* Index columns are warmed up before data columns. */
+static void
+warm_up_columns(grn_ctx *ctx, grn_obj *column_ids)
+{
+  int i, n = GRN_BULK_VSIZE(column_ids) / sizeof(grn_id);
+  grn_bool index_p;
+  for (index_p = GRN_TRUE;; index_p = GRN_FALSE) {
+    for (i = 0; i < n; i++) {
+      grn_obj *column = grn_ctx_at(ctx, GRN_RECORD_VALUE_AT(column_ids, i));
+      if (!column) {
+        ERRCLR(ctx);
+        continue;
+      }
+      if ((column->header.type == GRN_COLUMN_INDEX) == index_p) {
+        warm_up_object(ctx, column);
+      }
+      grn_obj_unlink(ctx, column);
+    }
+    if (!index_p) { break; }
+  }
+}
+
+static void
+warm_up_table(grn_ctx *ctx, grn_obj *table, grn_obj *column_ids)
+{
+  grn_hash *columns;
+  warm_up_object(ctx, table);
+  if ((columns = grn_hash_create(ctx, NULL, sizeof(grn_id), 0,
+                                 GRN_OBJ_TABLE_HASH_KEY|GRN_HASH_TINY))) {
+    if (grn_table_columns(ctx, table, NULL, 0, (grn_obj *)columns) >= 0) {
+      grn_id *key;
+      GRN_HASH_EACH(ctx, columns, id, &key, NULL, NULL, {
+        GRN_RECORD_PUT(ctx, column_ids, *key);
+      });
+    }
+    grn_hash_close(ctx, columns);
+  }
+}
+
+static grn_obj *
+proc_warm_up(grn_ctx *ctx, int nargs, grn_obj **args, grn_user_data *user_data)
+{
+  int name_len = GRN_TEXT_LEN(VAR(0));
+  grn_obj column_ids;
+  GRN_RECORD_INIT(&column_ids, GRN_OBJ_VECTOR, GRN_ID_NIL);
+  if (name_len == 0) {
+    grn_table_cursor *cursor;
+    /* Tables, which include lexicons, are warmed up first. */
+    if ((cursor = grn_table_cursor_open(ctx, ctx->impl->db, NULL, 0, NULL, 0,
+                                        0, -1, GRN_CURSOR_BY_ID))) {
+      grn_id id;
+      while ((id = grn_table_cursor_next(ctx, cursor)) != GRN_ID_NIL) {
+        grn_obj *object = grn_ctx_at(ctx, id);
+        if (!object) {
+          ERRCLR(ctx);
+          continue;
+        }
+        switch (object->header.type) {
+        case GRN_TABLE_HASH_KEY :
+        case GRN_TABLE_PAT_KEY :
+        case GRN_TABLE_DAT_KEY :
+        case GRN_TABLE_NO_KEY :
+          warm_up_object(ctx, object);
+          break;
+        case GRN_COLUMN_FIX_SIZE :
+        case GRN_COLUMN_VAR_SIZE :
+        case GRN_COLUMN_INDEX :
+          GRN_RECORD_PUT(ctx, &column_ids, id);
+          break;
+        default :
+          break;
+        }
+        grn_obj_unlink(ctx, object);
+      }
+      grn_table_cursor_close(ctx, cursor);
+    }
+  } else {
+    const char *name = GRN_TEXT_VALUE(VAR(0));
+    grn_obj *object = grn_ctx_get(ctx, name, name_len);
+    if (!object) {
+      ERR(GRN_INVALID_ARGUMENT,
+          "[warm_up] no such object: <%.*s>", name_len, name);
+    } else {
+      switch (object->header.type) {
+      case GRN_TABLE_HASH_KEY :
+      case GRN_TABLE_PAT_KEY :
+      case GRN_TABLE_DAT_KEY :
+      case GRN_TABLE_NO_KEY :
+        warm_up_table(ctx, object, &column_ids);
+        break;
+      case GRN_COLUMN_FIX_SIZE :
+      case GRN_COLUMN_VAR_SIZE :
+      case GRN_COLUMN_INDEX :
+        warm_up_object(ctx, object);
+        break;
+      default :
+        {
+          grn_obj buffer;
+          GRN_TEXT_INIT(&buffer, 0);
+          grn_inspect(ctx, &buffer, object);
+          ERR(GRN_INVALID_ARGUMENT,
+              "[warm_up] not a table nor a column: %.*s",
+              (int)GRN_TEXT_LEN(&buffer), GRN_TEXT_VALUE(&buffer));
+          GRN_OBJ_FIN(ctx, &buffer);
+        }
+        break;
+      }
+      grn_obj_unlink(ctx, object);
+    }
+  }
+  warm_up_columns(ctx, &column_ids);
+  GRN_OBJ_FIN(ctx, &column_ids);
+  GRN_OUTPUT_BOOL(!ctx->rc);
+  return NULL;
+}
+
 static int
 parse_normalize_flags(grn_ctx *ctx, grn_obj *flag_names)
 {
@@ -4616,7 +5260,7 @@ exit :
 void
 grn_db_init_builtin_query(grn_ctx *ctx)
 {
-  grn_expr_var vars[21];
+  grn_expr_var vars[26];
 
   DEF_VAR(vars[0], "name");
   DEF_VAR(vars[1], "table");
@@ -4640,8 +5284,13 @@ grn_db_init_builtin_query(grn_ctx *ctx)
   DEF_VAR(vars[18], "query_flags");
   DEF_VAR(vars[19], "query_expander");
   DEF_VAR(vars[20], "adjuster");
-  DEF_COMMAND("define_selector", proc_define_selector, 21, vars);
-  DEF_COMMAND("select", proc_select, 20, vars + 1);
+  DEF_VAR(vars[21], "scorer_model");
+  DEF_VAR(vars[22], "bm25_k1");
+  DEF_VAR(vars[23], "bm25_b");
+  DEF_VAR(vars[24], "drilldown_calc_types");
+  DEF_VAR(vars[25], "drilldown_calc_target");
+  DEF_COMMAND("define_selector", proc_define_selector, 26, vars);
+  DEF_COMMAND("select", proc_select, 25, vars + 1);
 
   DEF_VAR(vars[0], "values");
   DEF_VAR(vars[1], "table");
@@ -4719,7 +5368,8 @@ grn_db_init_builtin_query(grn_ctx *ctx)
   DEF_COMMAND("delete", proc_delete, 4, vars);
 
   DEF_VAR(vars[0], "max");
-  DEF_COMMAND("cache_limit", proc_cache_limit, 1, vars);
+  DEF_VAR(vars[1], "max_n_bytes");
+  DEF_COMMAND("cache_limit", proc_cache_limit, 2, vars);
 
   DEF_VAR(vars[0], "tables");
   DEF_COMMAND("dump", proc_dump, 1, vars);
@@ -4744,6 +5394,9 @@ grn_db_init_builtin_query(grn_ctx *ctx)
   DEF_VAR(vars[3], "flags");
   DEF_COMMAND("tokenize", proc_tokenize, 4, vars);
 
+  DEF_VAR(vars[0], "name");
+  DEF_COMMAND("warm_up", proc_warm_up, 1, vars);
+
   DEF_VAR(vars[0], "seed");
   grn_proc_create(ctx, "rand", -1, GRN_PROC_FUNCTION, func_rand,
                   NULL, NULL, 0, vars);
@@ -25,8 +25,12 @@
 extern "C" {
 #endif
 
+#define GRN_SELECT_CONDITION_CACHE_DEFAULT_SIZE 64
+
 GRN_VAR const char *grn_document_root;
+extern int grn_select_condition_cache_size;
 void grn_db_init_builtin_query(grn_ctx *ctx);
+void grn_select_conditions_fin(grn_ctx *ctx);
 
 #ifdef __cplusplus
 }
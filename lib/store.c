@@ -310,6 +310,10 @@ struct grn_ja_header {
 
 grn_bool grn_ja_skip_same_value_put = GRN_TRUE;
 
+static void grn_ja_dictionary_open(grn_ctx *ctx, grn_ja *ja);
+static void grn_ja_dictionary_close(grn_ctx *ctx, grn_ja *ja);
+static grn_rc grn_ja_dictionary_remove(grn_ctx *ctx, const char *path);
+
 static grn_ja *
 _grn_ja_create(grn_ctx *ctx, grn_ja *ja, const char *path,
                unsigned int max_element_size, uint32_t flags)
@@ -328,6 +332,8 @@ _grn_ja_create(grn_ctx *ctx, grn_ja *ja, const char *path,
   for (i = 0; i < JA_N_ESEGMENTS; i++) { header->esegs[i] = JA_ESEG_VOID; }
   ja->io = io;
   ja->header = header;
+  ja->compress_dictionary = NULL;
+  ja->decompress_dictionary = NULL;
   header->max_element_size = max_element_size;
   SEGMENTS_EINFO_ON(ja, 0, 0);
   header->esegs[0] = 0;
@@ -370,6 +376,9 @@ grn_ja_open(grn_ctx *ctx, const char *path)
   GRN_DB_OBJ_SET_TYPE(ja, GRN_COLUMN_VAR_SIZE);
   ja->io = io;
   ja->header = header;
+  ja->compress_dictionary = NULL;
+  ja->decompress_dictionary = NULL;
+  grn_ja_dictionary_open(ctx, ja);
   return ja;
 }
 
@@ -386,6 +395,7 @@ grn_ja_close(grn_ctx *ctx, grn_ja *ja)
 {
   grn_rc rc;
   if (!ja) { return GRN_INVALID_ARGUMENT; }
+  grn_ja_dictionary_close(ctx, ja);
   rc = grn_io_close(ctx, ja->io);
   GRN_GFREE(ja);
   return rc;
@@ -394,8 +404,13 @@ grn_ja_close(grn_ctx *ctx, grn_ja *ja)
 grn_rc
 grn_ja_remove(grn_ctx *ctx, const char *path)
 {
+  grn_rc rc;
   if (!path) { return GRN_INVALID_ARGUMENT; }
-  return grn_io_remove(ctx, path);
+  rc = grn_io_remove(ctx, path);
+  if (rc == GRN_SUCCESS) {
+    rc = grn_ja_dictionary_remove(ctx, path);
+  }
+  return rc;
 }
 
 grn_rc
@@ -433,6 +448,7 @@ grn_ja_ref_raw(grn_ctx *ctx, grn_ja *ja, grn_id id, grn_io_win *iw, uint32_t *va
   uint32_t pseg = ja->header->esegs[id >> JA_W_EINFO_IN_A_SEGMENT];
   iw->size = 0;
   iw->addr = NULL;
+  iw->uncompressed_value = NULL;
   iw->pseg = pseg;
   if (pseg != JA_ESEG_VOID) {
     grn_ja_einfo *einfo = NULL;
@@ -466,6 +482,11 @@ grn_ja_ref_raw(grn_ctx *ctx, grn_ja *ja, grn_id id, grn_io_win *iw, uint32_t *va
 grn_rc
 grn_ja_unref(grn_ctx *ctx, grn_io_win *iw)
 {
+  if (iw->uncompressed_value) {
+    GRN_FREE(iw->uncompressed_value);
+    iw->uncompressed_value = NULL;
+    return GRN_SUCCESS;
+  }
   if (!iw->addr) { return GRN_INVALID_ARGUMENT; }
   GRN_IO_SEG_UNREF(iw->io, iw->pseg);
   if (!iw->tiny_p) { grn_io_win_unmap2(iw); }
@@ -811,7 +832,7 @@ grn_ja_put_raw(grn_ctx *ctx, grn_ja *ja, grn_id id,
     void *old_value;
     grn_bool same_value = GRN_FALSE;
 
-    old_value = grn_ja_ref(ctx, ja, id, &jw, &old_len);
+    old_value = grn_ja_ref_raw(ctx, ja, id, &jw, &old_len);
     if (value_len == old_len && memcmp(value, old_value, value_len) == 0) {
       same_value = GRN_TRUE;
     }
@@ -994,6 +1015,17 @@ grn_ja_putv(grn_ctx *ctx, grn_ja *ja, grn_id id, grn_obj *vector, int flags)
       grn_text_benc(ctx, &footer, vp->domain);
     }
   }
+  if (ja->header->flags & GRN_OBJ_COMPRESS_MASK) {
+    grn_obj *body = vector->u.v.body;
+    if (body) {
+      GRN_TEXT_PUT(ctx, &header, GRN_BULK_HEAD(body), GRN_BULK_VSIZE(body));
+    }
+    GRN_TEXT_PUT(ctx, &header, GRN_BULK_HEAD(&footer), GRN_BULK_VSIZE(&footer));
+    rc = grn_ja_put(ctx, ja, id,
+                    GRN_BULK_HEAD(&header), GRN_BULK_VSIZE(&header),
+                    GRN_OBJ_SET, NULL);
+    goto exit;
+  }
   {
     grn_io_win iw;
     grn_ja_einfo einfo;
@@ -1079,14 +1111,28 @@ grn_ja_element_info(grn_ctx *ctx, grn_ja *ja, grn_id id,
   return GRN_SUCCESS;
 }
 
+#if defined(GRN_WITH_ZLIB) || defined(GRN_WITH_LZO) ||\
+  defined(GRN_WITH_LZ4) || defined(GRN_WITH_ZSTD)
+static void *
+grn_ja_ref_uncompressed(grn_ctx *ctx, grn_io_win *iw,
+                        void *value, uint32_t uncompressed_value_len,
+                        uint32_t *value_len)
+{
+  grn_ja_unref(ctx, iw);
+  iw->addr = NULL;
+  iw->uncompressed_value = value;
+  *value_len = value ? uncompressed_value_len : 0;
+  return value;
+}
+#endif /* defined(GRN_WITH_ZLIB) || defined(GRN_WITH_LZO) ||
+          defined(GRN_WITH_LZ4) || defined(GRN_WITH_ZSTD) */
+
 #ifdef GRN_WITH_ZLIB
 #include <zlib.h>
 
 static void *
 grn_ja_ref_zlib(grn_ctx *ctx, grn_ja *ja, grn_id id, grn_io_win *iw, uint32_t *value_len)
 {
-  /* TODO: This function leaks a memory. The return value
-   * must be freed. */
   z_stream zstream;
   void *value, *zvalue;
   uint32_t zvalue_len;
@@ -1094,34 +1140,33 @@ grn_ja_ref_zlib(grn_ctx *ctx, grn_ja *ja, grn_id id, grn_io_win *iw, uint32_t *v
     *value_len = 0;
     return NULL;
   }
+  if (zvalue_len < sizeof(uint64_t)) {
+    *value_len = zvalue_len;
+    return zvalue;
+  }
   zstream.next_in = (Bytef *)(((uint64_t *)zvalue) + 1);
-  zstream.avail_in = zvalue_len + sizeof(uint64_t);
+  zstream.avail_in = zvalue_len - sizeof(uint64_t);
   zstream.zalloc = Z_NULL;
   zstream.zfree = Z_NULL;
   if (inflateInit2(&zstream, 15 /* windowBits */) != Z_OK) {
-    *value_len = 0;
-    return NULL;
+    return grn_ja_ref_uncompressed(ctx, iw, NULL, 0, value_len);
   }
   if (!(value = GRN_MALLOC(*((uint64_t *)zvalue)))) {
     inflateEnd(&zstream);
-    *value_len = 0;
-    return NULL;
+    return grn_ja_ref_uncompressed(ctx, iw, NULL, 0, value_len);
   }
   zstream.next_out = (Bytef *)value;
   zstream.avail_out = *(uint64_t *)zvalue;
   if (inflate(&zstream, Z_FINISH) != Z_STREAM_END) {
     inflateEnd(&zstream);
     GRN_FREE(value);
-    *value_len = 0;
-    return NULL;
+    return grn_ja_ref_uncompressed(ctx, iw, NULL, 0, value_len);
   }
-  *value_len = zstream.total_out;
   if (inflateEnd(&zstream) != Z_OK) {
     GRN_FREE(value);
-    *value_len = 0;
-    return NULL;
+    return grn_ja_ref_uncompressed(ctx, iw, NULL, 0, value_len);
   }
-  return value;
+  return grn_ja_ref_uncompressed(ctx, iw, value, zstream.total_out, value_len);
 }
 #endif /* GRN_WITH_ZLIB */
 
@@ -1131,8 +1176,6 @@ grn_ja_ref_zlib(grn_ctx *ctx, grn_ja *ja, grn_id id, grn_io_win *iw, uint32_t *v
 static void *
 grn_ja_ref_lzo(grn_ctx *ctx, grn_ja *ja, grn_id id, grn_io_win *iw, uint32_t *value_len)
 {
-  /* TODO: This function leaks a memory. The return value
-   * must be freed. */
   void *value, *lvalue;
   uint32_t lvalue_len;
   lzo_uint lout_len;
@@ -1140,13 +1183,16 @@ grn_ja_ref_lzo(grn_ctx *ctx, grn_ja *ja, grn_id id, grn_io_win *iw, uint32_t *va
     *value_len = 0;
     return NULL;
   }
+  if (lvalue_len < sizeof(uint64_t)) {
+    *value_len = lvalue_len;
+    return lvalue;
+  }
   if (!(value = GRN_MALLOC(*((uint64_t *)lvalue)))) {
-    *value_len = 0;
-    return NULL;
+    return grn_ja_ref_uncompressed(ctx, iw, NULL, 0, value_len);
   }
   lout_len = *((uint64_t *)lvalue);
   switch (lzo1x_decompress((lzo_bytep)(((uint64_t *)lvalue) + 1),
-                           lvalue_len,
+                           lvalue_len - sizeof(uint64_t),
                            (lzo_bytep)(value),
                            &lout_len,
                            NULL)) {
@@ -1155,28 +1201,306 @@ grn_ja_ref_lzo(grn_ctx *ctx, grn_ja *ja, grn_id id, grn_io_win *iw, uint32_t *va
     break;
   default :
     GRN_FREE(value);
+    return grn_ja_ref_uncompressed(ctx, iw, NULL, 0, value_len);
+  }
+  return grn_ja_ref_uncompressed(ctx, iw, value, lout_len, value_len);
+}
+#endif /* GRN_WITH_LZO */
+
+#ifdef GRN_WITH_LZ4
+#include <lz4.h>
+
+static void *
+grn_ja_ref_lz4(grn_ctx *ctx, grn_ja *ja, grn_id id, grn_io_win *iw, uint32_t *value_len)
+{
+  void *value, *lvalue;
+  uint32_t lvalue_len;
+  uint64_t original_value_len;
+  int decompressed_value_len;
+  if (!(lvalue = grn_ja_ref_raw(ctx, ja, id, iw, &lvalue_len))) {
     *value_len = 0;
     return NULL;
   }
-  *value_len = lout_len;
-  return value;
+  if (lvalue_len < sizeof(uint64_t)) {
+    *value_len = lvalue_len;
+    return lvalue;
+  }
+  original_value_len = *((uint64_t *)lvalue);
+  if (!(value = GRN_MALLOC(original_value_len))) {
+    return grn_ja_ref_uncompressed(ctx, iw, NULL, 0, value_len);
+  }
+  decompressed_value_len =
+    LZ4_decompress_safe((const char *)(((uint64_t *)lvalue) + 1),
+                        (char *)value,
+                        lvalue_len - sizeof(uint64_t),
+                        original_value_len);
+  if (decompressed_value_len < 0 ||
+      (uint64_t)decompressed_value_len != original_value_len) {
+    GRN_FREE(value);
+    ERR(GRN_LZ4_ERROR,
+        "[ja][lz4][ref] failed to decompress: <%u>", id);
+    return grn_ja_ref_uncompressed(ctx, iw, NULL, 0, value_len);
+  }
+  return grn_ja_ref_uncompressed(ctx, iw, value, original_value_len,
+                                 value_len);
 }
-#endif /* GRN_WITH_LZO */
+#endif /* GRN_WITH_LZ4 */
+
+#ifdef GRN_WITH_ZSTD
+#include <stdio.h>
+#include <sys/stat.h>
+
+#define GRN_JA_ZSTD_COMPRESSION_LEVEL 3
+#define GRN_JA_ZSTD_DICTIONARY_SUFFIX ".zstd-dictionary"
+
+static ZSTD_CCtx *
+grn_ja_zstd_compress_context_open(grn_ctx *ctx)
+{
+  if (!ctx->impl) {
+    return ZSTD_createCCtx();
+  }
+  if (!ctx->impl->zstd_compress_context) {
+    ctx->impl->zstd_compress_context = ZSTD_createCCtx();
+  }
+  return ctx->impl->zstd_compress_context;
+}
+
+static void
+grn_ja_zstd_compress_context_close(grn_ctx *ctx, ZSTD_CCtx *zstd_context)
+{
+  if (!ctx->impl) {
+    ZSTD_freeCCtx(zstd_context);
+  }
+}
+
+static ZSTD_DCtx *
+grn_ja_zstd_decompress_context_open(grn_ctx *ctx)
+{
+  if (!ctx->impl) {
+    return ZSTD_createDCtx();
+  }
+  if (!ctx->impl->zstd_decompress_context) {
+    ctx->impl->zstd_decompress_context = ZSTD_createDCtx();
+  }
+  return ctx->impl->zstd_decompress_context;
+}
+
+static void
+grn_ja_zstd_decompress_context_close(grn_ctx *ctx, ZSTD_DCtx *zstd_context)
+{
+  if (!ctx->impl) {
+    ZSTD_freeDCtx(zstd_context);
+  }
+}
+
+static void *
+grn_ja_ref_zstd(grn_ctx *ctx, grn_ja *ja, grn_id id, grn_io_win *iw, uint32_t *value_len)
+{
+  ZSTD_DCtx *zstd_context;
+  ZSTD_DDict *zstd_dictionary = ja->decompress_dictionary;
+  void *value, *zvalue, *zbody;
+  uint32_t zvalue_len, zbody_len;
+  uint64_t original_value_len;
+  unsigned int dictionary_id;
+  size_t decompressed_value_len;
+  if (!(zvalue = grn_ja_ref_raw(ctx, ja, id, iw, &zvalue_len))) {
+    *value_len = 0;
+    return NULL;
+  }
+  if (zvalue_len < sizeof(uint64_t)) {
+    *value_len = zvalue_len;
+    return zvalue;
+  }
+  original_value_len = *((uint64_t *)zvalue);
+  zbody = ((uint64_t *)zvalue) + 1;
+  zbody_len = zvalue_len - sizeof(uint64_t);
+  dictionary_id = ZSTD_getDictID_fromFrame(zbody, zbody_len);
+  if (zstd_dictionary && ZSTD_getDictID_fromDDict(zstd_dictionary) != 0) {
+    /* Values stored before the dictionary was placed don't refer it. */
+    if (dictionary_id == 0) {
+      zstd_dictionary = NULL;
+    } else if (dictionary_id != ZSTD_getDictID_fromDDict(zstd_dictionary)) {
+      ERR(GRN_ZSTD_ERROR,
+          "[ja][zstd][ref] dictionary ID is mismatched: <%u>: <%u> != <%u>",
+          id, dictionary_id, ZSTD_getDictID_fromDDict(zstd_dictionary));
+      return grn_ja_ref_uncompressed(ctx, iw, NULL, 0, value_len);
+    }
+  } else if (!zstd_dictionary && dictionary_id != 0) {
+    ERR(GRN_ZSTD_ERROR,
+        "[ja][zstd][ref] dictionary is missing: <%u>: <%u>",
+        id, dictionary_id);
+    return grn_ja_ref_uncompressed(ctx, iw, NULL, 0, value_len);
+  }
+  if (!(zstd_context = grn_ja_zstd_decompress_context_open(ctx))) {
+    ERR(GRN_ZSTD_ERROR,
+        "[ja][zstd][ref] failed to create decompression context");
+    return grn_ja_ref_uncompressed(ctx, iw, NULL, 0, value_len);
+  }
+  if (!(value = GRN_MALLOC(original_value_len))) {
+    grn_ja_zstd_decompress_context_close(ctx, zstd_context);
+    return grn_ja_ref_uncompressed(ctx, iw, NULL, 0, value_len);
+  }
+  if (zstd_dictionary) {
+    decompressed_value_len =
+      ZSTD_decompress_usingDDict(zstd_context,
+                                 value, original_value_len,
+                                 zbody, zbody_len,
+                                 zstd_dictionary);
+  } else {
+    decompressed_value_len =
+      ZSTD_decompressDCtx(zstd_context,
+                          value, original_value_len,
+                          zbody, zbody_len);
+  }
+  grn_ja_zstd_decompress_context_close(ctx, zstd_context);
+  if (ZSTD_isError(decompressed_value_len) ||
+      decompressed_value_len != original_value_len) {
+    GRN_FREE(value);
+    ERR(GRN_ZSTD_ERROR,
+        "[ja][zstd][ref] failed to decompress: <%u>: <%s>",
+        id,
+        ZSTD_isError(decompressed_value_len) ?
+        ZSTD_getErrorName(decompressed_value_len) : "size mismatch");
+    return grn_ja_ref_uncompressed(ctx, iw, NULL, 0, value_len);
+  }
+  return grn_ja_ref_uncompressed(ctx, iw, value, original_value_len,
+                                 value_len);
+}
+
+static void
+grn_ja_dictionary_path(const char *path, char *buffer)
+{
+  strcpy(buffer, path);
+  strcat(buffer, GRN_JA_ZSTD_DICTIONARY_SUFFIX);
+}
+
+static void
+grn_ja_dictionary_open(grn_ctx *ctx, grn_ja *ja)
+{
+  const char *path;
+  char dictionary_path[PATH_MAX];
+  FILE *file;
+  long dictionary_size;
+  void *dictionary;
+
+  if ((ja->header->flags & GRN_OBJ_COMPRESS_MASK) != GRN_OBJ_COMPRESS_ZSTD) {
+    return;
+  }
+  path = grn_io_path(ja->io);
+  if (!path || path[0] == '\0') {
+    return;
+  }
+  grn_ja_dictionary_path(path, dictionary_path);
+  if (!(file = fopen(dictionary_path, "rb"))) {
+    return;
+  }
+  if (fseek(file, 0, SEEK_END) != 0 ||
+      (dictionary_size = ftell(file)) <= 0 ||
+      fseek(file, 0, SEEK_SET) != 0) {
+    fclose(file);
+    ERR(GRN_ZSTD_ERROR,
+        "[ja][zstd][dictionary] failed to get size: <%s>", dictionary_path);
+    return;
+  }
+  if (!(dictionary = GRN_MALLOC(dictionary_size))) {
+    fclose(file);
+    return;
+  }
+  if (fread(dictionary, 1, dictionary_size, file) != (size_t)dictionary_size) {
+    GRN_FREE(dictionary);
+    fclose(file);
+    ERR(GRN_ZSTD_ERROR,
+        "[ja][zstd][dictionary] failed to read: <%s>", dictionary_path);
+    return;
+  }
+  fclose(file);
+  ja->compress_dictionary =
+    ZSTD_createCDict(dictionary, dictionary_size,
+                     GRN_JA_ZSTD_COMPRESSION_LEVEL);
+  ja->decompress_dictionary =
+    ZSTD_createDDict(dictionary, dictionary_size);
+  GRN_FREE(dictionary);
+  if (!ja->compress_dictionary || !ja->decompress_dictionary) {
+    grn_ja_dictionary_close(ctx, ja);
+    ERR(GRN_ZSTD_ERROR,
+        "[ja][zstd][dictionary] failed to load: <%s>", dictionary_path);
+    return;
+  }
+  GRN_LOG(ctx, GRN_LOG_INFO,
+          "[ja][zstd][dictionary] loaded: <%s>: <%u>",
+          dictionary_path,
+          ZSTD_getDictID_fromDDict(ja->decompress_dictionary));
+}
+
+static void
+grn_ja_dictionary_close(grn_ctx *ctx, grn_ja *ja)
+{
+  if (ja->compress_dictionary) {
+    ZSTD_freeCDict(ja->compress_dictionary);
+    ja->compress_dictionary = NULL;
+  }
+  if (ja->decompress_dictionary) {
+    ZSTD_freeDDict(ja->decompress_dictionary);
+    ja->decompress_dictionary = NULL;
+  }
+}
+
+static grn_rc
+grn_ja_dictionary_remove(grn_ctx *ctx, const char *path)
+{
+  char dictionary_path[PATH_MAX];
+  struct stat s;
+  grn_ja_dictionary_path(path, dictionary_path);
+  if (stat(dictionary_path, &s) != 0) {
+    return GRN_SUCCESS;
+  }
+  if (unlink(dictionary_path) != 0) {
+    SERR(dictionary_path);
+    return ctx->rc;
+  }
+  return GRN_SUCCESS;
+}
+#else /* GRN_WITH_ZSTD */
+static void
+grn_ja_dictionary_open(grn_ctx *ctx, grn_ja *ja)
+{
+}
+
+static void
+grn_ja_dictionary_close(grn_ctx *ctx, grn_ja *ja)
+{
+}
+
+static grn_rc
+grn_ja_dictionary_remove(grn_ctx *ctx, const char *path)
+{
+  return GRN_SUCCESS;
+}
+#endif /* GRN_WITH_ZSTD */
 
 void *
 grn_ja_ref(grn_ctx *ctx, grn_ja *ja, grn_id id, grn_io_win *iw, uint32_t *value_len)
 {
+  switch (ja->header->flags & GRN_OBJ_COMPRESS_MASK) {
 #ifdef GRN_WITH_ZLIB
-  if (ja->header->flags & GRN_OBJ_COMPRESS_ZLIB) {
+  case GRN_OBJ_COMPRESS_ZLIB :
     return grn_ja_ref_zlib(ctx, ja, id, iw, value_len);
-  }
 #endif /* GRN_WITH_ZLIB */
 #ifdef GRN_WITH_LZO
-  if (ja->header->flags & GRN_OBJ_COMPRESS_LZO) {
+  case GRN_OBJ_COMPRESS_LZO :
     return grn_ja_ref_lzo(ctx, ja, id, iw, value_len);
-  }
 #endif /* GRN_WITH_LZO */
-  return grn_ja_ref_raw(ctx, ja, id, iw, value_len);
+#ifdef GRN_WITH_LZ4
+  case GRN_OBJ_COMPRESS_LZ4 :
+    return grn_ja_ref_lz4(ctx, ja, id, iw, value_len);
+#endif /* GRN_WITH_LZ4 */
+#ifdef GRN_WITH_ZSTD
+  case GRN_OBJ_COMPRESS_ZSTD :
+    return grn_ja_ref_zstd(ctx, ja, id, iw, value_len);
+#endif /* GRN_WITH_ZSTD */
+  default :
+    return grn_ja_ref_raw(ctx, ja, id, iw, value_len);
+  }
 }
 
 grn_obj *
@@ -1286,21 +1610,119 @@ grn_ja_put_lzo(grn_ctx *ctx, grn_ja *ja, grn_id id,
 }
 #endif /* GRN_WITH_LZO */
 
+#ifdef GRN_WITH_LZ4
+inline static grn_rc
+grn_ja_put_lz4(grn_ctx *ctx, grn_ja *ja, grn_id id,
+               void *value, uint32_t value_len, int flags, uint64_t *cas)
+{
+  grn_rc rc;
+  void *lvalue;
+  int lvalue_size;
+  int lvalue_len;
+
+  if (value_len == 0) {
+    return grn_ja_put_raw(ctx, ja, id, value, value_len, flags, cas);
+  }
+
+  if (value_len > (uint32_t)LZ4_MAX_INPUT_SIZE) {
+    ERR(GRN_LZ4_ERROR,
+        "[ja][lz4][put] too large value: <%u>: <%u> > <%u>",
+        id, value_len, (uint32_t)LZ4_MAX_INPUT_SIZE);
+    return ctx->rc;
+  }
+  lvalue_size = LZ4_compressBound(value_len);
+  if (!(lvalue = GRN_MALLOC(lvalue_size + sizeof(uint64_t)))) { return GRN_NO_MEMORY_AVAILABLE; }
+  lvalue_len = LZ4_compress_default((const char *)value,
+                                    (char *)((uint64_t *)lvalue + 1),
+                                    value_len,
+                                    lvalue_size);
+  if (lvalue_len <= 0) {
+    GRN_FREE(lvalue);
+    ERR(GRN_LZ4_ERROR, "[ja][lz4][put] failed to compress: <%u>", id);
+    return ctx->rc;
+  }
+  *(uint64_t *)lvalue = value_len;
+  rc = grn_ja_put_raw(ctx, ja, id, lvalue, lvalue_len + sizeof(uint64_t), flags, cas);
+  GRN_FREE(lvalue);
+  return rc;
+}
+#endif /* GRN_WITH_LZ4 */
+
+#ifdef GRN_WITH_ZSTD
+inline static grn_rc
+grn_ja_put_zstd(grn_ctx *ctx, grn_ja *ja, grn_id id,
+                void *value, uint32_t value_len, int flags, uint64_t *cas)
+{
+  grn_rc rc;
+  ZSTD_CCtx *zstd_context;
+  void *zvalue;
+  size_t zvalue_size;
+  size_t zvalue_len;
+
+  if (value_len == 0) {
+    return grn_ja_put_raw(ctx, ja, id, value, value_len, flags, cas);
+  }
+
+  if (!(zstd_context = grn_ja_zstd_compress_context_open(ctx))) {
+    ERR(GRN_ZSTD_ERROR,
+        "[ja][zstd][put] failed to create compression context");
+    return ctx->rc;
+  }
+  zvalue_size = ZSTD_compressBound(value_len);
+  if (!(zvalue = GRN_MALLOC(zvalue_size + sizeof(uint64_t)))) {
+    grn_ja_zstd_compress_context_close(ctx, zstd_context);
+    return GRN_NO_MEMORY_AVAILABLE;
+  }
+  if (ja->compress_dictionary) {
+    zvalue_len = ZSTD_compress_usingCDict(zstd_context,
+                                          (uint64_t *)zvalue + 1, zvalue_size,
+                                          value, value_len,
+                                          ja->compress_dictionary);
+  } else {
+    zvalue_len = ZSTD_compressCCtx(zstd_context,
+                                   (uint64_t *)zvalue + 1, zvalue_size,
+                                   value, value_len,
+                                   GRN_JA_ZSTD_COMPRESSION_LEVEL);
+  }
+  grn_ja_zstd_compress_context_close(ctx, zstd_context);
+  if (ZSTD_isError(zvalue_len)) {
+    GRN_FREE(zvalue);
+    ERR(GRN_ZSTD_ERROR,
+        "[ja][zstd][put] failed to compress: <%u>: <%s>",
+        id, ZSTD_getErrorName(zvalue_len));
+    return ctx->rc;
+  }
+  *(uint64_t *)zvalue = value_len;
+  rc = grn_ja_put_raw(ctx, ja, id, zvalue, zvalue_len + sizeof(uint64_t), flags, cas);
+  GRN_FREE(zvalue);
+  return rc;
+}
+#endif /* GRN_WITH_ZSTD */
+
 grn_rc
 grn_ja_put(grn_ctx *ctx, grn_ja *ja, grn_id id, void *value, uint32_t value_len,
            int flags, uint64_t *cas)
 {
+  switch (ja->header->flags & GRN_OBJ_COMPRESS_MASK) {
 #ifdef GRN_WITH_ZLIB
-  if (ja->header->flags & GRN_OBJ_COMPRESS_ZLIB) {
+  case GRN_OBJ_COMPRESS_ZLIB :
     return grn_ja_put_zlib(ctx, ja, id, value, value_len, flags, cas);
-  }
 #endif /* GRN_WITH_ZLIB */
 #ifdef GRN_WITH_LZO
-  if (ja->header->flags & GRN_OBJ_COMPRESS_LZO) {
+  case GRN_OBJ_COMPRESS_LZO :
     return grn_ja_put_lzo(ctx, ja, id, value, value_len, flags, cas);
-  }
 #endif /* GRN_WITH_LZO */
-  return grn_ja_put_raw(ctx, ja, id, value, value_len, flags, cas);
+#ifdef GRN_WITH_LZ4
+  case GRN_OBJ_COMPRESS_LZ4 :
+    return grn_ja_put_lz4(ctx, ja, id, value, value_len, flags, cas);
+#endif /* GRN_WITH_LZ4 */
+#ifdef GRN_WITH_ZSTD
+  case GRN_OBJ_COMPRESS_ZSTD :
+    return grn_ja_put_zstd(ctx, ja, id, value, value_len, flags, cas);
+#endif /* GRN_WITH_ZSTD */
+  default :
+    return grn_ja_put_raw(ctx, ja, id, value, value_len, flags, cas);
+  }
 }
 
 static grn_rc
@@ -90,6 +90,8 @@ struct _grn_ja {
   grn_db_obj obj;
   grn_io *io;
   struct grn_ja_header *header;
+  void *compress_dictionary;
+  void *decompress_dictionary;
 };
 
 GRN_API grn_ja *grn_ja_create(grn_ctx *ctx, const char *path,
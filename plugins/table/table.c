@@ -259,7 +259,7 @@ command_group(grn_ctx *ctx, int nargs, grn_obj **args,
         } else {
           grn_table_group_result g = {
             set_, 0, 0, 1,
-            GRN_TABLE_GROUP_CALC_COUNT, 0
+            GRN_TABLE_GROUP_CALC_COUNT, 0, NULL
           };
           grn_table_group(ctx, table_, gkeys, 1, &g, 1);
         }
@@ -395,7 +395,7 @@ command_add(grn_ctx *ctx, int nargs, grn_obj **args, grn_user_data *user_data)
             NULL, 0, NULL, 0, 0);
   GRN_OUTPUT_BOOL(ctx->impl->loader.nrecords);
   if (ctx->impl->loader.table) {
-    grn_db_touch(ctx, DB_OBJ(ctx->impl->loader.table)->db);
+    grn_table_touch_related_tables(ctx, ctx->impl->loader.table);
   }
   return NULL;
 }
@@ -587,7 +587,7 @@ command_push(grn_ctx *ctx, int nargs, grn_obj **args, grn_user_data *user_data)
           MUTEX_UNLOCK(queue->mutex);
           GRN_OUTPUT_BOOL(ctx->impl->loader.nrecords);
           if (ctx->impl->loader.table) {
-            grn_db_touch(ctx, DB_OBJ(ctx->impl->loader.table)->db);
+            grn_table_touch_related_tables(ctx, ctx->impl->loader.table);
           }
         } else {
           ERR(GRN_OPERATION_NOT_SUPPORTED, "table '%.*s' doesn't support push",
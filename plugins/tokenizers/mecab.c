@@ -23,14 +23,32 @@
 #include <mecab.h>
 
 #include <string.h>
+#include <stdlib.h>
 #include <ctype.h>
 
+#define GRN_MECAB_POOL_DEFAULT_SIZE 16
+
+#ifdef HAVE_MECAB_MODEL_NEW2
+/*
+  Taggers are created from one shared model, so the dictionary is loaded
+  only once. `n_users' is changed only by GRN_ATOMIC_ADD_EX(). A tagger
+  is checked out by the thread that changes `n_users' from 0 to 1.
+*/
+typedef struct {
+  mecab_t *mecab;
+  uint32_t n_users;
+} grn_mecab_pool_entry;
+
+static mecab_model_t *sole_mecab_model = NULL;
+static grn_mecab_pool_entry *mecab_pool = NULL;
+static uint32_t mecab_pool_size = 0;
+#else /* HAVE_MECAB_MODEL_NEW2 */
 static mecab_t *sole_mecab = NULL;
+#endif /* HAVE_MECAB_MODEL_NEW2 */
 static grn_plugin_mutex *sole_mecab_mutex = NULL;
 static grn_encoding sole_mecab_encoding = GRN_ENC_NONE;
 
 typedef struct {
-  mecab_t *mecab;
   grn_obj buf;
   const char *next;
   const char *end;
@@ -67,6 +85,123 @@ get_mecab_encoding(mecab_t *mecab)
   return encoding;
 }
 
+static grn_bool
+mecab_ready(grn_ctx *ctx)
+{
+#ifdef HAVE_MECAB_MODEL_NEW2
+  if (!sole_mecab_model) {
+    grn_plugin_mutex_lock(ctx, sole_mecab_mutex);
+    if (!sole_mecab_model) {
+      mecab_model_t *model;
+      model = mecab_model_new2("-Owakati");
+      if (!model) {
+        GRN_PLUGIN_ERROR(ctx, GRN_TOKENIZER_ERROR,
+                         "[tokenizer][mecab] "
+                         "mecab_model_new2() failed on mecab_init(): %s",
+                         mecab_strerror(NULL));
+      } else {
+        mecab_t *mecab;
+        mecab = mecab_model_new_tagger(model);
+        if (!mecab) {
+          GRN_PLUGIN_ERROR(ctx, GRN_TOKENIZER_ERROR,
+                           "[tokenizer][mecab] "
+                           "mecab_model_new_tagger() failed on mecab_init(): "
+                           "%s",
+                           mecab_strerror(NULL));
+          mecab_model_destroy(model);
+        } else {
+          sole_mecab_encoding = get_mecab_encoding(mecab);
+          mecab_pool[0].mecab = mecab;
+          sole_mecab_model = model;
+        }
+      }
+    }
+    grn_plugin_mutex_unlock(ctx, sole_mecab_mutex);
+  }
+  return sole_mecab_model != NULL;
+#else /* HAVE_MECAB_MODEL_NEW2 */
+  if (!sole_mecab) {
+    grn_plugin_mutex_lock(ctx, sole_mecab_mutex);
+    if (!sole_mecab) {
+      sole_mecab = mecab_new2("-Owakati");
+      if (!sole_mecab) {
+        GRN_PLUGIN_ERROR(ctx, GRN_TOKENIZER_ERROR,
+                         "[tokenizer][mecab] "
+                         "mecab_new2() failed on mecab_init(): %s",
+                         mecab_strerror(NULL));
+      } else {
+        sole_mecab_encoding = get_mecab_encoding(sole_mecab);
+      }
+    }
+    grn_plugin_mutex_unlock(ctx, sole_mecab_mutex);
+  }
+  return sole_mecab != NULL;
+#endif /* HAVE_MECAB_MODEL_NEW2 */
+}
+
+/*
+  This function returns a tagger that isn't used by other threads. It
+  must be returned by mecab_checkin(). `entry' is set to NULL when all
+  pooled taggers are in use. A temporary tagger is returned in the case.
+  Without mecab_model_t, this function locks the sole tagger instead.
+ */
+static mecab_t *
+mecab_checkout(grn_ctx *ctx, void **entry)
+{
+#ifdef HAVE_MECAB_MODEL_NEW2
+  uint32_t i;
+  mecab_t *mecab;
+
+  for (i = 0; i < mecab_pool_size; i++) {
+    grn_mecab_pool_entry *pool_entry = &(mecab_pool[i]);
+    uint32_t n_users;
+    GRN_ATOMIC_ADD_EX(&(pool_entry->n_users), 1, n_users);
+    if (n_users == 0) {
+      if (!pool_entry->mecab) {
+        pool_entry->mecab = mecab_model_new_tagger(sole_mecab_model);
+        if (!pool_entry->mecab) {
+          GRN_ATOMIC_ADD_EX(&(pool_entry->n_users), -1, n_users);
+          break;
+        }
+      }
+      *entry = pool_entry;
+      return pool_entry->mecab;
+    }
+    GRN_ATOMIC_ADD_EX(&(pool_entry->n_users), -1, n_users);
+  }
+
+  *entry = NULL;
+  mecab = mecab_model_new_tagger(sole_mecab_model);
+  if (!mecab) {
+    GRN_PLUGIN_ERROR(ctx, GRN_TOKENIZER_ERROR,
+                     "[tokenizer][mecab] "
+                     "mecab_model_new_tagger() failed on mecab_init(): %s",
+                     mecab_strerror(NULL));
+  }
+  return mecab;
+#else /* HAVE_MECAB_MODEL_NEW2 */
+  *entry = NULL;
+  grn_plugin_mutex_lock(ctx, sole_mecab_mutex);
+  return sole_mecab;
+#endif /* HAVE_MECAB_MODEL_NEW2 */
+}
+
+static void
+mecab_checkin(grn_ctx *ctx, mecab_t *mecab, void *entry)
+{
+#ifdef HAVE_MECAB_MODEL_NEW2
+  if (entry) {
+    grn_mecab_pool_entry *pool_entry = entry;
+    uint32_t n_users;
+    GRN_ATOMIC_ADD_EX(&(pool_entry->n_users), -1, n_users);
+  } else {
+    mecab_destroy(mecab);
+  }
+#else /* HAVE_MECAB_MODEL_NEW2 */
+  grn_plugin_mutex_unlock(ctx, sole_mecab_mutex);
+#endif /* HAVE_MECAB_MODEL_NEW2 */
+}
+
 /*
   This function is called for a full text search query or a document to be
   indexed. This means that both short/long strings are given.
@@ -88,22 +223,7 @@ mecab_init(grn_ctx *ctx, int nargs, grn_obj **args, grn_user_data *user_data)
   if (!query) {
     return NULL;
   }
-  if (!sole_mecab) {
-    grn_plugin_mutex_lock(ctx, sole_mecab_mutex);
-    if (!sole_mecab) {
-      sole_mecab = mecab_new2("-Owakati");
-      if (!sole_mecab) {
-        GRN_PLUGIN_ERROR(ctx, GRN_TOKENIZER_ERROR,
-                         "[tokenizer][mecab] "
-                         "mecab_new2() failed on mecab_init(): %s",
-                         mecab_strerror(NULL));
-      } else {
-        sole_mecab_encoding = get_mecab_encoding(sole_mecab);
-      }
-    }
-    grn_plugin_mutex_unlock(ctx, sole_mecab_mutex);
-  }
-  if (!sole_mecab) {
+  if (!mecab_ready(ctx)) {
     grn_tokenizer_query_close(ctx, query);
     return NULL;
   }
@@ -126,7 +246,6 @@ mecab_init(grn_ctx *ctx, int nargs, grn_obj **args, grn_user_data *user_data)
                      "memory allocation to grn_mecab_tokenizer failed");
     return NULL;
   }
-  tokenizer->mecab = sole_mecab;
   tokenizer->query = query;
 
   normalized_query = query->normalized_query;
@@ -143,20 +262,26 @@ mecab_init(grn_ctx *ctx, int nargs, grn_obj **args, grn_user_data *user_data)
     tokenizer->next = "";
     tokenizer->end = tokenizer->next;
   } else {
-    grn_plugin_mutex_lock(ctx, sole_mecab_mutex);
-    s = mecab_sparse_tostr2(tokenizer->mecab,
-                            normalized_string,
-                            normalized_string_length);
-    if (!s) {
-      GRN_PLUGIN_ERROR(ctx, GRN_TOKENIZER_ERROR,
-                       "[tokenizer][mecab] "
-                       "mecab_sparse_tostr() failed len=%d err=%s",
-                       normalized_string_length,
-                       mecab_strerror(tokenizer->mecab));
+    mecab_t *mecab;
+    void *pool_entry;
+    mecab = mecab_checkout(ctx, &pool_entry);
+    if (!mecab) {
+      s = NULL;
     } else {
-      GRN_TEXT_PUTS(ctx, &(tokenizer->buf), s);
+      s = mecab_sparse_tostr2(mecab,
+                              normalized_string,
+                              normalized_string_length);
+      if (!s) {
+        GRN_PLUGIN_ERROR(ctx, GRN_TOKENIZER_ERROR,
+                         "[tokenizer][mecab] "
+                         "mecab_sparse_tostr() failed len=%d err=%s",
+                         normalized_string_length,
+                         mecab_strerror(mecab));
+      } else {
+        GRN_TEXT_PUTS(ctx, &(tokenizer->buf), s);
+      }
+      mecab_checkin(ctx, mecab, pool_entry);
     }
-    grn_plugin_mutex_unlock(ctx, sole_mecab_mutex);
     if (!s) {
       grn_tokenizer_query_close(ctx, tokenizer->query);
       GRN_PLUGIN_FREE(ctx, tokenizer);
@@ -285,7 +410,34 @@ check_mecab_dictionary_encoding(grn_ctx *ctx)
 grn_rc
 GRN_PLUGIN_INIT(grn_ctx *ctx)
 {
+#ifdef HAVE_MECAB_MODEL_NEW2
+  {
+    const char *pool_size_env;
+    int pool_size = GRN_MECAB_POOL_DEFAULT_SIZE;
+
+    pool_size_env = getenv("GRN_MECAB_POOL_SIZE");
+    if (pool_size_env) {
+      pool_size = atoi(pool_size_env);
+      if (pool_size < 1) {
+        pool_size = 1;
+      }
+    }
+    sole_mecab_model = NULL;
+    mecab_pool = GRN_PLUGIN_MALLOC(ctx,
+                                   sizeof(grn_mecab_pool_entry) * pool_size);
+    if (!mecab_pool) {
+      GRN_PLUGIN_ERROR(ctx, GRN_NO_MEMORY_AVAILABLE,
+                       "[tokenizer][mecab] "
+                       "failed to allocate MeCab pool: <%d>",
+                       pool_size);
+      return ctx->rc;
+    }
+    memset(mecab_pool, 0, sizeof(grn_mecab_pool_entry) * pool_size);
+    mecab_pool_size = pool_size;
+  }
+#else /* HAVE_MECAB_MODEL_NEW2 */
   sole_mecab = NULL;
+#endif /* HAVE_MECAB_MODEL_NEW2 */
   sole_mecab_mutex = grn_plugin_mutex_open(ctx);
   if (!sole_mecab_mutex) {
     GRN_PLUGIN_ERROR(ctx, GRN_NO_MEMORY_AVAILABLE,
@@ -325,10 +477,28 @@ GRN_PLUGIN_REGISTER(grn_ctx *ctx)
 grn_rc
 GRN_PLUGIN_FIN(grn_ctx *ctx)
 {
+#ifdef HAVE_MECAB_MODEL_NEW2
+  if (mecab_pool) {
+    uint32_t i;
+    for (i = 0; i < mecab_pool_size; i++) {
+      if (mecab_pool[i].mecab) {
+        mecab_destroy(mecab_pool[i].mecab);
+      }
+    }
+    GRN_PLUGIN_FREE(ctx, mecab_pool);
+    mecab_pool = NULL;
+    mecab_pool_size = 0;
+  }
+  if (sole_mecab_model) {
+    mecab_model_destroy(sole_mecab_model);
+    sole_mecab_model = NULL;
+  }
+#else /* HAVE_MECAB_MODEL_NEW2 */
   if (sole_mecab) {
     mecab_destroy(sole_mecab);
     sole_mecab = NULL;
   }
+#endif /* HAVE_MECAB_MODEL_NEW2 */
   if (sole_mecab_mutex) {
     grn_plugin_mutex_close(ctx, sole_mecab_mutex);
     sole_mecab_mutex = NULL;
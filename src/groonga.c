@@ -68,6 +68,7 @@
 #define DEFAULT_PORT 10041
 #define DEFAULT_DEST "localhost"
 #define DEFAULT_MAX_NFTHREADS 8
+#define DEFAULT_KEEP_ALIVE_TIMEOUT 60
 #define MAX_CON 0x10000
 
 #define RLIMIT_NOFILE_MINIMUM 4096
@@ -85,6 +86,9 @@ static int (*do_server)(char *path);
 static const char *pid_file_path = NULL;
 static const char *input_path = NULL;
 static FILE *output = NULL;
+static uint32_t keep_alive_timeout = DEFAULT_KEEP_ALIVE_TIMEOUT;
+/* 0 means that idle connections are never closed by the server. */
+static uint32_t idle_connection_timeout = 0;
 
 static int ready_notify_pipe[2];
 #define PIPE_READ  0
@@ -528,11 +532,36 @@ clean_pid_file(void)
 #endif
 }
 
+static void
+close_idle_connections(grn_ctx *ctx, grn_com_event *ev)
+{
+  grn_timeval now;
+  grn_com *com;
+  uint32_t n_closed = 0;
+  grn_timeval_now(ctx, &now);
+  /* Connections owned by workers aren't watched and are skipped. */
+  GRN_HASH_EACH(ctx, ev->hash, id, NULL, NULL, &com, {
+    if (com != ev->acceptor && com->events == GRN_COM_POLLIN &&
+        now.tv_sec - com->last_active >= idle_connection_timeout) {
+      GRN_LOG(ctx, GRN_LOG_INFO, "close idle connection: <%d>", com->fd);
+      grn_com_close(ctx, com);
+      n_closed++;
+    }
+  });
+  if (n_closed > 0) {
+    /* Accepting may have been stopped because fds ran out. */
+    grn_com_event_start_accept(ctx, ev);
+  }
+}
+
 static void
 run_server_loop(grn_ctx *ctx, grn_com_event *ev)
 {
   while (!grn_com_event_poll(ctx, ev, 1000) && grn_gctx.stat != GRN_CTX_QUIT) {
     grn_edge *edge;
+    if (idle_connection_timeout) {
+      close_idle_connections(ctx, ev);
+    }
     while ((edge = (grn_edge *)grn_com_queue_deque(ctx, &ctx_old))) {
       grn_obj *msg;
       while ((msg = (grn_obj *)grn_com_queue_deque(ctx, &edge->send_old))) {
@@ -645,6 +674,7 @@ start_service(grn_ctx *ctx, const char *db_path,
 
 typedef struct {
   grn_msg *msg;
+  grn_bool keep_alive;
 } ht_context;
 
 static void
@@ -673,7 +703,11 @@ h_output(grn_ctx *ctx, int flags, void *arg)
     GRN_TEXT_SETS(ctx, &header, "HTTP/1.1 500 Internal Server Error\r\n");
     break;
   }
-  GRN_TEXT_PUTS(ctx, &header, "Connection: close\r\n");
+  if (hc->keep_alive) {
+    GRN_TEXT_PUTS(ctx, &header, "Connection: keep-alive\r\n");
+  } else {
+    GRN_TEXT_PUTS(ctx, &header, "Connection: close\r\n");
+  }
   GRN_TEXT_PUTS(ctx, &header, "Content-Type: ");
   GRN_TEXT_PUTS(ctx, &header, grn_ctx_get_mime_type(ctx));
   GRN_TEXT_PUTS(ctx, &header, "\r\nContent-Length: ");
@@ -731,10 +765,69 @@ h_output(grn_ctx *ctx, int flags, void *arg)
   GRN_OBJ_FIN(ctx, &header);
 }
 
+static grn_bool
+h_token_equal(const char *token, const char *token_end, const char *name)
+{
+  for (; token < token_end; token++, name++) {
+    if (!*name || tolower((unsigned char)*token) != *name) {
+      return GRN_FALSE;
+    }
+  }
+  return !*name;
+}
+
+/*
+ * HTTP/1.1 connections are persistent unless the client sends
+ * "Connection: close". HTTP/1.0 connections are persistent only when
+ * the client sends "Connection: keep-alive".
+ */
+static grn_bool
+h_keep_alive_p(const char *headers, const char *headers_end,
+               grn_bool http_1_1)
+{
+  grn_bool keep_alive = http_1_1;
+  const char *p = headers;
+  while (p < headers_end) {
+    const char *line_end = p;
+    const char *name_end;
+    while (line_end < headers_end && *line_end != '\r' && *line_end != '\n') {
+      line_end++;
+    }
+    for (name_end = p; name_end < line_end && *name_end != ':'; name_end++) {}
+    if (name_end < line_end && h_token_equal(p, name_end, "connection")) {
+      const char *token = name_end + 1;
+      while (token < line_end) {
+        const char *token_end;
+        while (token < line_end && (*token == ' ' || *token == '\t' ||
+                                    *token == ',')) {
+          token++;
+        }
+        for (token_end = token;
+             token_end < line_end && *token_end != ' ' &&
+               *token_end != '\t' && *token_end != ',';
+             token_end++) {}
+        if (h_token_equal(token, token_end, "close")) {
+          keep_alive = GRN_FALSE;
+        } else if (h_token_equal(token, token_end, "keep-alive")) {
+          keep_alive = GRN_TRUE;
+        }
+        token = token_end;
+      }
+    }
+    p = line_end;
+    while (p < headers_end && (*p == '\r' || *p == '\n')) {
+      p++;
+    }
+  }
+  return keep_alive;
+}
+
 static void
-do_htreq(grn_ctx *ctx, grn_msg *msg)
+do_htreq(grn_ctx *ctx, ht_context *hc)
 {
+  grn_msg *msg = hc->msg;
   grn_sock fd = msg->u.fd;
+  grn_com_event *ev = msg->acceptor->ev;
   grn_http_request_type t = grn_http_request_type_none;
   grn_com_header *header = &msg->header;
   switch (header->qtype) {
@@ -764,18 +857,24 @@ do_htreq(grn_ctx *ctx, grn_msg *msg)
         }
       }
     }
+    /* The rest of a POST body isn't consumed. It can't be reused. */
+    if (t == grn_http_request_type_get) {
+      grn_bool http_1_1 = (pathe + 9 <= e && !memcmp(pathe + 7, ".1", 2));
+      hc->keep_alive = h_keep_alive_p(pathe, e, http_1_1);
+    }
     grn_ctx_send(ctx, path, pathe - path, 0);
   }
 exit :
-  /* TODO: support "Connection: keep-alive" */
   ctx->stat = GRN_CTX_QUIT;
   /* TODO: support a command in multi requests. e.g.: load command */
   grn_ctx_set_next_expr(ctx, NULL);
   /* if (ctx->rc != GRN_OPERATION_WOULD_BLOCK) {...} */
   grn_msg_close(ctx, (grn_obj *)msg);
-  /* if not keep alive connection */
-  grn_sock_close(fd);
-  grn_com_event_start_accept(ctx, msg->acceptor->ev);
+  if (!hc->keep_alive) {
+    /* The event loop closes the connection when it sees EOF. */
+    shutdown(fd, SHUT_RDWR);
+  }
+  grn_com_event_mod(ctx, ev, fd, GRN_COM_POLLIN, NULL);
 }
 
 enum {
@@ -1385,7 +1484,8 @@ h_worker(void *arg)
     nfthreads--;
     MUTEX_UNLOCK(q_mutex);
     hc.msg = (grn_msg *)msg;
-    do_htreq(ctx, (grn_msg *)msg);
+    hc.keep_alive = GRN_FALSE;
+    do_htreq(ctx, &hc);
     MUTEX_LOCK(q_mutex);
   } while (nfthreads < max_nfthreads && grn_gctx.stat != GRN_CTX_QUIT);
 exit :
@@ -1400,14 +1500,20 @@ static void
 h_handler(grn_ctx *ctx, grn_obj *msg)
 {
   grn_com *com = ((grn_msg *)msg)->u.peer;
-  if (ctx->rc) {
+  if (ctx->rc || GRN_BULK_VSIZE(msg) == 0) {
+    /* An error or EOF: the peer or a worker closed the connection.
+       Workers only shut connections down, so all connections are closed
+       here. */
+    grn_com_event *ev = com->ev;
     grn_com_close(ctx, com);
     grn_msg_close(ctx, msg);
+    /* Accepting may have been stopped because fds ran out. */
+    grn_com_event_start_accept(ctx, ev);
   } else {
     grn_sock fd = com->fd;
     void *arg = com->ev->opaque;
-    /* if not keep alive connection */
-    grn_com_event_del(ctx, com->ev, fd);
+    /* Stop watching the connection until a worker sends the response. */
+    grn_com_event_mod(ctx, com->ev, fd, 0, NULL);
     ((grn_msg *)msg)->u.fd = fd;
     MUTEX_LOCK(q_mutex);
     grn_com_queue_enque(ctx, &ctx_new, (grn_com_queue_entry *)msg);
@@ -1433,6 +1539,7 @@ h_server(char *path)
   GRN_COM_QUEUE_INIT(&ctx_new);
   GRN_COM_QUEUE_INIT(&ctx_old);
   check_rlimit_nofile(ctx);
+  idle_connection_timeout = keep_alive_timeout;
   exit_code = start_service(ctx, path, NULL, h_handler);
   grn_ctx_fin(ctx);
   return exit_code;
@@ -2045,6 +2152,10 @@ show_usage(FILE *output)
           "                                [gqtp|http|memcached] (default: %s)\n"
           "      --document-root <path>:   specify document root path (http only)\n"
           "                                (default: %s)\n"
+          "      --keep-alive-timeout <seconds>:\n"
+          "                                close keep-alive connections idle for\n"
+          "                                <seconds> (http only)\n"
+          "                                (default: %d: 0: never)\n"
           "      --cache-limit <limit>:    specify max number of cache data (default: %u)\n"
           "  -t, --max-threads <max threads>:\n"
           "                                specify max number of threads (default: %u)\n"
@@ -2072,6 +2183,9 @@ show_usage(FILE *output)
           "      --default-match-escalation-threshold <threshold>:\n"
           "                       specify default match escalation threshold"
           " (default: %" GRN_FMT_LLD ")\n"
+          "      --max-mapped-memory <size>:\n"
+          "                       specify max bytes of mapped index and column\n"
+          "                       segments (default: 0: unlimited)\n"
           "\n"
           "      --show-config:   show config\n"
           "  -h, --help:          show usage\n"
@@ -2084,7 +2198,8 @@ show_usage(FILE *output)
           grn_encoding_to_string(default_encoding),
           default_port, default_bind_address,
           default_port, default_hostname, default_protocol,
-          default_document_root, default_cache_limit, default_max_num_threads,
+          default_document_root, DEFAULT_KEEP_ALIVE_TIMEOUT,
+          default_cache_limit, default_max_num_threads,
           default_log_level, default_log_path, default_query_log_path,
           default_config_path, default_default_command_version,
           (long long int)default_default_match_escalation_threshold,
@@ -2102,11 +2217,13 @@ main(int argc, char **argv)
     *default_command_version_arg = NULL,
     *default_match_escalation_threshold_arg = NULL,
     *input_fd_arg = NULL, *output_fd_arg = NULL,
-    *working_directory_arg = NULL;
+    *working_directory_arg = NULL, *max_mapped_memory_arg = NULL,
+    *keep_alive_timeout_arg = NULL;
   const char *config_path = NULL;
   int exit_code = EXIT_SUCCESS;
   int i, mode = mode_alone;
   uint32_t cache_limit = 0;
+  long long int max_mapped_memory = 0;
   static grn_str_getopt_opt opts[] = {
     {'p', "port", NULL, 0, GETOPT_OP_NONE},
     {'e', "encoding", NULL, 0, GETOPT_OP_NONE},
@@ -2135,6 +2252,8 @@ main(int argc, char **argv)
     {'\0', "input-fd", NULL, 0, GETOPT_OP_NONE},
     {'\0', "output-fd", NULL, 0, GETOPT_OP_NONE},
     {'\0', "working-directory", NULL, 0, GETOPT_OP_NONE},
+    {'\0', "max-mapped-memory", NULL, 0, GETOPT_OP_NONE},
+    {'\0', "keep-alive-timeout", NULL, 0, GETOPT_OP_NONE},
     {'\0', NULL, NULL, 0, 0}
   };
   opts[0].arg = &port_arg;
@@ -2156,6 +2275,8 @@ main(int argc, char **argv)
   opts[24].arg = &input_fd_arg;
   opts[25].arg = &output_fd_arg;
   opts[26].arg = &working_directory_arg;
+  opts[27].arg = &max_mapped_memory_arg;
+  opts[28].arg = &keep_alive_timeout_arg;
 
   reset_ready_notify_pipe();
 
@@ -2465,6 +2586,31 @@ main(int argc, char **argv)
     cache_limit = value;
   }
 
+  if (max_mapped_memory_arg) {
+    const char * const end =
+      max_mapped_memory_arg + strlen(max_mapped_memory_arg);
+    const char *rest = NULL;
+    max_mapped_memory = grn_atoll(max_mapped_memory_arg, end, &rest);
+    if (end != rest || max_mapped_memory < 0) {
+      fprintf(stderr, "invalid --max-mapped-memory value: <%s>\n",
+              max_mapped_memory_arg);
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (keep_alive_timeout_arg) {
+    const char * const end =
+      keep_alive_timeout_arg + strlen(keep_alive_timeout_arg);
+    const char *rest = NULL;
+    const uint32_t value = grn_atoui(keep_alive_timeout_arg, end, &rest);
+    if (end != rest) {
+      fprintf(stderr, "invalid --keep-alive-timeout value: <%s>\n",
+              keep_alive_timeout_arg);
+      return EXIT_FAILURE;
+    }
+    keep_alive_timeout = value;
+  }
+
 #ifdef GRN_WITH_LIBEDIT
   if (!batchmode) {
     line_editor_init(argc, argv);
@@ -2492,6 +2638,10 @@ main(int argc, char **argv)
     grn_cache_set_max_n_entries(&grn_gctx, cache, cache_limit);
   }
 
+  if (max_mapped_memory_arg) {
+    grn_set_max_mapped_memory(max_mapped_memory);
+  }
+
   newdb = (mode & MODE_NEW_DB);
   useql = (mode & MODE_USE_QL);
   switch (mode & MODE_MASK) {
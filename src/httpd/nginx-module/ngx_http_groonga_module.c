@@ -19,6 +19,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#include <pthread.h>
 
 #include <ngx_config.h>
 #include <ngx_core.h>
@@ -40,6 +41,7 @@ typedef struct {
   ngx_str_t query_log_path;
   ngx_open_file_t *query_log_file;
   size_t cache_limit;
+  ngx_int_t thread_pool_size;
   char *config_file;
   int config_line;
   char *name;
@@ -61,13 +63,34 @@ typedef struct {
   grn_obj foot;
 } ngx_http_groonga_handler_data_t;
 
+typedef struct ngx_http_groonga_task_s ngx_http_groonga_task_t;
+struct ngx_http_groonga_task_s {
+  ngx_http_request_t *request;
+  ngx_http_groonga_loc_conf_t *location_conf;
+  ngx_http_groonga_handler_data_t *data;
+  ngx_str_t command_path;
+  ngx_http_groonga_task_t *next;
+};
+
+typedef struct {
+  ngx_int_t n_threads;
+  pthread_t *threads;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  grn_bool quit;
+  ngx_http_groonga_task_t *waiting_head;
+  ngx_http_groonga_task_t *waiting_tail;
+  ngx_http_groonga_task_t *done_head;
+  ngx_http_groonga_task_t *done_tail;
+  int notify_fds[2];
+  ngx_connection_t *notify_connection;
+} ngx_http_groonga_thread_pool_t;
+
 typedef struct {
-  ngx_pool_t *pool;
   ngx_open_file_t *file;
 } ngx_http_groonga_logger_data_t;
 
 typedef struct {
-  ngx_pool_t *pool;
   ngx_open_file_t *file;
   ngx_str_t *path;
 } ngx_http_groonga_query_logger_data_t;
@@ -76,6 +99,18 @@ typedef void (*ngx_http_groonga_loc_conf_callback_pt)(ngx_http_groonga_loc_conf_
 
 ngx_module_t ngx_http_groonga_module;
 
+static ngx_http_groonga_thread_pool_t ngx_http_groonga_thread_pool;
+
+/*
+ * groonga has only one logger and one query logger for the process. They
+ * are set once in each worker process and write to the files of the
+ * location that the current thread runs a command for. These are the
+ * files used when the thread doesn't run a command for any location.
+ */
+static ngx_http_groonga_logger_data_t ngx_http_groonga_logger_data;
+static ngx_http_groonga_query_logger_data_t ngx_http_groonga_query_logger_data;
+static pthread_key_t ngx_http_groonga_location_conf_key;
+
 static char *
 ngx_str_null_terminate(ngx_pool_t *pool, const ngx_str_t *string)
 {
@@ -116,6 +151,18 @@ ngx_str_is_custom_path(ngx_str_t *string)
   return GRN_TRUE;
 }
 
+static ngx_http_groonga_loc_conf_t *
+ngx_http_groonga_current_location_conf_get(void)
+{
+  return pthread_getspecific(ngx_http_groonga_location_conf_key);
+}
+
+static void
+ngx_http_groonga_current_location_conf_set(ngx_http_groonga_loc_conf_t *location_conf)
+{
+  pthread_setspecific(ngx_http_groonga_location_conf_key, location_conf);
+}
+
 static void
 ngx_http_groonga_logger_log(grn_ctx *ctx, grn_log_level level,
                             const char *timestamp, const char *title,
@@ -123,10 +170,25 @@ ngx_http_groonga_logger_log(grn_ctx *ctx, grn_log_level level,
                             void *user_data)
 {
   ngx_http_groonga_logger_data_t *logger_data = user_data;
+  ngx_http_groonga_loc_conf_t *location_conf;
+  ngx_open_file_t *file;
   const char level_marks[] = " EACewnid-";
   u_char buffer[NGX_MAX_ERROR_STR];
   u_char *last;
 
+  location_conf = ngx_http_groonga_current_location_conf_get();
+  if (location_conf) {
+    if (level > location_conf->log_level) {
+      return;
+    }
+    file = location_conf->log_file;
+  } else {
+    file = logger_data->file;
+  }
+  if (!file) {
+    return;
+  }
+
   if (location && *location) {
     last = ngx_slprintf(buffer, buffer + NGX_MAX_ERROR_STR,
                         "%s|%c|%s %s %s\n",
@@ -137,7 +199,7 @@ ngx_http_groonga_logger_log(grn_ctx *ctx, grn_log_level level,
                         "%s|%c|%s %s\n",
                         timestamp, *(level_marks + level), title, message);
   }
-  ngx_write_fd(logger_data->file->fd, buffer, last - buffer);
+  ngx_write_fd(file->fd, buffer, last - buffer);
 }
 
 static void
@@ -148,64 +210,40 @@ ngx_http_groonga_logger_reopen(grn_ctx *ctx, void *user_data)
   GRN_LOG(ctx, GRN_LOG_NOTICE, "log opened.");
 }
 
-static void
-ngx_http_groonga_logger_fin(grn_ctx *ctx, void *user_data)
-{
-  ngx_http_groonga_logger_data_t *logger_data = user_data;
-
-  ngx_pfree(logger_data->pool, logger_data);
-}
-
 static grn_logger ngx_http_groonga_logger = {
   GRN_LOG_DEFAULT_LEVEL,
   GRN_LOG_TIME | GRN_LOG_MESSAGE,
-  NULL,
+  &ngx_http_groonga_logger_data,
   ngx_http_groonga_logger_log,
   ngx_http_groonga_logger_reopen,
-  ngx_http_groonga_logger_fin
+  NULL
 };
 
-static ngx_int_t
-ngx_http_groonga_context_init_logger(grn_ctx *context,
-                                     ngx_http_groonga_loc_conf_t *location_conf,
-                                     ngx_pool_t *pool,
-                                     ngx_log_t *log)
-{
-  ngx_http_groonga_logger_data_t *logger_data;
-
-  if (!location_conf->log_file) {
-    return NGX_OK;
-  }
-
-  logger_data = ngx_pcalloc(pool, sizeof(ngx_http_groonga_logger_data_t));
-  if (!logger_data) {
-    ngx_log_error(NGX_LOG_ERR, log, 0,
-                  "http_groonga: failed to allocate memory for logger");
-    return NGX_ERROR;
-  }
-
-  logger_data->pool = pool;
-  logger_data->file = location_conf->log_file;
-  ngx_http_groonga_logger.max_level = location_conf->log_level;
-  ngx_http_groonga_logger.user_data = logger_data;
-  grn_logger_set(context, &ngx_http_groonga_logger);
-
-  return NGX_OK;
-}
-
 static void
 ngx_http_groonga_query_logger_log(grn_ctx *ctx, unsigned int flag,
                                   const char *timestamp, const char *info,
                                   const char *message, void *user_data)
 {
   ngx_http_groonga_query_logger_data_t *data = user_data;
+  ngx_http_groonga_loc_conf_t *location_conf;
+  ngx_open_file_t *file;
   u_char buffer[NGX_MAX_ERROR_STR];
   u_char *last;
 
+  location_conf = ngx_http_groonga_current_location_conf_get();
+  if (location_conf) {
+    file = location_conf->query_log_file;
+  } else {
+    file = data->file;
+  }
+  if (!file) {
+    return;
+  }
+
   last = ngx_slprintf(buffer, buffer + NGX_MAX_ERROR_STR,
                       "%s|%s%s\n",
                       timestamp, info, message);
-  ngx_write_fd(data->file->fd, buffer, last - buffer);
+  ngx_write_fd(file->fd, buffer, last - buffer);
 }
 
 static void
@@ -222,84 +260,30 @@ ngx_http_groonga_query_logger_reopen(grn_ctx *ctx, void *user_data)
                 (int)(data->path->len), data->path->data);
 }
 
-static void
-ngx_http_groonga_query_logger_fin(grn_ctx *ctx, void *user_data)
-{
-  ngx_http_groonga_query_logger_data_t *data = user_data;
-
-  ngx_pfree(data->pool, data);
-}
-
 static grn_query_logger ngx_http_groonga_query_logger = {
   GRN_QUERY_LOG_DEFAULT,
-  NULL,
+  &ngx_http_groonga_query_logger_data,
   ngx_http_groonga_query_logger_log,
   ngx_http_groonga_query_logger_reopen,
-  ngx_http_groonga_query_logger_fin
+  NULL
 };
 
-static ngx_int_t
-ngx_http_groonga_context_init_query_logger(grn_ctx *context,
-                                           ngx_http_groonga_loc_conf_t *location_conf,
-                                           ngx_pool_t *pool,
-                                           ngx_log_t *log)
-{
-  ngx_http_groonga_query_logger_data_t *query_logger_data;
-
-  if (!location_conf->query_log_file) {
-    return NGX_OK;
-  }
-
-  query_logger_data = ngx_pcalloc(pool,
-                                  sizeof(ngx_http_groonga_query_logger_data_t));
-  if (!query_logger_data) {
-    ngx_log_error(NGX_LOG_ERR, log, 0,
-                  "http_groonga: failed to allocate memory for query logger");
-    return NGX_ERROR;
-  }
-
-  query_logger_data->pool = pool;
-  query_logger_data->file = location_conf->query_log_file;
-  query_logger_data->path = &(location_conf->query_log_path);
-  ngx_http_groonga_query_logger.user_data = query_logger_data;
-  grn_query_logger_set(context, &ngx_http_groonga_query_logger);
-
-  return NGX_OK;
-}
-
+/*
+ * Commands may run in parallel on the thread pool, so the process-wide
+ * loggers and cache must not be changed for each request. The cache is
+ * bound to the context instead.
+ */
 static ngx_int_t
 ngx_http_groonga_context_init(grn_ctx *context,
-                              ngx_http_groonga_loc_conf_t *location_conf,
-                              ngx_pool_t *pool,
-                              ngx_log_t *log)
+                              ngx_http_groonga_loc_conf_t *location_conf)
 {
-  ngx_int_t status;
-
   grn_ctx_init(context, GRN_NO_FLAGS);
 
-  status = ngx_http_groonga_context_init_logger(context,
-                                                location_conf,
-                                                pool,
-                                                log);
-  if (status == NGX_ERROR) {
-    grn_ctx_fin(context);
-    return status;
-  }
-
-  status = ngx_http_groonga_context_init_query_logger(context,
-                                                      location_conf,
-                                                      pool,
-                                                      log);
-  if (status == NGX_ERROR) {
-    grn_ctx_fin(context);
-    return status;
-  }
-
   if (location_conf->cache) {
-    grn_cache_current_set(context, location_conf->cache);
+    grn_ctx_set_cache(context, location_conf->cache);
   }
 
-  return status;
+  return NGX_OK;
 }
 
 static void
@@ -354,8 +338,6 @@ ngx_http_groonga_handler_cleanup(void *user_data)
   GRN_OBJ_FIN(context, &(data->head));
   GRN_OBJ_FIN(context, &(data->body));
   GRN_OBJ_FIN(context, &(data->foot));
-  grn_logger_set(context, NULL);
-  grn_query_logger_set(context, NULL);
   grn_ctx_fin(context);
 }
 
@@ -484,6 +466,7 @@ ngx_http_groonga_handler_create_data(ngx_http_request_t *r,
   grn_ctx *context;
 
   location_conf = ngx_http_get_module_loc_conf(r, ngx_http_groonga_module);
+  ngx_http_groonga_current_location_conf_set(location_conf);
 
   cleanup = ngx_http_cleanup_add(r, sizeof(ngx_http_groonga_handler_data_t));
   cleanup->handler = ngx_http_groonga_handler_cleanup;
@@ -491,8 +474,7 @@ ngx_http_groonga_handler_create_data(ngx_http_request_t *r,
   *data_return = data;
 
   context = &(data->context);
-  rc = ngx_http_groonga_context_init(context, location_conf,
-                                     r->pool, r->connection->log);
+  rc = ngx_http_groonga_context_init(context, location_conf);
   if (rc != NGX_OK) {
     return rc;
   }
@@ -513,10 +495,9 @@ ngx_http_groonga_handler_create_data(ngx_http_request_t *r,
   return NGX_OK;
 }
 
-static ngx_int_t
-ngx_http_groonga_handler_process_command_path(ngx_http_request_t *r,
-                                              ngx_str_t *command_path,
-                                              ngx_http_groonga_handler_data_t *data)
+static void
+ngx_http_groonga_handler_send_command(ngx_str_t *command_path,
+                                      ngx_http_groonga_handler_data_t *data)
 {
   grn_ctx *context;
   grn_obj uri;
@@ -527,8 +508,16 @@ ngx_http_groonga_handler_process_command_path(ngx_http_request_t *r,
   GRN_TEXT_PUT(context, &uri, command_path->data, command_path->len);
   grn_ctx_send(context, GRN_TEXT_VALUE(&uri), GRN_TEXT_LEN(&uri),
                GRN_NO_FLAGS);
-  ngx_http_groonga_context_log_error(r->connection->log, context);
   GRN_OBJ_FIN(context, &uri);
+}
+
+static ngx_int_t
+ngx_http_groonga_handler_process_command_path(ngx_http_request_t *r,
+                                              ngx_str_t *command_path,
+                                              ngx_http_groonga_handler_data_t *data)
+{
+  ngx_http_groonga_handler_send_command(command_path, data);
+  ngx_http_groonga_context_log_error(r->connection->log, &(data->context));
 
   return NGX_OK;
 }
@@ -795,12 +784,129 @@ ngx_http_groonga_handler_send_response(ngx_http_request_t *r,
   return rc;
 }
 
+/*
+ * Tasks run on the worker threads of the thread pool. Only groonga is
+ * used there. The request itself is only touched by the event loop, before
+ * a task is pushed and after the notification that it is done.
+ */
+static void *
+ngx_http_groonga_thread_pool_worker(void *user_data)
+{
+  ngx_http_groonga_thread_pool_t *thread_pool = user_data;
+
+  pthread_mutex_lock(&(thread_pool->mutex));
+  for (;;) {
+    ngx_http_groonga_task_t *task;
+
+    while (!thread_pool->quit && !thread_pool->waiting_head) {
+      pthread_cond_wait(&(thread_pool->cond), &(thread_pool->mutex));
+    }
+    if (thread_pool->quit) {
+      break;
+    }
+
+    task = thread_pool->waiting_head;
+    thread_pool->waiting_head = task->next;
+    if (!thread_pool->waiting_head) {
+      thread_pool->waiting_tail = NULL;
+    }
+    pthread_mutex_unlock(&(thread_pool->mutex));
+
+    ngx_http_groonga_current_location_conf_set(task->location_conf);
+    ngx_http_groonga_handler_send_command(&(task->command_path), task->data);
+    ngx_http_groonga_current_location_conf_set(NULL);
+
+    pthread_mutex_lock(&(thread_pool->mutex));
+    task->next = NULL;
+    if (thread_pool->done_tail) {
+      thread_pool->done_tail->next = task;
+    } else {
+      thread_pool->done_head = task;
+    }
+    thread_pool->done_tail = task;
+    /* A full pipe is OK: the handler takes all done tasks at once. */
+    (void)write(thread_pool->notify_fds[1], "", 1);
+  }
+  pthread_mutex_unlock(&(thread_pool->mutex));
+
+  return NULL;
+}
+
+static void
+ngx_http_groonga_thread_pool_notify_handler(ngx_event_t *event)
+{
+  ngx_http_groonga_thread_pool_t *thread_pool = &ngx_http_groonga_thread_pool;
+  ngx_http_groonga_task_t *task;
+  u_char buffer[64];
+
+  while (read(thread_pool->notify_fds[0], buffer, sizeof(buffer)) > 0) {
+  }
+
+  pthread_mutex_lock(&(thread_pool->mutex));
+  task = thread_pool->done_head;
+  thread_pool->done_head = NULL;
+  thread_pool->done_tail = NULL;
+  pthread_mutex_unlock(&(thread_pool->mutex));
+
+  while (task) {
+    ngx_http_groonga_task_t *next = task->next;
+    ngx_http_request_t *r = task->request;
+    ngx_connection_t *connection = r->connection;
+    ngx_int_t rc;
+
+    ngx_http_groonga_context_log_error(connection->log,
+                                       &(task->data->context));
+    rc = ngx_http_groonga_handler_send_response(r, task->data);
+    ngx_http_finalize_request(r, rc);
+    ngx_http_run_posted_requests(connection);
+    task = next;
+  }
+}
+
+static ngx_int_t
+ngx_http_groonga_thread_pool_push(ngx_http_request_t *r,
+                                  ngx_str_t *command_path,
+                                  ngx_http_groonga_handler_data_t *data)
+{
+  ngx_http_groonga_thread_pool_t *thread_pool = &ngx_http_groonga_thread_pool;
+  ngx_http_groonga_task_t *task;
+
+  task = ngx_pcalloc(r->pool, sizeof(ngx_http_groonga_task_t));
+  if (!task) {
+    ngx_log_error(NGX_LOG_ERR, r->connection->log, 0,
+                  "http_groonga: failed to allocate memory for task");
+    return NGX_HTTP_INTERNAL_SERVER_ERROR;
+  }
+  task->request = r;
+  task->location_conf = ngx_http_get_module_loc_conf(r,
+                                                     ngx_http_groonga_module);
+  task->data = data;
+  task->command_path = *command_path;
+  task->next = NULL;
+
+  r->main->count++;
+  r->read_event_handler = ngx_http_block_reading;
+
+  pthread_mutex_lock(&(thread_pool->mutex));
+  if (thread_pool->waiting_tail) {
+    thread_pool->waiting_tail->next = task;
+  } else {
+    thread_pool->waiting_head = task;
+  }
+  thread_pool->waiting_tail = task;
+  pthread_cond_signal(&(thread_pool->cond));
+  pthread_mutex_unlock(&(thread_pool->mutex));
+
+  return NGX_DONE;
+}
+
 static ngx_int_t
 ngx_http_groonga_handler_get(ngx_http_request_t *r)
 {
   ngx_int_t rc;
   ngx_str_t command_path;
   ngx_http_groonga_handler_data_t *data;
+  ngx_http_groonga_loc_conf_t *location_conf;
 
   rc = ngx_http_groonga_extract_command_path(r, &command_path);
   if (rc != NGX_OK) {
@@ -812,6 +918,18 @@ ngx_http_groonga_handler_get(ngx_http_request_t *r)
     return rc;
   }
 
+  location_conf = ngx_http_get_module_loc_conf(r, ngx_http_groonga_module);
+  if (location_conf->thread_pool_size > 0 &&
+      ngx_http_groonga_thread_pool.n_threads > 0) {
+    /* discard request body, since we don't need it here */
+    rc = ngx_http_discard_request_body(r);
+    if (rc != NGX_OK) {
+      return rc;
+    }
+
+    return ngx_http_groonga_thread_pool_push(r, &command_path, data);
+  }
+
   rc = ngx_http_groonga_handler_process_command_path(r, &command_path, data);
   if (rc != NGX_OK) {
     return rc;
@@ -1027,6 +1145,7 @@ ngx_http_groonga_create_loc_conf(ngx_conf_t *cf)
   conf->query_log_path.len = 0;
   conf->query_log_file = NULL;
   conf->cache_limit = NGX_CONF_UNSET_SIZE;
+  conf->thread_pool_size = NGX_CONF_UNSET;
   conf->config_file = NULL;
   conf->config_line = 0;
   conf->cache = NULL;
@@ -1046,6 +1165,7 @@ ngx_http_groonga_merge_loc_conf(ngx_conf_t *cf, void *parent, void *child)
                        GRN_TRUE);
   ngx_conf_merge_size_value(conf->cache_limit, prev->cache_limit,
                             GRN_CACHE_DEFAULT_MAX_N_ENTRIES);
+  ngx_conf_merge_value(conf->thread_pool_size, prev->thread_pool_size, 0);
 
 #ifdef NGX_HTTP_GROONGA_LOG_PATH
   {
@@ -1203,8 +1323,8 @@ ngx_http_groonga_open_database_callback(ngx_http_groonga_loc_conf_t *location_co
   grn_ctx *context;
 
   context = &(location_conf->context);
-  data->rc = ngx_http_groonga_context_init(context, location_conf,
-                                           data->pool, data->log);
+  ngx_http_groonga_current_location_conf_set(location_conf);
+  data->rc = ngx_http_groonga_context_init(context, location_conf);
   if (data->rc != NGX_OK) {
     return;
   }
@@ -1245,6 +1365,7 @@ ngx_http_groonga_open_database_callback(ngx_http_groonga_loc_conf_t *location_co
     data->rc = NGX_ERROR;
     return;
   }
+  grn_ctx_set_cache(context, location_conf->cache);
   if (location_conf->cache_limit != NGX_CONF_UNSET_SIZE) {
     grn_cache_set_max_n_entries(context,
                                 location_conf->cache,
@@ -1260,25 +1381,145 @@ ngx_http_groonga_close_database_callback(ngx_http_groonga_loc_conf_t *location_c
   grn_ctx *context;
 
   context = &(location_conf->context);
-  ngx_http_groonga_context_init_logger(context,
-                                       location_conf,
-                                       data->pool,
-                                       data->log);
-  ngx_http_groonga_context_init_query_logger(context,
-                                             location_conf,
-                                             data->pool,
-                                             data->log);
-  grn_cache_current_set(context, location_conf->cache);
-
+  ngx_http_groonga_current_location_conf_set(location_conf);
   grn_obj_close(context, grn_ctx_db(context));
   ngx_http_groonga_context_log_error(data->log, context);
 
-  grn_cache_current_set(context, NULL);
+  grn_ctx_set_cache(context, NULL);
   grn_cache_close(context, location_conf->cache);
 
   grn_ctx_fin(context);
 }
 
+static void
+ngx_http_groonga_init_loggers_callback(ngx_http_groonga_loc_conf_t *location_conf,
+                                       void *user_data)
+{
+  if (location_conf->log_file) {
+    if (!ngx_http_groonga_logger_data.file) {
+      ngx_http_groonga_logger_data.file = location_conf->log_file;
+    }
+    if (location_conf->log_level > ngx_http_groonga_logger.max_level) {
+      ngx_http_groonga_logger.max_level = location_conf->log_level;
+    }
+  }
+
+  if (location_conf->query_log_file &&
+      !ngx_http_groonga_query_logger_data.file) {
+    ngx_http_groonga_query_logger_data.file = location_conf->query_log_file;
+    ngx_http_groonga_query_logger_data.path = &(location_conf->query_log_path);
+  }
+}
+
+static void
+ngx_http_groonga_init_loggers(ngx_http_conf_ctx_t *http_conf)
+{
+  grn_ctx context;
+
+  ngx_http_groonga_logger.max_level = GRN_LOG_NONE;
+  ngx_http_groonga_each_loc_conf(http_conf,
+                                 ngx_http_groonga_init_loggers_callback,
+                                 NULL);
+
+  grn_ctx_init(&context, GRN_NO_FLAGS);
+  if (ngx_http_groonga_logger_data.file) {
+    grn_logger_set(&context, &ngx_http_groonga_logger);
+  }
+  if (ngx_http_groonga_query_logger_data.file) {
+    grn_query_logger_set(&context, &ngx_http_groonga_query_logger);
+  }
+  grn_ctx_fin(&context);
+}
+
+static void
+ngx_http_groonga_max_thread_pool_size_callback(ngx_http_groonga_loc_conf_t *location_conf,
+                                               void *user_data)
+{
+  ngx_int_t *max_thread_pool_size = user_data;
+
+  if (location_conf->thread_pool_size > *max_thread_pool_size) {
+    *max_thread_pool_size = location_conf->thread_pool_size;
+  }
+}
+
+static ngx_int_t
+ngx_http_groonga_thread_pool_init(ngx_cycle_t *cycle, ngx_int_t n_threads)
+{
+  ngx_http_groonga_thread_pool_t *thread_pool = &ngx_http_groonga_thread_pool;
+  ngx_connection_t *connection;
+  ngx_int_t i;
+
+  if (pipe(thread_pool->notify_fds) == -1) {
+    ngx_log_error(NGX_LOG_EMERG, cycle->log, ngx_errno,
+                  "http_groonga: failed to create a pipe for thread pool");
+    return NGX_ERROR;
+  }
+  if (ngx_nonblocking(thread_pool->notify_fds[0]) == -1 ||
+      ngx_nonblocking(thread_pool->notify_fds[1]) == -1) {
+    ngx_log_error(NGX_LOG_EMERG, cycle->log, ngx_errno,
+                  "http_groonga: failed to make thread pool pipe nonblocking");
+    return NGX_ERROR;
+  }
+
+  connection = ngx_get_connection(thread_pool->notify_fds[0], cycle->log);
+  if (!connection) {
+    return NGX_ERROR;
+  }
+  connection->read->handler = ngx_http_groonga_thread_pool_notify_handler;
+  connection->read->log = cycle->log;
+  if (ngx_handle_read_event(connection->read, 0) != NGX_OK) {
+    ngx_free_connection(connection);
+    return NGX_ERROR;
+  }
+  thread_pool->notify_connection = connection;
+
+  pthread_mutex_init(&(thread_pool->mutex), NULL);
+  pthread_cond_init(&(thread_pool->cond), NULL);
+  thread_pool->quit = GRN_FALSE;
+  thread_pool->threads = ngx_pcalloc(cycle->pool, sizeof(pthread_t) * n_threads);
+  if (!thread_pool->threads) {
+    return NGX_ERROR;
+  }
+  for (i = 0; i < n_threads; i++) {
+    if (pthread_create(&(thread_pool->threads[i]), NULL,
+                       ngx_http_groonga_thread_pool_worker,
+                       thread_pool) != 0) {
+      ngx_log_error(NGX_LOG_EMERG, cycle->log, ngx_errno,
+                    "http_groonga: failed to create a thread for thread pool");
+      return NGX_ERROR;
+    }
+    thread_pool->n_threads++;
+  }
+
+  return NGX_OK;
+}
+
+static void
+ngx_http_groonga_thread_pool_fin(void)
+{
+  ngx_http_groonga_thread_pool_t *thread_pool = &ngx_http_groonga_thread_pool;
+  ngx_int_t i;
+
+  if (thread_pool->n_threads == 0) {
+    return;
+  }
+
+  pthread_mutex_lock(&(thread_pool->mutex));
+  thread_pool->quit = GRN_TRUE;
+  pthread_cond_broadcast(&(thread_pool->cond));
+  pthread_mutex_unlock(&(thread_pool->mutex));
+  for (i = 0; i < thread_pool->n_threads; i++) {
+    pthread_join(thread_pool->threads[i], NULL);
+  }
+  thread_pool->n_threads = 0;
+
+  ngx_close_connection(thread_pool->notify_connection);
+  thread_pool->notify_connection = NULL;
+  close(thread_pool->notify_fds[1]);
+  pthread_cond_destroy(&(thread_pool->cond));
+  pthread_mutex_destroy(&(thread_pool->mutex));
+}
+
 static ngx_int_t
 ngx_http_groonga_init_process(ngx_cycle_t *cycle)
 {
@@ -1296,14 +1537,34 @@ ngx_http_groonga_init_process(ngx_cycle_t *cycle)
   http_conf =
     (ngx_http_conf_ctx_t *)ngx_get_conf(cycle->conf_ctx, ngx_http_module);
 
+  if (pthread_key_create(&ngx_http_groonga_location_conf_key, NULL) != 0) {
+    ngx_log_error(NGX_LOG_EMERG, cycle->log, ngx_errno,
+                  "http_groonga: failed to create a thread key for location");
+    return NGX_ERROR;
+  }
+  ngx_http_groonga_init_loggers(http_conf);
+
   data.log = cycle->log;
   data.pool = cycle->pool;
   data.rc = NGX_OK;
   ngx_http_groonga_each_loc_conf(http_conf,
                                  ngx_http_groonga_open_database_callback,
                                  &data);
+  if (data.rc != NGX_OK) {
+    return data.rc;
+  }
 
-  return data.rc;
+  {
+    ngx_int_t max_thread_pool_size = 0;
+    ngx_http_groonga_each_loc_conf(http_conf,
+                                   ngx_http_groonga_max_thread_pool_size_callback,
+                                   &max_thread_pool_size);
+    if (max_thread_pool_size > 0) {
+      return ngx_http_groonga_thread_pool_init(cycle, max_thread_pool_size);
+    }
+  }
+
+  return NGX_OK;
 }
 
 static void
@@ -1312,6 +1573,8 @@ ngx_http_groonga_exit_process(ngx_cycle_t *cycle)
   ngx_http_conf_ctx_t *http_conf;
   ngx_http_groonga_database_callback_data_t data;
 
+  ngx_http_groonga_thread_pool_fin();
+
   http_conf =
     (ngx_http_conf_ctx_t *)ngx_get_conf(cycle->conf_ctx, ngx_http_module);
   data.log = cycle->log;
@@ -1322,6 +1585,8 @@ ngx_http_groonga_exit_process(ngx_cycle_t *cycle)
 
   grn_fin();
 
+  pthread_key_delete(ngx_http_groonga_location_conf_key);
+
   return;
 }
 
@@ -1383,6 +1648,13 @@ static ngx_command_t ngx_http_groonga_commands[] = {
     offsetof(ngx_http_groonga_loc_conf_t, cache_limit),
     NULL },
 
+  { ngx_string("groonga_thread_pool"),
+    NGX_HTTP_MAIN_CONF|NGX_HTTP_SRV_CONF|NGX_HTTP_LOC_CONF|NGX_CONF_TAKE1,
+    ngx_conf_set_num_slot,
+    NGX_HTTP_LOC_CONF_OFFSET,
+    offsetof(ngx_http_groonga_loc_conf_t, thread_pool_size),
+    NULL },
+
   ngx_null_command
 };
 
@@ -0,0 +1,213 @@
+/* -*- c-basic-offset: 2; coding: utf-8 -*- */
+/*
+  Copyright (C) 2014  Brazil
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License version 2.1 as published by the Free Software Foundation.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "ctx.h"
+
+#include <gcutter.h>
+#include <glib/gstdio.h>
+
+#include "../lib/grn-assertions.h"
+
+void test_max_n_bytes_too_large_result(void);
+void test_max_n_bytes_expire(void);
+void test_max_shrink(void);
+void test_max_n_bytes_shrink(void);
+void test_context_cache(void);
+
+static gchar *tmp_directory;
+
+static grn_ctx *context;
+static grn_obj *database;
+static grn_cache *cache;
+static grn_cache *default_cache;
+
+void
+cut_startup(void)
+{
+  tmp_directory = g_build_filename(grn_test_get_tmp_dir(),
+                                   "command-cache-limit",
+                                   NULL);
+}
+
+void
+cut_shutdown(void)
+{
+  g_free(tmp_directory);
+}
+
+static void
+remove_tmp_directory(void)
+{
+  cut_remove_path(tmp_directory, NULL);
+}
+
+void
+cut_setup(void)
+{
+  const gchar *database_path;
+
+  remove_tmp_directory();
+  g_mkdir_with_parents(tmp_directory, 0700);
+
+  context = g_new0(grn_ctx, 1);
+  grn_ctx_init(context, 0);
+
+  database_path = cut_build_path(tmp_directory, "database.groonga", NULL);
+  database = grn_db_create(context, database_path, NULL);
+
+  default_cache = grn_cache_current_get(context);
+  cache = grn_cache_open(context);
+  grn_cache_current_set(context, cache);
+
+  assert_send_command("table_create Sites TABLE_HASH_KEY ShortText");
+  assert_send_command("load --table Sites\n"
+                      "[\n"
+                      "{\"_key\": \"groonga.org\"},\n"
+                      "{\"_key\": \"mroonga.org\"},\n"
+                      "{\"_key\": \"rroonga.org\"},\n"
+                      "{\"_key\": \"nroonga.org\"}\n"
+                      "]");
+}
+
+void
+cut_teardown(void)
+{
+  if (context) {
+    grn_cache_current_set(context, default_cache);
+    grn_cache_close(context, cache);
+    grn_obj_unlink(context, database);
+    grn_ctx_fin(context);
+    g_free(context);
+  }
+
+  remove_tmp_directory();
+}
+
+static grn_cache_statistics *
+get_statistics(void)
+{
+  static grn_cache_statistics statistics;
+
+  grn_cache_get_statistics(context, cache, &statistics);
+  return &statistics;
+}
+
+/* Each select caches a result of the same size. */
+static void
+select_nth_site(gint nth)
+{
+  send_command(cut_take_printf("select Sites "
+                               "--output_columns _key "
+                               "--offset %d --limit 1",
+                               nth));
+}
+
+static uint64_t
+entry_n_bytes(void)
+{
+  select_nth_site(0);
+  cut_assert_equal_uint(1, get_statistics()->nentries);
+  return get_statistics()->nbytes;
+}
+
+static void
+set_max_n_bytes(uint64_t max_n_bytes)
+{
+  assert_send_command(cut_take_printf("cache_limit "
+                                      "--max_n_bytes %" GRN_FMT_INT64U,
+                                      max_n_bytes));
+}
+
+void
+test_max_n_bytes_too_large_result(void)
+{
+  assert_send_command("cache_limit --max_n_bytes 10");
+  select_nth_site(0);
+  cut_assert_equal_uint(0, get_statistics()->nentries);
+  cut_assert_equal_uint(0, get_statistics()->nbytes);
+}
+
+void
+test_max_n_bytes_expire(void)
+{
+  uint64_t n_bytes;
+  grn_cache_statistics *statistics;
+
+  n_bytes = entry_n_bytes();
+  set_max_n_bytes(n_bytes * 2 + n_bytes / 2);
+  select_nth_site(1);
+  cut_assert_equal_uint(2, get_statistics()->nentries);
+  select_nth_site(2);
+  statistics = get_statistics();
+  cut_assert_equal_uint(2, statistics->nentries);
+  cut_assert_equal_uint(n_bytes * 2, statistics->nbytes);
+}
+
+void
+test_max_shrink(void)
+{
+  grn_cache_statistics *statistics;
+
+  select_nth_site(0);
+  select_nth_site(1);
+  select_nth_site(2);
+  cut_assert_equal_uint(3, get_statistics()->nentries);
+
+  assert_send_command("cache_limit --max 1");
+  statistics = get_statistics();
+  cut_assert_equal_uint(1, statistics->nentries);
+  cut_assert_equal_uint(1, statistics->max_nentries);
+}
+
+void
+test_max_n_bytes_shrink(void)
+{
+  uint64_t n_bytes;
+  grn_cache_statistics *statistics;
+
+  n_bytes = entry_n_bytes();
+  select_nth_site(1);
+  select_nth_site(2);
+  cut_assert_equal_uint(3, get_statistics()->nentries);
+
+  set_max_n_bytes(n_bytes);
+  statistics = get_statistics();
+  cut_assert_equal_uint(1, statistics->nentries);
+  cut_assert_equal_uint(n_bytes, statistics->nbytes);
+}
+
+void
+test_context_cache(void)
+{
+  grn_cache *context_cache;
+  grn_cache *current_cache;
+  grn_cache_statistics statistics;
+
+  context_cache = grn_cache_open(context);
+  grn_ctx_set_cache(context, context_cache);
+  current_cache = grn_cache_current_get(context);
+  select_nth_site(0);
+  grn_cache_get_statistics(context, context_cache, &statistics);
+  grn_ctx_set_cache(context, NULL);
+  grn_cache_close(context, context_cache);
+
+  cut_assert_equal_pointer(context_cache, current_cache);
+  cut_assert_equal_uint(1, statistics.nentries);
+  cut_assert_equal_uint(0, get_statistics()->nentries);
+  cut_assert_equal_pointer(cache, grn_cache_current_get(context));
+}
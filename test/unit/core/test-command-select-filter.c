@@ -24,6 +24,7 @@
 #include "../lib/grn-assertions.h"
 
 void test_prefix_search(void);
+void test_parallel_scan(void);
 
 static gchar *tmp_directory;
 
@@ -68,6 +69,8 @@ cut_setup(void)
 void
 cut_teardown(void)
 {
+  grn_set_table_select_n_workers(1);
+
   if (context) {
     grn_obj_unlink(context, database);
     grn_ctx_fin(context);
@@ -95,3 +98,47 @@ test_prefix_search(void)
     send_command("select Users "
                  "--filter '_key @^ \"mor\"'"));
 }
+
+void
+test_parallel_scan(void)
+{
+  GString *load_command;
+  const gchar *expected;
+  gint i;
+
+  assert_send_command("table_create Numbers TABLE_NO_KEY");
+  assert_send_command("column_create Numbers value COLUMN_SCALAR Int32");
+  load_command = g_string_new("load --table Numbers\n[\n");
+  for (i = 0; i < 200000; i++) {
+    if (i > 0) {
+      g_string_append(load_command, ",\n");
+    }
+    g_string_append_printf(load_command, "{\"value\":%d}", i);
+  }
+  g_string_append(load_command, "\n]");
+  assert_send_command(load_command->str);
+  g_string_free(load_command, TRUE);
+
+  expected =
+    "[[[4],"
+     "[[\"_id\",\"UInt32\"],[\"value\",\"Int32\"]],"
+     "[2,1],"
+     "[65537,65536],"
+     "[131073,131072],"
+     "[199999,199998]]]";
+  cut_assert_equal_string(
+    expected,
+    send_command("select Numbers "
+                 "--filter 'value == 1 || value == 65536 || "
+                           "value == 131072 || value == 199998' "
+                 "--cache no"));
+
+  grn_set_table_select_n_workers(4);
+  cut_assert_equal_int(4, grn_get_table_select_n_workers());
+  cut_assert_equal_string(
+    expected,
+    send_command("select Numbers "
+                 "--filter 'value == 1 || value == 65536 || "
+                           "value == 131072 || value == 199998' "
+                 "--cache no"));
+}
@@ -17,6 +17,7 @@
 */
 
 #include "str.h"
+#include "io.h"
 #include <stdio.h>
 
 #include <gcutter.h>
@@ -31,6 +32,7 @@ void test_nonexistent(void);
 void test_fulltext_search_index_with_query(void);
 void test_pat_integer_index_with_query(void);
 void test_pat_integer_index_without_query(void);
+void test_int_with_tiny_mapped_memory_budget(void);
 
 static gchar *tmp_directory;
 
@@ -136,6 +138,8 @@ cut_setup(void)
 void
 cut_teardown(void)
 {
+  grn_set_max_mapped_memory(0);
+
   if (context) {
     grn_obj_unlink(context, database);
     grn_ctx_fin(context);
@@ -337,3 +341,59 @@ test_pat_integer_index_without_query(void)
                  "--sortby \"age\" "
                  "--output_columns \"age, _key\""));
 }
+
+void
+test_int_with_tiny_mapped_memory_budget(void)
+{
+  /* Int64 values of more than one 4MiB segment. */
+  const int n_records = 600000;
+  grn_obj *table, *column;
+  grn_obj value;
+  grn_io_statistics statistics;
+  uint32_t n_segment_unmaps;
+  int i;
+
+  assert_send_commands("table_create Numbers TABLE_NO_KEY\n"
+                       "column_create Numbers value COLUMN_SCALAR Int64");
+  table = grn_ctx_get(context, "Numbers", -1);
+  column = grn_ctx_get(context, "Numbers.value", -1);
+  GRN_INT64_INIT(&value, 0);
+  for (i = 0; i < n_records; i++) {
+    grn_id id;
+    id = grn_table_add(context, table, NULL, 0, NULL);
+    GRN_INT64_SET(context, &value, n_records - i);
+    grn_obj_set_value(context, column, id, &value, GRN_OBJ_SET);
+  }
+  GRN_OBJ_FIN(context, &value);
+
+  assert_send_commands("table_create Others TABLE_NO_KEY\n"
+                       "column_create Others value COLUMN_SCALAR Int64\n"
+                       "load --table Others\n"
+                       "[{\"value\": 29}]");
+
+  grn_set_max_mapped_memory(1);
+  for (i = 0; i < 2; i++) {
+    cut_assert_equal_string(
+      "[[[600000],"
+        "[[\"value\",\"Int64\"]],"
+        "[300001],"
+        "[300002],"
+        "[300003]]]",
+      send_command("select Numbers "
+                   "--sortby value "
+                   "--output_columns value "
+                   "--offset 300000 --limit 3 "
+                   "--cache no"));
+    if (i == 0) {
+      /* Numbers.value is hot until a command doesn't refer it. */
+      grn_io_get_statistics(&statistics);
+      n_segment_unmaps = statistics.n_segment_unmaps;
+      cut_assert_equal_string(
+        "[[[1],[[\"value\",\"Int64\"]],[29]]]",
+        send_command("select Others --output_columns value --cache no"));
+      grn_io_get_statistics(&statistics);
+      cut_assert_operator_uint(n_segment_unmaps, <,
+                               statistics.n_segment_unmaps);
+    }
+  }
+}
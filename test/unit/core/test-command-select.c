@@ -18,7 +18,9 @@
 */
 
 #include "str.h"
+#include "ctx.h"
 #include <stdio.h>
+#include <time.h>
 
 #include <gcutter.h>
 
@@ -45,6 +47,7 @@ void data_equal_numeric(void);
 void test_equal_numeric(gconstpointer data);
 void data_not_tokenize_by_full_width_space(void);
 void test_not_tokenize_by_full_width_space(gconstpointer data);
+void test_cache_dependencies(void);
 
 static gchar *tmp_directory;
 
@@ -619,3 +622,79 @@ test_not_tokenize_by_full_width_space(gconstpointer data)
                             error_message,
                             command);
 }
+
+static uint32_t
+cache_n_hits(void)
+{
+  grn_cache_statistics statistics;
+
+  grn_cache_get_statistics(context, grn_cache_current_get(context),
+                           &statistics);
+  return statistics.nhits;
+}
+
+/* Cache entries created in the same second as the last schema change
+   are always stale. */
+static void
+wait_for_next_second(void)
+{
+  time_t now = time(NULL);
+
+  while (time(NULL) == now) {
+    g_usleep(10 * 1000);
+  }
+}
+
+void
+test_cache_dependencies(void)
+{
+  const gchar *select_command =
+    "select Items --output_columns '_key, category.label'";
+  uint32_t n_hits;
+
+  assert_send_command("table_create Categories TABLE_HASH_KEY ShortText");
+  assert_send_command("column_create Categories label COLUMN_SCALAR ShortText");
+  assert_send_command("table_create Items TABLE_HASH_KEY ShortText");
+  assert_send_command("column_create Items category COLUMN_SCALAR Categories");
+  assert_send_command("table_create Logs TABLE_NO_KEY");
+  assert_send_command("column_create Logs message COLUMN_SCALAR ShortText");
+  assert_send_command("load --table Categories\n"
+                      "[\n"
+                      "{\"_key\": \"search\", \"label\": \"Search\"}\n"
+                      "]");
+  assert_send_command("load --table Items\n"
+                      "[\n"
+                      "{\"_key\": \"groonga\", \"category\": \"search\"}\n"
+                      "]");
+  wait_for_next_second();
+
+  cut_assert_equal_string("[[[1],"
+                          "[[\"_key\",\"ShortText\"],"
+                          "[\"category.label\",\"ShortText\"]],"
+                          "[\"groonga\",\"Search\"]]]",
+                          send_command(select_command));
+  n_hits = cache_n_hits();
+
+  assert_send_command("load --table Logs\n"
+                      "[\n"
+                      "{\"message\": \"Items isn't changed\"}\n"
+                      "]");
+  cut_assert_equal_string("[[[1],"
+                          "[[\"_key\",\"ShortText\"],"
+                          "[\"category.label\",\"ShortText\"]],"
+                          "[\"groonga\",\"Search\"]]]",
+                          send_command(select_command));
+  cut_assert_equal_uint(n_hits + 1, cache_n_hits());
+
+  assert_send_command("load --table Categories\n"
+                      "[\n"
+                      "{\"_key\": \"search\", "
+                      "\"label\": \"Full text search\"}\n"
+                      "]");
+  cut_assert_equal_string("[[[1],"
+                          "[[\"_key\",\"ShortText\"],"
+                          "[\"category.label\",\"ShortText\"]],"
+                          "[\"groonga\",\"Full text search\"]]]",
+                          send_command(select_command));
+  cut_assert_equal_uint(n_hits + 1, cache_n_hits());
+}
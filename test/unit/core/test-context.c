@@ -29,6 +29,8 @@ void test_dynamic_malloc_change(void);
 void test_command_version(void);
 void test_support_zlib(void);
 void test_support_lzo(void);
+void test_support_lz4(void);
+void test_support_zstd(void);
 
 static grn_ctx *context;
 static grn_obj *database;
@@ -159,3 +161,41 @@ test_support_lzo(void)
   cut_assert_false(support_p);
 #endif
 }
+
+void
+test_support_lz4(void)
+{
+  int support_p;
+  grn_obj grn_support_p;
+
+  cut_assert_ensure_context();
+  GRN_BOOL_INIT(&grn_support_p, 0);
+  grn_obj_get_info(context, NULL, GRN_INFO_SUPPORT_LZ4, &grn_support_p);
+  support_p = GRN_BOOL_VALUE(&grn_support_p);
+  GRN_OBJ_FIN(context, &grn_support_p);
+
+#ifdef GRN_WITH_LZ4
+  cut_assert_true(support_p);
+#else
+  cut_assert_false(support_p);
+#endif
+}
+
+void
+test_support_zstd(void)
+{
+  int support_p;
+  grn_obj grn_support_p;
+
+  cut_assert_ensure_context();
+  GRN_BOOL_INIT(&grn_support_p, 0);
+  grn_obj_get_info(context, NULL, GRN_INFO_SUPPORT_ZSTD, &grn_support_p);
+  support_p = GRN_BOOL_VALUE(&grn_support_p);
+  GRN_OBJ_FIN(context, &grn_support_p);
+
+#ifdef GRN_WITH_ZSTD
+  cut_assert_true(support_p);
+#else
+  cut_assert_false(support_p);
+#endif
+}
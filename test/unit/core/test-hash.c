@@ -26,6 +26,9 @@ void data_open(void);
 void test_open(gconstpointer data);
 void test_open_without_path(void);
 void test_open_tiny_hash(void);
+void data_open_long_key(void);
+void test_open_long_key(gconstpointer data);
+void test_open_unknown_hash_function(void);
 void data_lookup_add(void);
 void test_lookup_add(gconstpointer data);
 void data_delete_by_id(void);
@@ -185,6 +188,57 @@ test_open_tiny_hash(void)
   cut_assert_fail_open_hash();
 }
 
+void
+data_open_long_key(void)
+{
+  cut_add_data("byte", GUINT_TO_POINTER(GRN_HASH_FUNCTION_BYTE), NULL,
+               "word", GUINT_TO_POINTER(GRN_HASH_FUNCTION_WORD), NULL);
+}
+
+void
+test_open_long_key(gconstpointer data)
+{
+  uint32_t hash_function = GPOINTER_TO_UINT(data);
+  const gchar *key_format = "http://groonga.org/docs/reference/commands/"
+                            "select.html?page=%d";
+  gint i, n_keys = 1000;
+
+  set_variable_size();
+  cut_assert_create_hash();
+  /* Files created by old versions have the byte hash function. */
+  hash->header->hash_function = hash_function;
+  hash->hash_function = hash_function;
+  for (i = 0; i < n_keys; i++) {
+    const gchar *key = cut_take_printf(key_format, i);
+    grn_test_assert_equal_id(context,
+                             i + 1,
+                             grn_hash_add(context, hash, key, strlen(key),
+                                          NULL, NULL));
+  }
+  grn_hash_close(context, hash);
+
+  cut_assert_open_hash();
+  cut_assert_equal_uint(hash_function, hash->hash_function);
+  cut_assert_equal_uint(n_keys, GRN_HASH_SIZE(hash));
+  for (i = 0; i < n_keys; i++) {
+    const gchar *key = cut_take_printf(key_format, i);
+    grn_test_assert_equal_id(context,
+                             i + 1,
+                             grn_hash_get(context, hash, key, strlen(key),
+                                          NULL));
+  }
+}
+
+void
+test_open_unknown_hash_function(void)
+{
+  cut_assert_create_hash();
+  hash->header->hash_function = GRN_HASH_FUNCTION_WORD + 1;
+  grn_hash_close(context, hash);
+
+  cut_assert_fail_open_hash();
+}
+
 typedef struct _grn_test_data grn_test_data;
 
 typedef void (*increment_key_func) (grn_test_data *test_data);
@@ -38,6 +38,7 @@ void test_scalar_index(void);
 void test_int_index(void);
 void test_mroonga_index(void);
 void test_mroonga_index_score(void);
+void test_offline_index_parallel_build(void);
 
 #define TYPE_SIZE 1024
 
@@ -152,6 +153,8 @@ record_ids_free(void)
 void
 cut_teardown(void)
 {
+  grn_set_ii_build_n_workers(1);
+
   if (context) {
     inverted_index_free();
     if (path)
@@ -187,6 +190,7 @@ cut_teardown(void)
   ((grn_db_obj *)inverted_index)->header.domain = GRN_DB_VOID;  \
   cut_assert_not_null(inverted_index);                          \
   cut_assert_file_exist(cut_take_printf("%s.c", path));         \
+  cut_assert_file_exist(cut_take_printf("%s.l", path));         \
 } while (0)
 
 void
@@ -928,3 +932,54 @@ test_mroonga_index_score(void)
   grn_obj_close(context, lc);
   grn_obj_close(context, t1);
 }
+
+void
+test_offline_index_parallel_build(void)
+{
+  gchar *db_path;
+  GString *load_command;
+  gint i;
+
+  grn_obj_close(context, db);
+
+  remove_tmp_directory();
+  g_mkdir_with_parents(tmp_directory, 0700);
+  db_path = g_build_filename(tmp_directory, "inverted-index", NULL);
+  db = grn_db_create(context, db_path, NULL);
+  g_free(db_path);
+
+  assert_send_command("table_create Memos TABLE_NO_KEY");
+  assert_send_command("column_create Memos content COLUMN_SCALAR ShortText");
+  load_command = g_string_new("load --table Memos\n[\n");
+  for (i = 0; i < 140000; i++) {
+    if (i > 0) {
+      g_string_append(load_command, ",\n");
+    }
+    g_string_append_printf(load_command, "{\"content\":\"groonga %d\"}", i);
+  }
+  g_string_append(load_command, "\n]");
+  assert_send_command(load_command->str);
+  g_string_free(load_command, TRUE);
+
+  grn_set_ii_build_n_workers(2);
+  cut_assert_equal_int(2, grn_get_ii_build_n_workers());
+  assert_send_command("table_create Terms TABLE_PAT_KEY ShortText "
+                      "--default_tokenizer TokenBigram "
+                      "--normalizer NormalizerAuto");
+  assert_send_command("column_create Terms memos_content "
+                      "COLUMN_INDEX|WITH_POSITION Memos content");
+
+  cut_assert_equal_string(
+    "[[[140000],[[\"_id\",\"UInt32\"]]]]",
+    send_command("select Memos "
+                 "--match_columns content --query groonga "
+                 "--output_columns _id --limit 0"));
+  cut_assert_equal_string(
+    "[[[2],"
+     "[[\"_id\",\"UInt32\"]],"
+     "[1],"
+     "[139999]]]",
+    send_command("select Memos "
+                 "--match_columns content --query '0 OR 139998' "
+                 "--output_columns _id --sortby _id"));
+}
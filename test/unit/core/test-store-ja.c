@@ -25,6 +25,8 @@
 #include <str.h>
 
 void test_vector_empty_load(void);
+void data_compressed_put_and_ref(void);
+void test_compressed_put_and_ref(gconstpointer data);
 
 static gchar *tmp_directory;
 
@@ -104,3 +106,52 @@ test_vector_empty_load(void)
   cut_assert_not_null(ptr);
   cut_assert_equal_uint(1, len);
 }
+
+void
+data_compressed_put_and_ref(void)
+{
+#define ADD_DATA(label, flags)                                          \
+  cut_add_data(label, GINT_TO_POINTER(flags), NULL, NULL)
+
+#ifdef GRN_WITH_ZLIB
+  ADD_DATA("zlib", GRN_OBJ_COMPRESS_ZLIB);
+#endif
+#ifdef GRN_WITH_LZO
+  ADD_DATA("lzo", GRN_OBJ_COMPRESS_LZO);
+#endif
+#ifdef GRN_WITH_LZ4
+  ADD_DATA("lz4", GRN_OBJ_COMPRESS_LZ4);
+#endif
+#ifdef GRN_WITH_ZSTD
+  ADD_DATA("zstd", GRN_OBJ_COMPRESS_ZSTD);
+#endif
+  ADD_DATA("none", GRN_OBJ_COMPRESS_NONE);
+
+#undef ADD_DATA
+}
+
+void
+test_compressed_put_and_ref(gconstpointer data)
+{
+  grn_ja *compressed_ja;
+  const gchar *value =
+    "{\"name\": \"groonga\", \"description\": \"full text search\"}, "
+    "{\"name\": \"groonga\", \"description\": \"full text search\"}";
+  void *ptr;
+  uint32_t len;
+  grn_io_win iw;
+
+  compressed_ja = grn_ja_create(context, NULL, 65536,
+                                GPOINTER_TO_INT(data));
+  cut_assert_not_null(compressed_ja);
+  grn_test_assert(grn_ja_put(context, compressed_ja, 1,
+                             (void *)value, strlen(value),
+                             GRN_OBJ_SET, NULL));
+
+  ptr = grn_ja_ref(context, compressed_ja, 1, &iw, &len);
+  cut_assert_not_null(ptr);
+  cut_assert_equal_memory(value, strlen(value), ptr, len);
+  grn_ja_unref(context, &iw);
+
+  grn_ja_close(context, compressed_ja);
+}
@@ -0,0 +1,80 @@
+# -*- coding: utf-8 -*-
+#
+# Copyright (C) 2014  Brazil
+#
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Lesser General Public
+# License version 2.1 as published by the Free Software Foundation.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public
+# License along with this library; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+class KeepAliveTest < Test::Unit::TestCase
+  include GroongaHTTPTestUtils
+
+  def setup
+    setup_server
+  end
+
+  def teardown
+    teardown_server
+  end
+
+  def test_http_1_1
+    Net::HTTP.start(@bind_address, @port) do |http|
+      3.times do
+        response = http.get(command_path("status"))
+        assert_equal(["200", "keep-alive"],
+                     [response.code, response["Connection"]])
+      end
+    end
+  end
+
+  def test_http_1_1_close
+    Net::HTTP.start(@bind_address, @port) do |http|
+      response = http.get(command_path("status"), "Connection" => "close")
+      assert_equal(["200", "close"],
+                   [response.code, response["Connection"]])
+    end
+  end
+
+  def test_http_1_0
+    response = raw_get("GET #{command_path('status')} HTTP/1.0\r\n\r\n")
+    assert_match(/^Connection: close\r$/, response)
+  end
+
+  def test_http_1_0_keep_alive
+    request = "GET #{command_path('status')} HTTP/1.0\r\n"
+    request << "Connection: Keep-Alive\r\n"
+    request << "\r\n"
+    socket = TCPSocket.new(@bind_address, @port)
+    begin
+      2.times do
+        socket.write(request)
+        header = socket.gets("\r\n\r\n")
+        assert_match(/^Connection: keep-alive\r$/, header)
+        content_length = Integer(header[/^Content-Length: (\d+)/, 1])
+        socket.read(content_length)
+      end
+    ensure
+      socket.close
+    end
+  end
+
+  private
+  def raw_get(request)
+    socket = TCPSocket.new(@bind_address, @port)
+    begin
+      socket.write(request)
+      socket.read
+    ensure
+      socket.close
+    end
+  end
+end
@@ -171,6 +171,12 @@ grn_rc_to_string(grn_rc rc)
     return "GRN_CAS_ERROR";
   case GRN_UNSUPPORTED_COMMAND_VERSION:
     return "GRN_UNSUPPORTED_COMMAND_VERSION";
+  case GRN_NORMALIZER_ERROR:
+    return "GRN_NORMALIZER_ERROR";
+  case GRN_LZ4_ERROR:
+    return "GRN_LZ4_ERROR";
+  case GRN_ZSTD_ERROR:
+    return "GRN_ZSTD_ERROR";
   default:
     return cut_take_printf("GRN_UNKNOWN_STATUS (%d)", rc);
   }
@@ -0,0 +1 @@
+GRN_VERSION=4.0.0